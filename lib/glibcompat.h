@@ -3,6 +3,11 @@
 
 /*** typedefs(not structures) and defined constants **********************************************/
 
+/* Threads, GThreadPool, GMutex and GCond may be used without g_thread_init() since glib 2.32 */
+#if GLIB_CHECK_VERSION (2, 32, 0)
+#define HAVE_GLIB_THREADS 1
+#endif
+
 /*** enums ***************************************************************************************/
 
 /*** structures declarations (and typedefs of structures)*****************************************/
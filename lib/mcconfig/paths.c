@@ -92,6 +92,9 @@ static const struct
     { "filepos",                               &mc_data_str, MC_FILEPOS_FILE},
     { "cedit" PATH_SEP_STR "cooledit.clip",    &mc_data_str, EDIT_CLIP_FILE},
     { "",                                      &mc_data_str, MC_MACRO_FILE},
+    { "",                                      &mc_data_str, MC_DIRSIZE_FILE},
+    { "",                                      &mc_data_str, MC_JOURNAL_DIR},
+    { "",                                      &mc_data_str, MC_MANIFEST_DIR},
 
     /* cache */
     { "log",                                   &mc_cache_str, "mc.log"},
@@ -153,6 +153,7 @@ struct str_class
       /*I*/ char *(*create_key_for_filename) (const char *text, int case_sen);
       /*I*/ int (*key_collate) (const char *t1, const char *t2, int case_sen);
       /*I*/ void (*release_key) (char *key, int case_sen);
+      /*I*/ gboolean (*key_is_bytewise) (int case_sen);
   /*I*/};
 
 /*** global variables defined in .c file *********************************************************/
@@ -530,6 +531,12 @@ int str_key_collate (const char *t1, const char *t2, int case_sen);
  */
 void str_release_key (char *key, int case_sen);
 
+/* return TRUE if str_key_collate compares keys byte by byte (like strcmp),
+ * so the keys may be compared by their prefixes
+ * I
+ */
+gboolean str_key_is_bytewise (int case_sen);
+
 /* return TRUE if codeset_name is utf8 or utf-8
  * I
  */
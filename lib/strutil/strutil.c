@@ -912,6 +912,14 @@ str_release_key (char *key, int case_sen)
 
 /* --------------------------------------------------------------------------------------------- */
 
+gboolean
+str_key_is_bytewise (int case_sen)
+{
+    return used_class.key_is_bytewise (case_sen);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 void
 str_msg_term_size (const char *text, int *lines, int *columns)
 {
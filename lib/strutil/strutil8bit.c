@@ -800,6 +800,14 @@ str_8bit_release_key (char *key, int case_sen)
         g_free (key);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+str_8bit_key_is_bytewise (int case_sen)
+{
+    return (case_sen != 0);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -856,6 +864,7 @@ str_8bit_init (void)
     result.create_key_for_filename = str_8bit_create_key;
     result.key_collate = str_8bit_key_collate;
     result.release_key = str_8bit_release_key;
+    result.key_is_bytewise = str_8bit_key_is_bytewise;
 
     return result;
 }
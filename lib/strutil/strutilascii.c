@@ -696,6 +696,14 @@ str_ascii_release_key (char *key, int case_sen)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static gboolean
+str_ascii_key_is_bytewise (int case_sen)
+{
+    return (case_sen != 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static int
 str_ascii_prefix (const char *text, const char *prefix)
 {
@@ -776,6 +784,7 @@ str_ascii_init (void)
     result.create_key_for_filename = str_ascii_create_key;
     result.key_collate = str_ascii_key_collate;
     result.release_key = str_ascii_release_key;
+    result.key_is_bytewise = str_ascii_key_is_bytewise;
 
     return result;
 }
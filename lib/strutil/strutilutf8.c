@@ -1431,6 +1431,15 @@ str_utf8_release_key (char *key, int case_sen)
     g_free (key);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+str_utf8_key_is_bytewise (int case_sen)
+{
+    (void) case_sen;
+    return TRUE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -1493,6 +1502,7 @@ str_utf8_init (void)
 #endif
     result.key_collate = str_utf8_key_collate;
     result.release_key = str_utf8_release_key;
+    result.key_is_bytewise = str_utf8_key_is_bytewise;
 
     return result;
 }
@@ -452,6 +452,37 @@ vfs_s_readdir (void *data)
     return (void *) &dir;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * All entries of the directory are in memory along with their inodes:
+ * return them with the stat info, so callers don't need to look them up again by path.
+ */
+
+static int
+vfs_s_readdir_batch (void *data, vfs_dirent_batch_t * batch)
+{
+    struct dirhandle *info = (struct dirhandle *) data;
+    int count;
+
+    for (count = 0; count < VFS_DIRENT_BATCH_SIZE && info->cur != NULL
+         && info->cur->data != NULL; count++)
+    {
+        const struct vfs_s_entry *entry = (const struct vfs_s_entry *) info->cur->data;
+
+        if (entry->name == NULL)
+            vfs_die ("Null in structure-cannot happen");
+
+        if (entry->ino != NULL)
+            vfs_dirent_batch_add_stat (batch, entry->name, strlen (entry->name), &entry->ino->st);
+        else
+            vfs_dirent_batch_add (batch, entry->name, strlen (entry->name), 0, DT_UNKNOWN);
+
+        info->cur = g_list_next (info->cur);
+    }
+
+    return count;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static int
@@ -1414,6 +1445,7 @@ vfs_s_init_class (struct vfs_class *vclass, struct vfs_s_subclass *sub)
     }
     vclass->opendir = vfs_s_opendir;
     vclass->readdir = vfs_s_readdir;
+    vclass->readdir_batch = vfs_s_readdir_batch;
     vclass->closedir = vfs_s_closedir;
     vclass->stat = vfs_s_stat;
     vclass->lstat = vfs_s_lstat;
@@ -63,10 +63,13 @@
 extern GString *vfs_str_buffer;
 extern vfs_class *current_vfs;
 extern struct dirent *mc_readdir_result;
+extern vfs_dirent_batch_t *mc_readdir_batch_raw;
 
 /*** global variables ****************************************************************************/
 
 struct dirent *mc_readdir_result = NULL;
+/* entries read by mc_readdir_batch() before recoding */
+vfs_dirent_batch_t *mc_readdir_batch_raw = NULL;
 
 /*** file scope macro definitions ****************************************************************/
 
@@ -519,6 +522,106 @@ mc_readdir (DIR * dirp)
     return (entry != NULL) ? mc_readdir_result : NULL;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read a block of directory entries. Entries of the previous block are discarded.
+ * Unlike mc_readdir(), type of entry (and even its stat info) is returned if the VFS class
+ * knows it, and the charset conversion is skipped entirely if the directory is in
+ * the terminal encoding.
+ *
+ * Don't mix it with mc_readdir() on the same handle.
+ *
+ * @return number of entries read, 0 at the end of the directory, -1 on error
+ */
+
+int
+mc_readdir_batch (DIR * dirp, vfs_dirent_batch_t * batch)
+{
+    int handle;
+    struct vfs_class *vfs;
+    void *fsinfo = NULL;
+    vfs_path_element_t *vfs_path_element;
+    vfs_dirent_batch_t *raw = batch;
+    int ret = 0;
+
+    vfs_dirent_batch_clear (batch);
+
+    if (dirp == NULL)
+    {
+        errno = EFAULT;
+        return -1;
+    }
+    handle = *(int *) dirp;
+
+    vfs = vfs_class_find_by_handle (handle, &fsinfo);
+    if (vfs == NULL || fsinfo == NULL)
+        return -1;
+
+    vfs_path_element = (vfs_path_element_t *) fsinfo;
+
+#ifdef HAVE_CHARSET
+    /* names must be recoded: read them to the temporary batch first */
+    if (vfs_path_element->dir.converter != str_cnv_not_convert)
+    {
+        if (mc_readdir_batch_raw == NULL)
+            mc_readdir_batch_raw = vfs_dirent_batch_new ();
+        raw = mc_readdir_batch_raw;
+        vfs_dirent_batch_clear (raw);
+    }
+#endif
+
+    if (vfs->readdir_batch != NULL)
+    {
+        ret = (*vfs->readdir_batch) (vfs_path_element->dir.info, raw);
+        if (ret == -1)
+            errno = vfs_ferrno (vfs);
+    }
+    else if (vfs->readdir != NULL)
+    {
+        struct dirent *entry;
+
+        while (ret < VFS_DIRENT_BATCH_SIZE
+               && (entry = (*vfs->readdir) (vfs_path_element->dir.info)) != NULL)
+        {
+            vfs_dirent_batch_add (raw, entry->d_name, strlen (entry->d_name), entry->d_ino,
+                                  DT_UNKNOWN);
+            ret++;
+        }
+    }
+    else
+    {
+        errno = E_NOTSUPP;
+        return -1;
+    }
+
+#ifdef HAVE_CHARSET
+    if (raw != batch && ret > 0)
+    {
+        guint i;
+
+        vfs_dirent_batch_finish (raw);
+
+        for (i = 0; i < vfs_dirent_batch_len (raw); i++)
+        {
+            const vfs_dirent_t *d = vfs_dirent_batch_get (raw, i);
+
+            g_string_set_size (vfs_str_buffer, 0);
+            str_vfs_convert_from (vfs_path_element->dir.converter, d->d_name, vfs_str_buffer);
+            if (d->d_has_stat)
+                vfs_dirent_batch_add_stat (batch, vfs_str_buffer->str, vfs_str_buffer->len,
+                                           &d->d_stat);
+            else
+                vfs_dirent_batch_add (batch, vfs_str_buffer->str, vfs_str_buffer->len, d->d_ino,
+                                      d->d_type);
+        }
+    }
+#endif
+
+    vfs_dirent_batch_finish (batch);
+
+    return ret;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 int
@@ -44,6 +44,16 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_IOCTL_H
+#include <sys/ioctl.h>
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+#ifdef HAVE_LINUX_FS_H
+#include <linux/fs.h>           /* FICLONE, FICLONERANGE */
+#endif
 
 #include "lib/global.h"
 #include "lib/strutil.h"
@@ -61,6 +71,7 @@
 
 /* TODO: move it to the separate .h */
 extern struct dirent *mc_readdir_result;
+extern vfs_dirent_batch_t *mc_readdir_batch_raw;
 extern GPtrArray *vfs__classes_list;
 extern GString *vfs_str_buffer;
 extern vfs_class *current_vfs;
@@ -486,6 +497,7 @@ vfs_shut (void)
     g_ptr_array_free (vfs__classes_list, TRUE);
     g_string_free (vfs_str_buffer, TRUE);
     g_free (mc_readdir_result);
+    vfs_dirent_batch_free (mc_readdir_batch_raw);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -515,6 +527,35 @@ vfs_file_is_local (const vfs_path_t * vpath)
     return (vfs_file_class_flags (vpath) & VFSF_LOCAL) != 0;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the path of the file if it may be passed to syscalls as is: the path is absolute,
+ * on the local filesystem only, and names in it are not recoded.
+ *
+ * @param vpath path of the file
+ *
+ * @return path of the file or NULL
+ */
+
+const char *
+vfs_file_get_local_path (const vfs_path_t * vpath)
+{
+    const vfs_path_element_t *path_element;
+
+    if (vfs_path_elements_count (vpath) != 1)
+        return NULL;
+
+    path_element = vfs_path_get_by_index (vpath, -1);
+    if ((path_element->class->flags & VFSF_LOCAL) == 0 || !IS_PATH_SEP (path_element->path[0]))
+        return NULL;
+#ifdef HAVE_CHARSET
+    if (path_element->encoding != NULL)
+        return NULL;
+#endif
+
+    return path_element->path;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 void
@@ -648,3 +689,242 @@ vfs_preallocate (int dest_vfs_fd, off_t src_fsize, off_t dest_fsize)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the descriptor of the file opened on the local filesystem.
+ *
+ * @param vfs_fd mc VFS file handler
+ *
+ * @return descriptor of the file or -1 if the file is not local
+ */
+
+int
+vfs_local_fd (int vfs_fd)
+{
+    struct vfs_class *vclass;
+    void *fsinfo = NULL;
+
+    vclass = vfs_class_find_by_handle (vfs_fd, &fsinfo);
+    if (vclass == NULL || (vclass->flags & VFSF_LOCAL) == 0 || fsinfo == NULL)
+        return -1;
+
+    return *(int *) fsinfo;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Make the destination file share data of the source file (reflink). It's possible
+ * if both files are local and on the same filesystem which supports it (btrfs, xfs).
+ * Data from the source offset up to the end of the source file is placed at the destination
+ * offset; offsets other than 0 should be aligned to the block size of the filesystem.
+ *
+ * @param dest_vfs_fd mc VFS file handler of the destination file
+ * @param src_vfs_fd mc VFS file handler of the source file
+ * @param src_offset offset in the source file
+ * @param dest_offset offset in the destination file
+ *
+ * @return 0 if success and -1 otherwise. Offsets of the files are not changed.
+ */
+
+int
+vfs_clone_file (int dest_vfs_fd, int src_vfs_fd, off_t src_offset, off_t dest_offset)
+{
+#if defined (FICLONE) && defined (FICLONERANGE)
+    int src_fd, dest_fd;
+
+    src_fd = vfs_local_fd (src_vfs_fd);
+    dest_fd = vfs_local_fd (dest_vfs_fd);
+    if (src_fd == -1 || dest_fd == -1)
+        return -1;
+
+    if (src_offset == 0 && dest_offset == 0)
+        return ioctl (dest_fd, FICLONE, src_fd) == 0 ? 0 : -1;
+
+    {
+        struct file_clone_range range;
+
+        range.src_fd = src_fd;
+        range.src_offset = src_offset;
+        range.src_length = 0;   /* up to the end of file */
+        range.dest_offset = dest_offset;
+
+        return ioctl (dest_fd, FICLONERANGE, &range) == 0 ? 0 : -1;
+    }
+#else
+    (void) dest_vfs_fd;
+    (void) src_vfs_fd;
+    (void) src_offset;
+    (void) dest_offset;
+
+    return -1;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Copy data between local files in the kernel, from the current offset of the source file
+ * to the current offset of the destination file. Offsets of both files are advanced.
+ *
+ * If the method is not supported for these files, slower methods are tried. If none of them
+ * is possible, the method is set to VFS_COPY_READ_WRITE and the caller should copy data
+ * itself. I/O errors are not reported here: the caller gets them from mc_read()/mc_write().
+ *
+ * @param src_vfs_fd mc VFS file handler of the source file
+ * @param dest_vfs_fd mc VFS file handler of the destination file
+ * @param count maximal number of bytes to copy
+ * @param method the fastest method to try; the method actually used is returned here
+ *
+ * @return number of copied bytes, 0 at the end of the source file, -1 if data can't be
+ *         copied in the kernel
+ */
+
+ssize_t
+vfs_copy_range (int src_vfs_fd, int dest_vfs_fd, size_t count, vfs_copy_method_t * method)
+{
+    int src_fd, dest_fd;
+
+    src_fd = vfs_local_fd (src_vfs_fd);
+    dest_fd = vfs_local_fd (dest_vfs_fd);
+    if (src_fd == -1 || dest_fd == -1)
+        *method = VFS_COPY_READ_WRITE;
+
+    while (TRUE)
+    {
+        ssize_t n = -1;
+
+        switch (*method)
+        {
+        case VFS_COPY_CLONE:
+        case VFS_COPY_FILE_RANGE:
+#ifdef HAVE_COPY_FILE_RANGE
+            n = copy_file_range (src_fd, NULL, dest_fd, NULL, count, 0);
+#else
+            errno = ENOSYS;
+#endif
+            break;
+        case VFS_COPY_SENDFILE:
+#if defined (HAVE_SENDFILE) && defined (HAVE_SYS_SENDFILE_H)
+            n = sendfile (dest_fd, src_fd, NULL, count);
+#else
+            errno = ENOSYS;
+#endif
+            break;
+        default:
+            return -1;
+        }
+
+        if (n >= 0)
+            return n;
+
+        if (errno != EINTR)
+            *method = *method == VFS_COPY_SENDFILE ? VFS_COPY_READ_WRITE : VFS_COPY_SENDFILE;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+vfs_dirent_batch_t *
+vfs_dirent_batch_new (void)
+{
+    vfs_dirent_batch_t *batch;
+
+    batch = g_new (vfs_dirent_batch_t, 1);
+    batch->entries =
+        g_array_sized_new (FALSE, FALSE, sizeof (vfs_dirent_t), VFS_DIRENT_BATCH_SIZE);
+    batch->names = g_string_sized_new (VFS_DIRENT_BATCH_SIZE * 16);
+
+    return batch;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+vfs_dirent_batch_free (vfs_dirent_batch_t * batch)
+{
+    if (batch == NULL)
+        return;
+
+    g_array_free (batch->entries, TRUE);
+    g_string_free (batch->names, TRUE);
+    g_free (batch);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+vfs_dirent_batch_clear (vfs_dirent_batch_t * batch)
+{
+    g_array_set_size (batch->entries, 0);
+    g_string_set_size (batch->names, 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Append an entry to the batch. Used by VFS classes implementing readdir_batch.
+ */
+
+void
+vfs_dirent_batch_add (vfs_dirent_batch_t * batch, const char *name, size_t len, ino_t ino,
+                      unsigned char type)
+{
+    vfs_dirent_t d;
+
+    d.d_name = NULL;
+    d.d_namlen = len;
+    d.d_ino = ino;
+    d.d_type = type;
+    d.d_has_stat = FALSE;
+    d.d_name_offset = batch->names->len;
+
+    g_string_append_len (batch->names, name, len);
+    g_string_append_c (batch->names, '\0');
+    g_array_append_val (batch->entries, d);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Append an entry with known stat info to the batch. Type and inode are taken from @st.
+ */
+
+void
+vfs_dirent_batch_add_stat (vfs_dirent_batch_t * batch, const char *name, size_t len,
+                           const struct stat *st)
+{
+    vfs_dirent_t *d;
+    unsigned char type;
+
+    if (S_ISDIR (st->st_mode))
+        type = DT_DIR;
+    else if (S_ISREG (st->st_mode))
+        type = DT_REG;
+    else if (S_ISLNK (st->st_mode))
+        type = DT_LNK;
+    else
+        type = DT_UNKNOWN;
+
+    vfs_dirent_batch_add (batch, name, len, st->st_ino, type);
+
+    d = &g_array_index (batch->entries, vfs_dirent_t, batch->entries->len - 1);
+    d->d_has_stat = TRUE;
+    d->d_stat = *st;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Set d_name of all entries. The storage of names can be reallocated while entries are added,
+ * so names are available only after the batch is completely filled.
+ */
+
+void
+vfs_dirent_batch_finish (vfs_dirent_batch_t * batch)
+{
+    guint i;
+
+    for (i = 0; i < batch->entries->len; i++)
+    {
+        vfs_dirent_t *d = &g_array_index (batch->entries, vfs_dirent_t, i);
+
+        d->d_name = batch->names->str + d->d_name_offset;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
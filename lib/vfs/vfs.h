@@ -93,6 +93,17 @@
 #define E_PROTO EIO
 #endif
 
+/* Number of entries mc_readdir_batch() reads at once if the class can't read a block itself */
+#define VFS_DIRENT_BATCH_SIZE 256
+
+/* Types of directory entries for systems without d_type */
+#ifndef DT_UNKNOWN
+#define DT_UNKNOWN 0
+#define DT_DIR 4
+#define DT_REG 8
+#define DT_LNK 10
+#endif
+
 typedef void (*fill_names_f) (const char *);
 
 typedef void *vfsid;
@@ -107,6 +118,15 @@ typedef enum
     VFSF_NOLINKS = 1 << 1       /* Hard links not supported */
 } vfs_class_flags_t;
 
+/* Ways to copy data of local files, from the slowest. See vfs_copy_range() */
+typedef enum
+{
+    VFS_COPY_READ_WRITE = 0,    /* through a buffer of the caller */
+    VFS_COPY_SENDFILE,          /* sendfile() */
+    VFS_COPY_FILE_RANGE,        /* copy_file_range(), may share data on some filesystems */
+    VFS_COPY_CLONE              /* share data of the source file (reflink), see vfs_clone_file() */
+} vfs_copy_method_t;
+
 /* Operations for mc_ctl - on open file */
 enum
 {
@@ -128,6 +148,25 @@ enum
 
 /*** structures declarations (and typedefs of structures)*****************************************/
 
+/* Directory entry read by mc_readdir_batch() */
+typedef struct
+{
+    const char *d_name;         /* valid until the batch is read again or freed */
+    size_t d_namlen;
+    ino_t d_ino;
+    unsigned char d_type;       /* DT_xxx, DT_UNKNOWN if the class doesn't know the type */
+    gboolean d_has_stat;        /* TRUE if d_stat is valid */
+    struct stat d_stat;         /* the same as mc_lstat() of the entry would return */
+    gsize d_name_offset;        /* for internal use: position of d_name in the storage */
+} vfs_dirent_t;
+
+/* Block of directory entries read by mc_readdir_batch() */
+typedef struct
+{
+    GArray *entries;            /* array of vfs_dirent_t */
+    GString *names;             /* storage of names of entries */
+} vfs_dirent_batch_t;
+
 typedef struct vfs_class
 {
     const char *name;           /* "FIles over SHell" */
@@ -160,6 +199,13 @@ typedef struct vfs_class
     void *(*opendir) (const vfs_path_t * vpath);
     void *(*readdir) (void *vfs_info);
     int (*closedir) (void *vfs_info);
+    /**
+     * Optional. Append a block of entries to the batch using vfs_dirent_batch_add().
+     * Classes which have the stat info of entries at hand should add it as well using
+     * vfs_dirent_batch_add_stat(), so callers don't need to lstat entries one by one.
+     * Return the number of entries added, 0 at the end of the directory, -1 on error.
+     */
+    int (*readdir_batch) (void *vfs_info, vfs_dirent_batch_t * batch);
 
     int (*stat) (const vfs_path_t * vpath, struct stat * buf);
     int (*lstat) (const vfs_path_t * vpath, struct stat * buf);
@@ -239,6 +285,7 @@ void vfs_set_raw_current_dir (const vfs_path_t * vpath);
 
 gboolean vfs_current_is_local (void);
 gboolean vfs_file_is_local (const vfs_path_t * vpath);
+const char *vfs_file_get_local_path (const vfs_path_t * vpath);
 
 char *vfs_strip_suffix_from_filename (const char *filename);
 
@@ -273,6 +320,19 @@ void vfs_setup_cwd (void);
 char *_vfs_get_cwd (void);
 
 int vfs_preallocate (int dest_desc, off_t src_fsize, off_t dest_fsize);
+int vfs_local_fd (int vfs_fd);
+int vfs_clone_file (int dest_vfs_fd, int src_vfs_fd, off_t src_offset, off_t dest_offset);
+ssize_t vfs_copy_range (int src_vfs_fd, int dest_vfs_fd, size_t count,
+                        vfs_copy_method_t * method);
+
+vfs_dirent_batch_t *vfs_dirent_batch_new (void);
+void vfs_dirent_batch_free (vfs_dirent_batch_t * batch);
+void vfs_dirent_batch_clear (vfs_dirent_batch_t * batch);
+void vfs_dirent_batch_add (vfs_dirent_batch_t * batch, const char *name, size_t len, ino_t ino,
+                           unsigned char type);
+void vfs_dirent_batch_add_stat (vfs_dirent_batch_t * batch, const char *name, size_t len,
+                                const struct stat *st);
+void vfs_dirent_batch_finish (vfs_dirent_batch_t * batch);
 
 /**
  * Interface functions described in interface.c
@@ -285,6 +345,7 @@ int mc_close (int handle);
 off_t mc_lseek (int fd, off_t offset, int whence);
 DIR *mc_opendir (const vfs_path_t * vpath);
 struct dirent *mc_readdir (DIR * dirp);
+int mc_readdir_batch (DIR * dirp, vfs_dirent_batch_t * batch);
 int mc_closedir (DIR * dir);
 int mc_stat (const vfs_path_t * vpath, struct stat *buf);
 int mc_mknod (const vfs_path_t * vpath, mode_t mode, dev_t dev);
@@ -313,4 +374,20 @@ const char *mc_tmpdir (void);
 
 /*** inline functions ****************************************************************************/
 
+static inline guint
+vfs_dirent_batch_len (const vfs_dirent_batch_t * batch)
+{
+    return batch->entries->len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline const vfs_dirent_t *
+vfs_dirent_batch_get (const vfs_dirent_batch_t * batch, guint i)
+{
+    return &g_array_index (batch->entries, vfs_dirent_t, i);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 #endif /* MC_VFS_VFS_H */
@@ -73,6 +73,9 @@ char *mc_args__keymap_file = NULL;
 int mc_args__debug_level = 0;
 #endif
 
+/* directory to measure the copy buffer sizes in, then exit */
+char *mc_args__bench_io_dir = NULL;
+
 void *mc_run_param0 = NULL;
 char *mc_run_param1 = NULL;
 
@@ -140,6 +143,14 @@ static const GOptionEntry argument_main_table[] = {
      NULL
     },
 
+    /* measure the block size for copying and save it */
+    {
+     "bench-io", '\0', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_STRING,
+     &mc_args__bench_io_dir,
+     N_("Measure the best block size for copying files on the disk of directory"),
+     "<dir>"
+    },
+
     {
      "printwd", 'P', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_STRING,
      &mc_args__last_wd_file,
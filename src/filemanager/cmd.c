@@ -91,6 +91,7 @@
 #include "ext.h"                /* regex_command() */
 #include "boxes.h"              /* cd_dialog() */
 #include "dir.h"
+#include "dirsize.h"            /* dir_size_scan_start() */
 
 #include "cmd.h"                /* Our definitions */
 
@@ -171,14 +172,22 @@ do_edit (const vfs_path_t * what_vpath)
 /*static*/ void           /* @FIXME: this should be public: lua/modules/ui-panel.c wants this */
 set_panel_filter_to (WPanel * p, char *allocated_filter_string)
 {
-    g_free (p->filter);
+    char *old_filter = p->filter;
+
     p->filter = 0;
 
     if (!(allocated_filter_string[0] == '*' && allocated_filter_string[1] == 0))
         p->filter = allocated_filter_string;
     else
         g_free (allocated_filter_string);
-    reread_cmd ();
+
+    /* usually the directory needn't be read again */
+    if (panel_refilter (p, old_filter))
+        repaint_screen ();
+    else
+        reread_cmd ();
+
+    g_free (old_filter);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -533,6 +542,75 @@ set_basic_panel_listing_to (int panel_index, int listing_mode)
     return ok;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compute the size of the directory of the panel. Local directories are scanned by threads.
+ *
+ * @return FILE_CONT on success, FILE_ABORT or FILE_SKIP if the user has stopped scanning
+ */
+
+static FileProgressStatus
+compute_panel_dir_size (const WPanel * panel, const char *fname, dirsize_status_msg_t * dsm,
+                        uintmax_t * total)
+{
+    status_msg_t *sm = STATUS_MSG (dsm);
+    vfs_path_t *vpath;
+    dir_size_scan_t *scan = NULL;
+    FileProgressStatus ret = FILE_CONT;
+
+    /* names in panelized panels may be absolute */
+    if (IS_PATH_SEP (fname[0]))
+        vpath = vfs_path_from_str (fname);
+    else
+        vpath = vfs_path_append_new (panel->cwd_vpath, fname, (char *) NULL);
+
+    if (dir_size_can_scan (vpath))
+        scan = dir_size_scan_start (vfs_path_as_str (vpath));
+
+    if (scan == NULL)
+    {
+        size_t dir_count = 0;
+        size_t count = 0;
+
+        ret = compute_dir_size (vpath, dsm, &dir_count, &count, total, TRUE);
+    }
+    else
+    {
+        dir_size_t size;
+        gboolean finished;
+
+        do
+        {
+            char *current;
+
+            finished = dir_size_scan_wait (scan, &size, &current);
+
+            if (!finished && current != NULL && sm->update != NULL)
+            {
+                vfs_path_t *current_vpath;
+
+                current_vpath = vfs_path_from_str (current);
+                dsm->dirname_vpath = current_vpath;
+                dsm->dir_count = size.dirs;
+                dsm->total_size = dir_size_value (&size);
+                ret = sm->update (sm);
+                vfs_path_free (current_vpath);
+            }
+
+            g_free (current);
+        }
+        while (!finished && ret == FILE_CONT);
+
+        dir_size_scan_free (scan);
+
+        *total = dir_size_value (&size);
+    }
+
+    vfs_path_free (vpath);
+
+    return ret;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -956,6 +1034,9 @@ reread_cmd (void)
         vfs_path_equal (current_panel->cwd_vpath, other_panel->cwd_vpath))
         flag = UP_OPTIMIZE;
 
+    /* files may have been changed deep in trees sized before */
+    dir_size_cache_revalidate ();
+
     update_panels (UP_RELOAD | flag, UP_KEEPSEL);
     repaint_screen ();
 }
@@ -1449,26 +1530,19 @@ single_dirsize_cmd (void)
     entry = &(panel->dir.list[panel->selected]);
     if (S_ISDIR (entry->st.st_mode) && !DIR_IS_DOTDOT (entry->fname))
     {
-        size_t dir_count = 0;
-        size_t count = 0;
         uintmax_t total = 0;
         dirsize_status_msg_t dsm;
-        vfs_path_t *p;
-
-        p = vfs_path_from_str (entry->fname);
 
         memset (&dsm, 0, sizeof (dsm));
         status_msg_init (STATUS_MSG (&dsm), _("Directory scanning"), 0, dirsize_status_init_cb,
                          dirsize_status_update_cb, dirsize_status_deinit_cb);
 
-        if (compute_dir_size (p, &dsm, &dir_count, &count, &total, TRUE) == FILE_CONT)
+        if (compute_panel_dir_size (panel, entry->fname, &dsm, &total) == FILE_CONT)
         {
             entry->st.st_size = (off_t) total;
             entry->f.dir_size_computed = 1;
         }
 
-        vfs_path_free (p);
-
         status_msg_deinit (STATUS_MSG (&dsm));
     }
 
@@ -1501,16 +1575,10 @@ dirsizes_cmd (void)
             && ((panel->dirs_marked && panel->dir.list[i].f.marked)
                 || !panel->dirs_marked) && !DIR_IS_DOTDOT (panel->dir.list[i].fname))
         {
-            vfs_path_t *p;
-            size_t dir_count = 0;
-            size_t count = 0;
             uintmax_t total = 0;
-            gboolean ok;
 
-            p = vfs_path_from_str (panel->dir.list[i].fname);
-            ok = compute_dir_size (p, &dsm, &dir_count, &count, &total, TRUE) != FILE_CONT;
-            vfs_path_free (p);
-            if (ok)
+            if (compute_panel_dir_size (panel, panel->dir.list[i].fname, &dsm, &total) !=
+                FILE_CONT)
                 break;
 
             panel->dir.list[i].st.st_size = (off_t) total;
@@ -0,0 +1,262 @@
+/*
+   Updating of a local file in place with changed blocks only
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file src/filemanager/copydelta.c
+ *  \brief Source: updating of a local file in place with changed blocks only
+ *
+ *  A big file which is overwritten by its newer version (a database dump, an image of
+ *  a virtual machine) often differs in a few places only. If copy_delta_min_size is set,
+ *  such local target is not truncated: both files are read block by block and only
+ *  blocks which differ are written, so SSDs and SMR disks aren't worn by rewriting
+ *  the same data.
+ *
+ *  Both files are local, so blocks are compared directly at the same offsets. Checksums
+ *  used by rsync save the bandwidth of the network, there is none to save here, and
+ *  data moved to other offsets couldn't be written in place anyway.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+
+#include "copydelta.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* Blocks are compared and written with the granularity of pages */
+#define COPY_DELTA_BLOCK_SIZE 4096
+
+/*** file scope type declarations ****************************************************************/
+
+struct copy_delta_struct
+{
+    int src_fd;
+    int dst_fd;
+    char *src_buf;
+    char *dst_buf;
+    size_t bufsize;
+
+    off_t offset;               /* files are compared up to here */
+    off_t written;              /* bytes written to the target file */
+};
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/** Read up to count bytes at the offset. Less is read only at the end of the file */
+
+static ssize_t
+copy_delta_read (int fd, char *buf, size_t count, off_t offset)
+{
+    size_t total = 0;
+
+    while (total < count)
+    {
+        ssize_t n;
+
+        n = pread (fd, buf + total, count - total, offset + (off_t) total);
+        if (n == 0)
+            break;
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        total += (size_t) n;
+    }
+
+    return (ssize_t) total;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+copy_delta_write (int fd, const char *buf, size_t count, off_t offset)
+{
+    while (count > 0)
+    {
+        ssize_t n;
+
+        n = pwrite (fd, buf, count, offset);
+        if (n < 0 && errno != EINTR)
+            return FALSE;
+        if (n > 0)
+        {
+            buf += n;
+            count -= (size_t) n;
+            offset += n;
+        }
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Check whether the block of the source buffer is in the target buffer already */
+
+static gboolean
+copy_delta_same_block (const copy_delta_t * delta, size_t off, size_t len, size_t dst_len)
+{
+    return off + len <= dst_len && memcmp (delta->src_buf + off, delta->dst_buf + off, len) == 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start updating of the target file.
+ *
+ * @param src_fd descriptor of the local source file
+ * @param dst_fd descriptor of the local target file opened for reading and writing
+ * @param bufsize maximal amount of data compared at once, rounded down to blocks
+ *
+ * @return new delta
+ */
+
+copy_delta_t *
+copy_delta_new (int src_fd, int dst_fd, size_t bufsize)
+{
+    copy_delta_t *delta;
+
+    delta = g_new0 (copy_delta_t, 1);
+    delta->src_fd = src_fd;
+    delta->dst_fd = dst_fd;
+    /* blocks are aligned to the start of files */
+    delta->bufsize = MAX (bufsize - bufsize % COPY_DELTA_BLOCK_SIZE, COPY_DELTA_BLOCK_SIZE);
+    delta->src_buf = g_malloc (delta->bufsize);
+    delta->dst_buf = g_malloc (delta->bufsize);
+
+    return delta;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+copy_delta_free (copy_delta_t * delta)
+{
+    if (delta == NULL)
+        return;
+
+    g_free (delta->src_buf);
+    g_free (delta->dst_buf);
+    g_free (delta);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compare the next part of files and write blocks of the source file which differ from
+ * the target file. Adjacent changed blocks are written at once.
+ *
+ * @param delta delta
+ * @param count maximal amount of data to compare
+ *
+ * @return amount of data of the source file processed, 0 at its end or -1 on error (errno
+ *         is set, the part should be copied again)
+ */
+
+ssize_t
+copy_delta_step (copy_delta_t * delta, size_t count)
+{
+    ssize_t src_n, dst_n;
+    size_t off = 0;
+
+    count = MIN (count, delta->bufsize);
+    if (count > COPY_DELTA_BLOCK_SIZE)
+        count -= count % COPY_DELTA_BLOCK_SIZE;
+
+    src_n = copy_delta_read (delta->src_fd, delta->src_buf, count, delta->offset);
+    if (src_n <= 0)
+        return src_n;
+
+    dst_n = copy_delta_read (delta->dst_fd, delta->dst_buf, (size_t) src_n, delta->offset);
+    if (dst_n < 0)
+        return -1;
+
+    while (off < (size_t) src_n)
+    {
+        size_t start, len;
+
+        len = MIN (COPY_DELTA_BLOCK_SIZE, (size_t) src_n - off);
+        if (copy_delta_same_block (delta, off, len, (size_t) dst_n))
+        {
+            off += len;
+            continue;
+        }
+
+        for (start = off, off += len; off < (size_t) src_n; off += len)
+        {
+            len = MIN (COPY_DELTA_BLOCK_SIZE, (size_t) src_n - off);
+            if (copy_delta_same_block (delta, off, len, (size_t) dst_n))
+                break;
+        }
+
+        if (!copy_delta_write (delta->dst_fd, delta->src_buf + start, off - start,
+                               delta->offset + (off_t) start))
+            return -1;
+
+        delta->written += (off_t) (off - start);
+    }
+
+    delta->offset += src_n;
+
+    return src_n;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Cut off the rest of the target file, if it was longer than the source one.
+ *
+ * @return TRUE on success, FALSE on error (errno is set)
+ */
+
+gboolean
+copy_delta_finish (copy_delta_t * delta)
+{
+    struct stat st;
+
+    if (fstat (delta->dst_fd, &st) != 0)
+        return FALSE;
+
+    return st.st_size <= delta->offset || ftruncate (delta->dst_fd, delta->offset) == 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the amount of data written to the target file so far.
+ */
+
+off_t
+copy_delta_written (const copy_delta_t * delta)
+{
+    return delta->written;
+}
+
+/* --------------------------------------------------------------------------------------------- */
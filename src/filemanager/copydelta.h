@@ -0,0 +1,31 @@
+/** \file copydelta.h
+ *  \brief Header: updating of a local file in place with changed blocks only
+ */
+
+#ifndef MC__COPYDELTA_H
+#define MC__COPYDELTA_H
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct copy_delta_struct copy_delta_t;
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+copy_delta_t *copy_delta_new (int src_fd, int dst_fd, size_t bufsize);
+void copy_delta_free (copy_delta_t * delta);
+
+ssize_t copy_delta_step (copy_delta_t * delta, size_t count);
+gboolean copy_delta_finish (copy_delta_t * delta);
+off_t copy_delta_written (const copy_delta_t * delta);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__COPYDELTA_H */
@@ -0,0 +1,30 @@
+/** \file copyhash.h
+ *  \brief Header: hashing of copied data for verification
+ */
+
+#ifndef MC__COPYHASH_H
+#define MC__COPYHASH_H
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct copy_hash_struct copy_hash_t;
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+copy_hash_t *copy_hash_new (void);
+void copy_hash_free (copy_hash_t * hash);
+
+void copy_hash_update (copy_hash_t * hash, const void *data, size_t len);
+guint64 copy_hash_digest (const copy_hash_t * hash);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__COPYHASH_H */
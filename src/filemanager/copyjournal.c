@@ -0,0 +1,383 @@
+/*
+   Journal of copied files for resuming of interrupted operations
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file src/filemanager/copyjournal.c
+ *  \brief Source: journal of copied files for resuming of interrupted operations
+ *
+ *  If copy_journal is set, copying or moving of files to the local filesystem records
+ *  each target which is copied completely, and how much of a big target is copied so far,
+ *  in a journal in MC_JOURNAL_DIR. The journal is named after the operation: its sources
+ *  and its destination. If the operation is interrupted (MC or its terminal is killed,
+ *  the operation is aborted), the same operation started again finds the journal, skips
+ *  targets copied completely without reading them and continues partially copied targets
+ *  after their recorded size. The journal is removed when the operation is finished.
+ *
+ *  A record is valid only while the size and the modification time of the source are
+ *  the same. It's written only when the data it describes is on the disk: records are
+ *  collected and written in batches, after the targets they describe are synced.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+#include "lib/fileloc.h"        /* MC_JOURNAL_DIR */
+#include "lib/mcconfig.h"       /* mc_config_get_full_path() */
+
+#include "copyjournal.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define COPY_JOURNAL_SIGNATURE "MC copy journal 1"
+
+/* Records are written when so many targets are waiting to be synced... */
+#define COPY_JOURNAL_BATCH 256
+
+/* ...or when the oldest of them waits longer than this, in microseconds */
+#define COPY_JOURNAL_INTERVAL (2 * G_USEC_PER_SEC)
+
+/*** file scope type declarations ****************************************************************/
+
+typedef struct
+{
+    off_t size;                 /* size of the source */
+    time_t mtime;               /* modification time of the source */
+    off_t offset;               /* size of the copied part of the target */
+    gboolean done;
+} copy_journal_record_t;
+
+struct copy_journal_struct
+{
+    char *name;
+    int fd;
+
+    GHashTable *records;        /* target path -> copy_journal_record_t, found in the journal */
+
+    GString *pending;           /* records waiting to be written */
+    GPtrArray *unsynced;        /* targets whose records wait for their data to be synced */
+    gint64 pending_since;
+};
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read records of the journal. Later records of a target replace earlier ones.
+ *
+ * @return length of the whole lines of the journal, 0 if it's not a journal
+ */
+
+static gsize
+copy_journal_load (copy_journal_t * journal)
+{
+    char *contents;
+    gsize len;
+    char *line, *next;
+
+    if (!g_file_get_contents (journal->name, &contents, &len, NULL))
+        return 0;
+
+    if (strncmp (contents, COPY_JOURNAL_SIGNATURE "\n", strlen (COPY_JOURNAL_SIGNATURE) + 1) != 0)
+    {
+        g_free (contents);
+        return 0;
+    }
+
+    for (line = contents; line < contents + len; line = next)
+    {
+        char state;
+        intmax_t size, mtime, offset;
+        int path_pos;
+
+        next = strchr (line, '\n');
+        /* the last record may be cut off by a crash */
+        if (next == NULL)
+            break;
+        *next++ = '\0';
+
+        if (sscanf (line, "%c %jd %jd %jd %n", &state, &size, &mtime, &offset, &path_pos) == 4
+            && (state == 'P' || state == 'D') && line[path_pos] != '\0')
+        {
+            copy_journal_record_t *r;
+
+            r = g_new (copy_journal_record_t, 1);
+            r->size = (off_t) size;
+            r->mtime = (time_t) mtime;
+            r->offset = (off_t) offset;
+            r->done = state == 'D';
+            g_hash_table_replace (journal->records, g_strcompress (line + path_pos), r);
+        }
+    }
+
+    len = (gsize) (line - contents);
+    g_free (contents);
+
+    return len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+copy_journal_write (int fd, const char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n;
+
+        n = write (fd, buf, len);
+        if (n < 0 && errno != EINTR)
+            return FALSE;
+        if (n > 0)
+        {
+            buf += n;
+            len -= (size_t) n;
+        }
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Sync targets waiting for it and write their records */
+
+static void
+copy_journal_flush (copy_journal_t * journal)
+{
+    guint i;
+
+    if (journal->pending->len == 0)
+        return;
+
+    for (i = 0; i < journal->unsynced->len; i++)
+    {
+        int fd;
+
+        fd = open ((const char *) g_ptr_array_index (journal->unsynced, i), O_RDONLY);
+        if (fd != -1)
+        {
+            (void) fsync (fd);
+            close (fd);
+        }
+    }
+    g_ptr_array_set_size (journal->unsynced, 0);
+
+    /* a failed journal just can't resume the operation */
+    if (copy_journal_write (journal->fd, journal->pending->str, journal->pending->len))
+        (void) fsync (journal->fd);
+    g_string_truncate (journal->pending, 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+copy_journal_add (copy_journal_t * journal, char state, const char *path,
+                  const struct stat *src_stat, off_t offset)
+{
+    char *escaped;
+
+    if (journal->pending->len == 0)
+        journal->pending_since = g_get_monotonic_time ();
+
+    escaped = g_strescape (path, NULL);
+    g_string_append_printf (journal->pending, "%c %jd %jd %jd %s\n", state,
+                            (intmax_t) src_stat->st_size, (intmax_t) src_stat->st_mtime,
+                            (intmax_t) offset, escaped);
+    g_free (escaped);
+
+    if (journal->unsynced->len >= COPY_JOURNAL_BATCH
+        || g_get_monotonic_time () - journal->pending_since >= COPY_JOURNAL_INTERVAL)
+        copy_journal_flush (journal);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Open the journal file, reading records left in it */
+
+static copy_journal_t *
+copy_journal_open_file (const char *name)
+{
+    copy_journal_t *journal;
+    gsize len;
+    struct stat st;
+
+    journal = g_new0 (copy_journal_t, 1);
+    journal->name = g_strdup (name);
+
+    journal->records = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    len = copy_journal_load (journal);
+
+    /* a journal which can't be read is started anew */
+    journal->fd = open (journal->name, O_WRONLY | O_CREAT | (len != 0 ? O_APPEND : O_TRUNC),
+                        S_IRUSR | S_IWUSR);
+    if (journal->fd == -1)
+    {
+        g_hash_table_destroy (journal->records);
+        g_free (journal->name);
+        g_free (journal);
+        return NULL;
+    }
+
+    /* new records must not be glued to the one cut off by a crash */
+    if (len != 0)
+        (void) ftruncate (journal->fd, (off_t) len);
+
+    if (fstat (journal->fd, &st) == 0 && st.st_size == 0)
+        (void) copy_journal_write (journal->fd, COPY_JOURNAL_SIGNATURE "\n",
+                                   strlen (COPY_JOURNAL_SIGNATURE) + 1);
+
+    journal->pending = g_string_sized_new (BUF_LARGE);
+    journal->unsynced = g_ptr_array_new_with_free_func (g_free);
+
+    return journal;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Open the journal of the operation, reading records left by its previous run.
+ *
+ * @param key name of the journal unique for the operation
+ *
+ * @return journal or NULL if it can't be created
+ */
+
+copy_journal_t *
+copy_journal_open (const char *key)
+{
+    copy_journal_t *journal;
+    char *dir, *name;
+
+    dir = mc_config_get_full_path (MC_JOURNAL_DIR);
+    if (g_mkdir_with_parents (dir, S_IRWXU) != 0)
+    {
+        g_free (dir);
+        return NULL;
+    }
+
+    name = g_build_filename (dir, key, (char *) NULL);
+    g_free (dir);
+
+    journal = copy_journal_open_file (name);
+    g_free (name);
+
+    return journal;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Write remaining records and close the journal.
+ *
+ * @param journal journal, may be NULL
+ * @param finished if TRUE, the operation is over and the journal is removed
+ */
+
+void
+copy_journal_close (copy_journal_t * journal, gboolean finished)
+{
+    if (journal == NULL)
+        return;
+
+    if (finished)
+        g_ptr_array_set_size (journal->unsynced, 0);
+    else
+        copy_journal_flush (journal);
+
+    close (journal->fd);
+    if (finished)
+        unlink (journal->name);
+
+    g_ptr_array_free (journal->unsynced, TRUE);
+    g_string_free (journal->pending, TRUE);
+    g_hash_table_destroy (journal->records);
+    g_free (journal->name);
+    g_free (journal);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find what the previous run of the operation has copied to the target.
+ *
+ * @param journal journal, may be NULL
+ * @param path path of the target
+ * @param src_stat stat of the source
+ * @param offset set to the size of the copied part of the target, may be NULL
+ *
+ * @return state of the target
+ */
+
+copy_journal_state_t
+copy_journal_lookup (const copy_journal_t * journal, const char *path,
+                     const struct stat *src_stat, off_t * offset)
+{
+    const copy_journal_record_t *r;
+
+    if (journal == NULL)
+        return COPY_JOURNAL_NONE;
+
+    r = (const copy_journal_record_t *) g_hash_table_lookup (journal->records, path);
+    if (r == NULL || r->size != src_stat->st_size || r->mtime != src_stat->st_mtime)
+        return COPY_JOURNAL_NONE;
+
+    if (offset != NULL)
+        *offset = r->done ? r->size : r->offset;
+
+    return r->done ? COPY_JOURNAL_DONE : COPY_JOURNAL_PARTIAL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Record the size of the copied part of the target. The caller must have synced the target.
+ */
+
+void
+copy_journal_progress (copy_journal_t * journal, const char *path, const struct stat *src_stat,
+                       off_t offset)
+{
+    if (journal != NULL)
+        copy_journal_add (journal, 'P', path, src_stat, offset);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Record the target copied completely. It's synced before the record is written.
+ */
+
+void
+copy_journal_done (copy_journal_t * journal, const char *path, const struct stat *src_stat)
+{
+    if (journal == NULL)
+        return;
+
+    g_ptr_array_add (journal->unsynced, g_strdup (path));
+    copy_journal_add (journal, 'D', path, src_stat, src_stat->st_size);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,42 @@
+/** \file copyjournal.h
+ *  \brief Header: journal of copied files for resuming of interrupted operations
+ */
+
+#ifndef MC__COPYJOURNAL_H
+#define MC__COPYJOURNAL_H
+
+#include <sys/stat.h>
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct copy_journal_struct copy_journal_t;
+
+/*** enums ***************************************************************************************/
+
+typedef enum
+{
+    COPY_JOURNAL_NONE = 0,      /* the target is unknown or its source was changed */
+    COPY_JOURNAL_PARTIAL,       /* the beginning of the target is copied */
+    COPY_JOURNAL_DONE           /* the target is copied completely */
+} copy_journal_state_t;
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+copy_journal_t *copy_journal_open (const char *key);
+void copy_journal_close (copy_journal_t * journal, gboolean finished);
+
+copy_journal_state_t copy_journal_lookup (const copy_journal_t * journal, const char *path,
+                                          const struct stat *src_stat, off_t * offset);
+void copy_journal_progress (copy_journal_t * journal, const char *path,
+                            const struct stat *src_stat, off_t offset);
+void copy_journal_done (copy_journal_t * journal, const char *path, const struct stat *src_stat);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__COPYJOURNAL_H */
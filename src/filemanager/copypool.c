@@ -0,0 +1,405 @@
+/*
+   Parallel copying of small local files
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file src/filemanager/copypool.c
+ *  \brief Source: parallel copying of small local files
+ *
+ *  Copying of a tree with many small files is bound by the latency of open(), close(),
+ *  chmod() etc. rather than by the bandwidth, especially on network filesystems.
+ *  The pool copies such files in several threads at once. Workers use plain syscalls
+ *  on local paths: neither the VFS nor the UI may be touched from them. Only the simple
+ *  case is handled there: the target must not exist. Files which can't be copied
+ *  are returned with errno, and the caller copies them again in the main thread,
+ *  where overwrite and error queries can be asked.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_UTIME_H
+#include <utime.h>
+#else
+#include <sys/utime.h>
+#endif
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+#include "copypool.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* Size of the buffer of a worker */
+#define COPY_POOL_BUFSIZE (64 * 1024)
+
+/* Time to wait for a copied file before returning to the caller (in microseconds) */
+#define COPY_POOL_WAIT 100000
+
+/*** file scope type declarations ****************************************************************/
+
+struct copy_pool_struct
+{
+#ifdef HAVE_GLIB_THREADS
+    GThreadPool *threads;
+    GAsyncQueue *results;
+#endif
+    int pending;                /* files pushed and not popped yet */
+    volatile gint cancelled;
+
+    /* options of the operation, read by workers */
+    gboolean preserve;
+    gboolean preserve_uidgid;
+    mode_t umask_kill;
+    mode_t new_mode;            /* mode of new files if attributes are not preserved */
+};
+
+#ifdef HAVE_GLIB_THREADS
+typedef struct
+{
+    copy_pool_task_t task;      /* must be first: it's returned to the caller as is */
+    copy_pool_t *pool;
+} copy_pool_request_t;
+#endif
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_GLIB_THREADS
+
+static gboolean
+copy_pool_write_all (int fd, const char *buf, ssize_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n;
+
+        n = write (fd, buf, (size_t) len);
+        if (n < 0 && errno != EINTR)
+            return FALSE;
+        if (n > 0)
+        {
+            buf += n;
+            len -= n;
+        }
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Copy the file the same way as copy_file_file() does: create the target, copy data,
+ * then set the owner, the mode and the times.
+ *
+ * @return 0 on success, errno otherwise
+ */
+
+static int
+copy_pool_copy (const copy_pool_t * pool, copy_pool_request_t * req)
+{
+    const char *src_path = req->task.src_path;
+    const char *dst_path = req->task.dst_path;
+    char buf[COPY_POOL_BUFSIZE];
+    int src_fd, dst_fd;
+    struct stat st;
+    struct utimbuf utb;
+    int error = 0;
+
+    src_fd = open (src_path, O_RDONLY);
+    if (src_fd == -1)
+        return errno;
+
+    if (fstat (src_fd, &st) != 0)
+        error = errno;
+    else if (!S_ISREG (st.st_mode))
+        error = EINVAL;
+
+    if (error != 0)
+    {
+        close (src_fd);
+        return error;
+    }
+
+    dst_fd = open (dst_path, O_WRONLY | O_CREAT | O_EXCL, st.st_mode);
+    if (dst_fd == -1)
+    {
+        error = errno;
+        close (src_fd);
+        return error;
+    }
+
+    while (error == 0)
+    {
+        ssize_t n;
+
+        if (g_atomic_int_get (&req->pool->cancelled) != 0)
+        {
+            req->task.cancelled = TRUE;
+            error = ECANCELED;
+            break;
+        }
+
+        n = read (src_fd, buf, sizeof (buf));
+        if (n == 0)
+            break;
+        if (n < 0)
+        {
+            if (errno != EINTR)
+                error = errno;
+        }
+        else if (!copy_pool_write_all (dst_fd, buf, n))
+            error = errno;
+        else
+            req->task.size += n;
+    }
+
+    close (src_fd);
+
+    if (error == 0 && pool->preserve_uidgid && fchown (dst_fd, st.st_uid, st.st_gid) != 0)
+        error = errno;
+
+    if (error == 0)
+    {
+        if (pool->preserve)
+        {
+            if (fchmod (dst_fd, st.st_mode & pool->umask_kill) != 0)
+                error = errno;
+        }
+        else
+            (void) fchmod (dst_fd, pool->new_mode & pool->umask_kill);
+    }
+
+    if (close (dst_fd) != 0 && error == 0)
+        error = errno;
+
+    if (error != 0)
+    {
+        /* the file was created here */
+        unlink (dst_path);
+        return error;
+    }
+
+    utb.actime = st.st_atime;
+    utb.modtime = st.st_mtime;
+    (void) utime (dst_path, &utb);
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+copy_pool_worker (gpointer data, gpointer user_data)
+{
+    copy_pool_request_t *req = (copy_pool_request_t *) data;
+    copy_pool_t *pool = req->pool;
+
+    (void) user_data;
+
+    if (g_atomic_int_get (&pool->cancelled) != 0)
+    {
+        req->task.cancelled = TRUE;
+        req->task.error = ECANCELED;
+    }
+    else
+        req->task.error = copy_pool_copy (pool, req);
+
+    g_async_queue_push (pool->results, req);
+}
+
+#endif /* HAVE_GLIB_THREADS */
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create pool of workers for the file operation.
+ *
+ * @param threads number of workers
+ * @param ctx file operation context: options of the copying are taken from it
+ *
+ * @return new pool or NULL if files can't be copied in parallel
+ */
+
+copy_pool_t *
+copy_pool_new (int threads, const file_op_context_t * ctx)
+{
+#ifdef HAVE_GLIB_THREADS
+    copy_pool_t *pool;
+    mode_t mask;
+
+    if (threads < 2)
+        return NULL;
+
+    pool = g_new0 (copy_pool_t, 1);
+    pool->results = g_async_queue_new ();
+    pool->threads = g_thread_pool_new (copy_pool_worker, NULL, threads, FALSE, NULL);
+    pool->preserve = ctx->preserve;
+    pool->preserve_uidgid = ctx->preserve_uidgid;
+    pool->umask_kill = ctx->umask_kill;
+
+    /* umask can't be read without changing it, so don't do it in workers */
+    mask = umask (-1);
+    umask (mask);
+    pool->new_mode = 0100666 & ~mask;
+
+    return pool;
+#else
+    (void) threads;
+    (void) ctx;
+
+    return NULL;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Free the pool. All files should be popped before.
+ */
+
+void
+copy_pool_free (copy_pool_t * pool)
+{
+#ifdef HAVE_GLIB_THREADS
+    if (pool == NULL)
+        return;
+
+    g_thread_pool_free (pool->threads, FALSE, TRUE);
+    g_async_queue_unref (pool->results);
+    g_free (pool);
+#else
+    (void) pool;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Copy the regular file in background. The target file should not exist.
+ *
+ * @param pool the pool
+ * @param src_path source file, in the directory accepted by vfs_file_get_local_path()
+ * @param dst_path target file, in the directory accepted by vfs_file_get_local_path()
+ * @param data data of the caller, returned in the task
+ */
+
+void
+copy_pool_push (copy_pool_t * pool, const char *src_path, const char *dst_path, gpointer data)
+{
+#ifdef HAVE_GLIB_THREADS
+    copy_pool_request_t *req;
+
+    req = g_new0 (copy_pool_request_t, 1);
+    req->task.src_path = g_strdup (src_path);
+    req->task.dst_path = g_strdup (dst_path);
+    req->task.data = data;
+    req->pool = pool;
+
+    pool->pending++;
+
+    if (!g_thread_pool_push (pool->threads, req, NULL))
+        copy_pool_worker (req, NULL);
+#else
+    (void) pool;
+    (void) src_path;
+    (void) dst_path;
+    (void) data;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the next processed file.
+ *
+ * @param pool the pool
+ * @param wait if TRUE, wait a bit for a file if none is ready
+ *
+ * @return the task, which should be freed with copy_pool_task_free(), or NULL
+ */
+
+copy_pool_task_t *
+copy_pool_pop (copy_pool_t * pool, gboolean wait)
+{
+#ifdef HAVE_GLIB_THREADS
+    copy_pool_request_t *req;
+
+    if (pool->pending == 0)
+        return NULL;
+
+    if (wait)
+        req = (copy_pool_request_t *) g_async_queue_timeout_pop (pool->results, COPY_POOL_WAIT);
+    else
+        req = (copy_pool_request_t *) g_async_queue_try_pop (pool->results);
+
+    if (req == NULL)
+        return NULL;
+
+    pool->pending--;
+    return &req->task;
+#else
+    (void) pool;
+    (void) wait;
+
+    return NULL;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+copy_pool_task_free (copy_pool_task_t * task)
+{
+    g_free (task->src_path);
+    g_free (task->dst_path);
+    /* the task is the first member of the request */
+    g_free (task);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Number of files pushed to the pool and not popped yet */
+
+int
+copy_pool_pending (const copy_pool_t * pool)
+{
+    return pool->pending;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop copying. Files which are not copied yet are returned as cancelled, incomplete
+ * targets are removed.
+ */
+
+void
+copy_pool_cancel (copy_pool_t * pool)
+{
+    g_atomic_int_set (&pool->cancelled, 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,49 @@
+/** \file copypool.h
+ *  \brief Header: parallel copying of small local files
+ */
+
+#ifndef MC__COPYPOOL_H
+#define MC__COPYPOOL_H
+
+#include "lib/global.h"
+
+#include "fileopctx.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct copy_pool_struct copy_pool_t;
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/**
+ * File copied by the pool.
+ */
+typedef struct
+{
+    char *src_path;             /**< source file, as passed to copy_pool_push() */
+    char *dst_path;             /**< target file, as passed to copy_pool_push() */
+    off_t size;                 /**< number of copied bytes */
+    int error;                  /**< errno if the file was not copied, 0 on success */
+    gboolean cancelled;         /**< the file was not copied because the pool was cancelled */
+    gpointer data;              /**< data of the caller */
+} copy_pool_task_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+copy_pool_t *copy_pool_new (int threads, const file_op_context_t * ctx);
+void copy_pool_free (copy_pool_t * pool);
+
+void copy_pool_push (copy_pool_t * pool, const char *src_path, const char *dst_path,
+                     gpointer data);
+copy_pool_task_t *copy_pool_pop (copy_pool_t * pool, gboolean wait);
+void copy_pool_task_free (copy_pool_task_t * task);
+int copy_pool_pending (const copy_pool_t * pool);
+void copy_pool_cancel (copy_pool_t * pool);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__COPYPOOL_H */
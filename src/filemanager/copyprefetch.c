@@ -0,0 +1,518 @@
+/*
+   Read-ahead of files to be copied next
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file src/filemanager/copyprefetch.c
+ *  \brief Source: read-ahead of files to be copied next
+ *
+ *  Files are copied one after another: reading of the next file starts only when
+ *  the current one is written, and on a cold cache of a disk or a network filesystem
+ *  every file begins with a stall. The prefetcher keeps a queue of files to be copied
+ *  in the order they are copied. Its thread goes ahead of the copying through the queue:
+ *  it asks the kernel to read the beginning of each file into the page cache with
+ *  posix_fadvise(POSIX_FADV_WILLNEED), and lists directories of the queue itself,
+ *  in the same order mc_readdir() returns their entries, to put their files in place.
+ *
+ *  How far the thread goes is adapted to the speed of copying: it reads ahead as much
+ *  data as is copied in COPY_PREFETCH_AHEAD seconds, but not more than the window given
+ *  by the caller. So a slow copy doesn't fill the page cache with data which would be
+ *  evicted before it's used, and a fast one doesn't catch up with the read-ahead.
+ *
+ *  The caller tells which file is copied now; files of the queue before it are dropped.
+ *  Files the caller copies and the queue doesn't know are ignored, so the queue is only
+ *  a hint: it's never required to be exact.
+ */
+
+#include <config.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+
+#include "copyprefetch.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#if defined (HAVE_GLIB_THREADS) && defined (HAVE_POSIX_FADVISE)
+#define COPY_PREFETCH_THREADS 1
+#endif
+
+/* Seconds of copying read ahead */
+#define COPY_PREFETCH_AHEAD 2
+
+/* Bounds of the read-ahead, whatever the speed of copying is */
+#define COPY_PREFETCH_MIN_WINDOW (4 * 1024 * 1024)
+#define COPY_PREFETCH_MAX_ITEMS 256
+
+/* The speed of copying is measured over this interval at least, in microseconds */
+#define COPY_PREFETCH_SAMPLE (G_USEC_PER_SEC / 2)
+
+/*** file scope type declarations ****************************************************************/
+
+#ifdef COPY_PREFETCH_THREADS
+
+typedef struct
+{
+    char *path;
+    gboolean is_dir;
+    off_t size;                 /* size of the file */
+    gboolean done;              /* the file is read ahead or the directory is listed */
+    off_t len;                  /* how much of the file is read ahead */
+    gboolean busy;              /* the thread works with the item */
+    gboolean dropped;           /* the item was dropped while it's busy */
+} copy_prefetch_item_t;
+
+#endif /* COPY_PREFETCH_THREADS */
+
+struct copy_prefetch_struct
+{
+#ifdef COPY_PREFETCH_THREADS
+    GThread *thread;
+    GMutex lock;
+    GCond cond;                 /* signalled when the thread may have work */
+    gboolean cancelled;
+
+    GQueue queue;               /* copy_prefetch_item_t, in the order of copying */
+    GHashTable *index;          /* path -> link of the queue */
+    int ahead;                  /* number of done items in the queue */
+    off_t bytes_ahead;          /* amount of data read ahead in the queue */
+
+    off_t window;               /* how much data may be read ahead now */
+    off_t max_window;
+
+    off_t last_size;            /* size of the file which is copied now */
+    off_t copied;               /* amount of data copied since sample_start */
+    gint64 sample_start;
+#else
+    int dummy;
+#endif
+};
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef COPY_PREFETCH_THREADS
+
+static copy_prefetch_item_t *
+copy_prefetch_item_new (char *path, const struct stat *st)
+{
+    copy_prefetch_item_t *item;
+
+    item = g_new0 (copy_prefetch_item_t, 1);
+    item->path = path;
+    item->is_dir = S_ISDIR (st->st_mode);
+    item->size = item->is_dir ? 0 : st->st_size;
+
+    return item;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+copy_prefetch_item_free (copy_prefetch_item_t * item)
+{
+    g_free (item->path);
+    g_free (item);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Remove the link from the queue. The item is freed by the thread if it's busy */
+
+static void
+copy_prefetch_drop (copy_prefetch_t * prefetch, GList * link)
+{
+    copy_prefetch_item_t *item = (copy_prefetch_item_t *) link->data;
+
+    g_hash_table_remove (prefetch->index, item->path);
+    g_queue_delete_link (&prefetch->queue, link);
+
+    if (item->done)
+    {
+        prefetch->ahead--;
+        prefetch->bytes_ahead -= item->len;
+    }
+
+    if (item->busy)
+        item->dropped = TRUE;
+    else
+        copy_prefetch_item_free (item);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Find the first item to be read ahead, if the read-ahead isn't too far from copying */
+
+static copy_prefetch_item_t *
+copy_prefetch_find_work (const copy_prefetch_t * prefetch)
+{
+    GList *link;
+
+    if (prefetch->ahead >= COPY_PREFETCH_MAX_ITEMS)
+        return NULL;
+
+    for (link = prefetch->queue.head; link != NULL; link = g_list_next (link))
+    {
+        copy_prefetch_item_t *item = (copy_prefetch_item_t *) link->data;
+
+        if (item->done)
+            continue;
+
+        if (item->is_dir || prefetch->bytes_ahead < prefetch->window)
+            return item;
+
+        break;
+    }
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** List regular files and subdirectories of the directory in the order of readdir() */
+
+static GList *
+copy_prefetch_list_dir (const char *path)
+{
+    DIR *dir;
+    struct dirent *entry;
+    GList *items = NULL;
+    gboolean slash;
+
+    dir = opendir (path);
+    if (dir == NULL)
+        return NULL;
+
+    slash = IS_PATH_SEP (path[strlen (path) - 1]);
+
+    while ((entry = readdir (dir)) != NULL)
+    {
+        char *name;
+        struct stat st;
+
+        if (DIR_IS_DOT (entry->d_name) || DIR_IS_DOTDOT (entry->d_name))
+            continue;
+
+        /* the same as mc_build_filename() makes of the canonical path */
+        name = g_strconcat (path, slash ? "" : PATH_SEP_STR, entry->d_name, (char *) NULL);
+        if (lstat (name, &st) == 0 && (S_ISREG (st.st_mode) || S_ISDIR (st.st_mode)))
+            items = g_list_prepend (items, copy_prefetch_item_new (name, &st));
+        else
+            g_free (name);
+    }
+
+    closedir (dir);
+
+    return g_list_reverse (items);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+copy_prefetch_file (const char *path, off_t len)
+{
+    int fd;
+
+    /* opening alone brings the inode into the cache */
+    fd = open (path, O_RDONLY);
+    if (fd == -1)
+        return;
+
+    /* zero length would mean the whole file */
+    if (len > 0)
+        (void) posix_fadvise (fd, 0, len, POSIX_FADV_WILLNEED);
+
+    close (fd);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gpointer
+copy_prefetch_thread (gpointer data)
+{
+    copy_prefetch_t *prefetch = (copy_prefetch_t *) data;
+
+    g_mutex_lock (&prefetch->lock);
+
+    while (!prefetch->cancelled)
+    {
+        copy_prefetch_item_t *item;
+        char *path;
+
+        item = copy_prefetch_find_work (prefetch);
+        if (item == NULL)
+        {
+            g_cond_wait (&prefetch->cond, &prefetch->lock);
+            continue;
+        }
+
+        item->done = TRUE;
+        item->busy = TRUE;
+        prefetch->ahead++;
+        path = g_strdup (item->path);
+
+        if (item->is_dir)
+        {
+            GList *items, *i;
+
+            g_mutex_unlock (&prefetch->lock);
+            items = copy_prefetch_list_dir (path);
+            g_mutex_lock (&prefetch->lock);
+
+            if (item->dropped)
+                g_list_free_full (items, (GDestroyNotify) copy_prefetch_item_free);
+            else
+            {
+                GList *sibling;
+
+                /* the contents of the directory are copied before the rest of the queue */
+                sibling = g_queue_find (&prefetch->queue, item);
+                for (i = items; i != NULL; i = g_list_next (i))
+                {
+                    copy_prefetch_item_t *child = (copy_prefetch_item_t *) i->data;
+
+                    if (g_hash_table_lookup (prefetch->index, child->path) != NULL)
+                    {
+                        copy_prefetch_item_free (child);
+                        continue;
+                    }
+
+                    g_queue_insert_after (&prefetch->queue, sibling, child);
+                    sibling = g_list_next (sibling);
+                    g_hash_table_insert (prefetch->index, child->path, sibling);
+                }
+                g_list_free (items);
+            }
+        }
+        else
+        {
+            item->len = MIN (item->size, prefetch->window - prefetch->bytes_ahead);
+            prefetch->bytes_ahead += item->len;
+
+            g_mutex_unlock (&prefetch->lock);
+            copy_prefetch_file (path, item->len);
+            g_mutex_lock (&prefetch->lock);
+        }
+
+        g_free (path);
+
+        item->busy = FALSE;
+        if (item->dropped)
+            copy_prefetch_item_free (item);
+    }
+
+    g_mutex_unlock (&prefetch->lock);
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Adapt the window to the speed of copying. The previous file is copied when the next starts */
+
+static void
+copy_prefetch_measure (copy_prefetch_t * prefetch, off_t size)
+{
+    gint64 now, elapsed;
+
+    prefetch->copied += prefetch->last_size;
+    prefetch->last_size = size;
+
+    now = g_get_monotonic_time ();
+    elapsed = now - prefetch->sample_start;
+    if (elapsed < COPY_PREFETCH_SAMPLE)
+        return;
+
+    /* smooth the speed: files of different sizes and places are copied at different speed */
+    prefetch->window = (prefetch->window
+                        + (off_t) ((double) prefetch->copied * COPY_PREFETCH_AHEAD
+                                   * G_USEC_PER_SEC / elapsed)) / 2;
+    prefetch->window =
+        MIN (prefetch->max_window, MAX (prefetch->window, COPY_PREFETCH_MIN_WINDOW));
+
+    prefetch->copied = 0;
+    prefetch->sample_start = now;
+}
+
+#endif /* COPY_PREFETCH_THREADS */
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start the read-ahead.
+ *
+ * @param max_window the largest amount of data read ahead, in bytes
+ *
+ * @return new prefetcher or NULL if the read-ahead isn't possible
+ */
+
+copy_prefetch_t *
+copy_prefetch_new (off_t max_window)
+{
+#ifdef COPY_PREFETCH_THREADS
+    copy_prefetch_t *prefetch;
+
+    if (max_window <= 0)
+        return NULL;
+
+    prefetch = g_new0 (copy_prefetch_t, 1);
+    g_mutex_init (&prefetch->lock);
+    g_cond_init (&prefetch->cond);
+    g_queue_init (&prefetch->queue);
+    prefetch->index = g_hash_table_new (g_str_hash, g_str_equal);
+    prefetch->max_window = max_window;
+    prefetch->window = MIN (max_window, COPY_PREFETCH_MIN_WINDOW);
+    prefetch->sample_start = g_get_monotonic_time ();
+
+    prefetch->thread = g_thread_try_new ("copy-prefetch", copy_prefetch_thread, prefetch, NULL);
+    if (prefetch->thread == NULL)
+    {
+        copy_prefetch_free (prefetch);
+        return NULL;
+    }
+
+    return prefetch;
+#else
+    (void) max_window;
+
+    return NULL;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop the read-ahead and free the prefetcher.
+ *
+ * @param prefetch prefetcher, may be NULL
+ */
+
+void
+copy_prefetch_free (copy_prefetch_t * prefetch)
+{
+#ifdef COPY_PREFETCH_THREADS
+    if (prefetch == NULL)
+        return;
+
+    g_mutex_lock (&prefetch->lock);
+    prefetch->cancelled = TRUE;
+    g_cond_broadcast (&prefetch->cond);
+    g_mutex_unlock (&prefetch->lock);
+
+    if (prefetch->thread != NULL)
+        g_thread_join (prefetch->thread);
+
+    g_hash_table_destroy (prefetch->index);
+    while (!g_queue_is_empty (&prefetch->queue))
+        copy_prefetch_item_free ((copy_prefetch_item_t *) g_queue_pop_head (&prefetch->queue));
+    g_mutex_clear (&prefetch->lock);
+    g_cond_clear (&prefetch->cond);
+    g_free (prefetch);
+#else
+    (void) prefetch;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Add the file or the directory to be copied after files added before.
+ *
+ * @param prefetch prefetcher, may be NULL
+ * @param path canonical local path of the file, as it will be passed to copy_prefetch_next()
+ * @param st stat of the file; files other than regular files and directories are ignored
+ */
+
+void
+copy_prefetch_add (copy_prefetch_t * prefetch, const char *path, const struct stat *st)
+{
+#ifdef COPY_PREFETCH_THREADS
+    copy_prefetch_item_t *item;
+
+    if (prefetch == NULL || !(S_ISREG (st->st_mode) || S_ISDIR (st->st_mode)))
+        return;
+
+    g_mutex_lock (&prefetch->lock);
+
+    if (g_hash_table_lookup (prefetch->index, path) == NULL)
+    {
+        item = copy_prefetch_item_new (g_strdup (path), st);
+        g_queue_push_tail (&prefetch->queue, item);
+        g_hash_table_insert (prefetch->index, item->path, prefetch->queue.tail);
+        g_cond_signal (&prefetch->cond);
+    }
+
+    g_mutex_unlock (&prefetch->lock);
+#else
+    (void) prefetch;
+    (void) path;
+    (void) st;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Tell that the file or the directory is copied now. Files before it won't be copied anymore,
+ * and the read-ahead may go further.
+ *
+ * @param prefetch prefetcher, may be NULL
+ * @param path path of the file, as it's built by mc_build_filename()
+ */
+
+void
+copy_prefetch_next (copy_prefetch_t * prefetch, const char *path)
+{
+#ifdef COPY_PREFETCH_THREADS
+    GList *link;
+    copy_prefetch_item_t *item;
+
+    if (prefetch == NULL)
+        return;
+
+    g_mutex_lock (&prefetch->lock);
+
+    link = (GList *) g_hash_table_lookup (prefetch->index, path);
+    if (link != NULL)
+    {
+        while (prefetch->queue.head != link)
+            copy_prefetch_drop (prefetch, prefetch->queue.head);
+
+        item = (copy_prefetch_item_t *) link->data;
+        copy_prefetch_measure (prefetch, item->size);
+
+        /* the directory not listed yet is left to be listed before the rest of the queue */
+        if (!item->is_dir || (item->done && !item->busy))
+            copy_prefetch_drop (prefetch, link);
+
+        g_cond_signal (&prefetch->cond);
+    }
+
+    g_mutex_unlock (&prefetch->lock);
+#else
+    (void) prefetch;
+    (void) path;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,32 @@
+/** \file copyprefetch.h
+ *  \brief Header: read-ahead of files to be copied next
+ */
+
+#ifndef MC__COPYPREFETCH_H
+#define MC__COPYPREFETCH_H
+
+#include <sys/stat.h>
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct copy_prefetch_struct copy_prefetch_t;
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+copy_prefetch_t *copy_prefetch_new (off_t max_window);
+void copy_prefetch_free (copy_prefetch_t * prefetch);
+
+void copy_prefetch_add (copy_prefetch_t * prefetch, const char *path, const struct stat *st);
+void copy_prefetch_next (copy_prefetch_t * prefetch, const char *path);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__COPYPREFETCH_H */
@@ -0,0 +1,357 @@
+/*
+   Overlapped reading and writing of a big local file
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file src/filemanager/copyring.c
+ *  \brief Source: overlapped reading and writing of a big local file
+ *
+ *  When a file is copied by turns of read() and write(), one device is idle while
+ *  the other one works. The ring lets a reader thread fill up to depth buffers while
+ *  a writer thread empties them, so copying between two disks runs at the speed of
+ *  the slower one. Threads use plain syscalls on descriptors of local files; the main
+ *  thread only waits for progress and shows it. Data is copied from the start of
+ *  the source file to the start of the target file with pread() and pwrite(), so
+ *  offsets of descriptors are not changed.
+ *
+ *  On an error, the ring stops after writing the data read before it. The caller
+ *  continues from there in the usual way, so the error is reported by the usual query.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+
+#include "copyring.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* Time to wait for progress before returning to the caller (in microseconds) */
+#define COPY_RING_WAIT 100000
+
+/*** file scope type declarations ****************************************************************/
+
+struct copy_ring_struct
+{
+    int src_fd;
+    int dst_fd;
+    int depth;                  /* number of buffers */
+    size_t bufsize;
+    char *bufs;                 /* depth buffers of bufsize bytes */
+    ssize_t *lens;              /* amount of data in each buffer */
+
+#ifdef HAVE_GLIB_THREADS
+    GThread *reader;
+    GThread *writer;
+    GMutex lock;
+    GCond cond;                 /* signalled on any change of the fields below */
+#endif
+
+    guint64 filled;             /* number of buffers filled by the reader */
+    guint64 emptied;            /* number of buffers written by the writer */
+    gboolean eof;               /* the reader has stopped */
+    gboolean finished;          /* the writer has stopped */
+    gboolean cancelled;
+    off_t written;              /* bytes written to the target */
+    int error;                  /* errno of the first failed call */
+};
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_GLIB_THREADS
+
+static gpointer
+copy_ring_reader (gpointer data)
+{
+    copy_ring_t *ring = (copy_ring_t *) data;
+    off_t offset = 0;
+
+    g_mutex_lock (&ring->lock);
+
+    while (TRUE)
+    {
+        int slot;
+        ssize_t n;
+        int error;
+
+        while (!ring->cancelled && ring->filled - ring->emptied >= (guint64) ring->depth)
+            g_cond_wait (&ring->cond, &ring->lock);
+
+        if (ring->cancelled)
+            break;
+
+        slot = (int) (ring->filled % (guint64) ring->depth);
+        g_mutex_unlock (&ring->lock);
+
+        do
+            n = pread (ring->src_fd, ring->bufs + slot * ring->bufsize, ring->bufsize, offset);
+        while (n < 0 && errno == EINTR);
+        error = errno;
+
+        g_mutex_lock (&ring->lock);
+
+        if (n <= 0)
+        {
+            if (n < 0 && ring->error == 0)
+                ring->error = error;
+            break;
+        }
+
+        ring->lens[slot] = n;
+        ring->filled++;
+        offset += n;
+        g_cond_broadcast (&ring->cond);
+    }
+
+    ring->eof = TRUE;
+    g_cond_broadcast (&ring->cond);
+    g_mutex_unlock (&ring->lock);
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gpointer
+copy_ring_writer (gpointer data)
+{
+    copy_ring_t *ring = (copy_ring_t *) data;
+
+    g_mutex_lock (&ring->lock);
+
+    while (TRUE)
+    {
+        const char *buf;
+        ssize_t len;
+        off_t offset;
+        int error = 0;
+
+        while (!ring->cancelled && !ring->eof && ring->filled == ring->emptied)
+            g_cond_wait (&ring->cond, &ring->lock);
+
+        if (ring->cancelled || ring->filled == ring->emptied)
+            break;
+
+        buf = ring->bufs + (ring->emptied % (guint64) ring->depth) * ring->bufsize;
+        len = ring->lens[ring->emptied % (guint64) ring->depth];
+        offset = ring->written;
+        g_mutex_unlock (&ring->lock);
+
+        while (len > 0)
+        {
+            ssize_t n;
+
+            n = pwrite (ring->dst_fd, buf, (size_t) len, offset);
+            if (n < 0 && errno != EINTR)
+            {
+                error = errno;
+                break;
+            }
+            if (n > 0)
+            {
+                buf += n;
+                len -= n;
+                offset += n;
+            }
+        }
+
+        g_mutex_lock (&ring->lock);
+
+        /* the data written partially is written again by the caller */
+        if (error != 0)
+        {
+            if (ring->error == 0)
+                ring->error = error;
+            break;
+        }
+
+        ring->written = offset;
+        ring->emptied++;
+        g_cond_broadcast (&ring->cond);
+    }
+
+    /* stop the reader, if it's still running */
+    ring->cancelled = TRUE;
+    ring->finished = TRUE;
+    g_cond_broadcast (&ring->cond);
+    g_mutex_unlock (&ring->lock);
+
+    return NULL;
+}
+
+#endif /* HAVE_GLIB_THREADS */
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start copying of the file.
+ *
+ * @param src_fd descriptor of the local source file
+ * @param dst_fd descriptor of the local target file
+ * @param depth number of buffers, i.e. how far reading may go ahead of writing
+ * @param bufsize size of a buffer
+ *
+ * @return new ring or NULL if threads can't be started
+ */
+
+copy_ring_t *
+copy_ring_new (int src_fd, int dst_fd, int depth, size_t bufsize)
+{
+#ifdef HAVE_GLIB_THREADS
+    copy_ring_t *ring;
+
+    if (depth < 2 || bufsize == 0)
+        return NULL;
+
+    ring = g_try_new0 (copy_ring_t, 1);
+    if (ring == NULL)
+        return NULL;
+
+    ring->bufs = (char *) g_try_malloc ((gsize) depth * bufsize);
+    if (ring->bufs == NULL)
+    {
+        g_free (ring);
+        return NULL;
+    }
+
+    ring->src_fd = src_fd;
+    ring->dst_fd = dst_fd;
+    ring->depth = depth;
+    ring->bufsize = bufsize;
+    ring->lens = g_new0 (ssize_t, depth);
+    g_mutex_init (&ring->lock);
+    g_cond_init (&ring->cond);
+
+    ring->reader = g_thread_try_new ("copy-reader", copy_ring_reader, ring, NULL);
+    if (ring->reader != NULL)
+        ring->writer = g_thread_try_new ("copy-writer", copy_ring_writer, ring, NULL);
+
+    if (ring->writer == NULL)
+    {
+        copy_ring_free (ring);
+        return NULL;
+    }
+
+    return ring;
+#else
+    (void) src_fd;
+    (void) dst_fd;
+    (void) depth;
+    (void) bufsize;
+
+    return NULL;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop copying, if it's not finished yet, and free the ring.
+ */
+
+void
+copy_ring_free (copy_ring_t * ring)
+{
+#ifdef HAVE_GLIB_THREADS
+    if (ring == NULL)
+        return;
+
+    g_mutex_lock (&ring->lock);
+    ring->cancelled = TRUE;
+    g_cond_broadcast (&ring->cond);
+    g_mutex_unlock (&ring->lock);
+
+    if (ring->reader != NULL)
+        g_thread_join (ring->reader);
+    if (ring->writer != NULL)
+        g_thread_join (ring->writer);
+
+    g_mutex_clear (&ring->lock);
+    g_cond_clear (&ring->cond);
+    g_free (ring->lens);
+    g_free (ring->bufs);
+    g_free (ring);
+#else
+    (void) ring;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Wait a bit for progress of copying.
+ *
+ * @param ring the ring
+ * @param done set to TRUE if copying is finished, successfully or not
+ *
+ * @return number of bytes written to the target file so far
+ */
+
+off_t
+copy_ring_wait (copy_ring_t * ring, gboolean * done)
+{
+#ifdef HAVE_GLIB_THREADS
+    gint64 end_time;
+    off_t written;
+
+    end_time = g_get_monotonic_time () + COPY_RING_WAIT;
+
+    g_mutex_lock (&ring->lock);
+
+    written = ring->written;
+    while (!ring->finished && ring->written == written
+           && g_cond_wait_until (&ring->cond, &ring->lock, end_time))
+        ;
+
+    written = ring->written;
+    *done = ring->finished;
+
+    g_mutex_unlock (&ring->lock);
+
+    return written;
+#else
+    (void) ring;
+
+    *done = TRUE;
+    return 0;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the error which has stopped copying.
+ *
+ * @return errno of the failed read or write, 0 if there was no error
+ */
+
+int
+copy_ring_error (const copy_ring_t * ring)
+{
+    return ring->error;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,30 @@
+/** \file copyring.h
+ *  \brief Header: overlapped reading and writing of a big local file
+ */
+
+#ifndef MC__COPYRING_H
+#define MC__COPYRING_H
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct copy_ring_struct copy_ring_t;
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+copy_ring_t *copy_ring_new (int src_fd, int dst_fd, int depth, size_t bufsize);
+void copy_ring_free (copy_ring_t * ring);
+
+off_t copy_ring_wait (copy_ring_t * ring, gboolean * done);
+int copy_ring_error (const copy_ring_t * ring);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__COPYRING_H */
@@ -30,10 +30,12 @@
 
 #include <config.h>
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include "lib/global.h"
 #include "lib/tty/tty.h"
@@ -48,6 +50,9 @@
 
 #include "treestore.h"
 #include "dir.h"
+#include "dircompact.h"
+#include "dirlink.h"
+#include "dirsort.h"
 #include "layout.h"             /* rotate_dash() */
 
 /*** global variables ****************************************************************************/
@@ -59,8 +64,57 @@
         ? 1 \
         : ( (S_ISDIR (x->st.st_mode) || x->f.link_to_dir) ? 2 : 0) )
 
+/* Characters with special meaning in filter patterns besides asterisk */
+#define DIR_FILTER_SPECIAL_CHARS "?,{}[]\\|"
+
+#if defined (HAVE_GLIB_THREADS) && defined (HAVE_FSTATAT)
+#define DIR_PARALLEL_STAT 1
+#endif
+
+#ifdef DIR_PARALLEL_STAT
+/* Don't bother to start threads for small directories */
+#define DIR_STAT_PARALLEL_MIN 256
+/* Number of entries stat'ed by one task of the worker pool */
+#define DIR_STAT_CHUNK 64
+/* The list is notified at least so often while entries are stat'ed (in microseconds) */
+#define DIR_STAT_NOTIFY_INTERVAL (G_USEC_PER_SEC / 50)
+#endif
+
 /*** file scope type declarations ****************************************************************/
 
+/* File name filter compiled once for all entries */
+typedef struct
+{
+    const char *pattern;        /* NULL if all names are matched */
+    mc_search_t *search;        /* NULL if the pattern is wrong: no name is matched */
+} dir_filter_t;
+
+#ifdef DIR_PARALLEL_STAT
+/* Directory entry which is stat'ed by the worker pool */
+typedef struct
+{
+    char *fname;
+    struct stat st;
+    gboolean link_to_dir;
+    gboolean stale_link;
+    gboolean done;              /* the entry was stat'ed */
+} dir_stat_entry_t;
+
+/* Shared data of the worker pool. Workers write to disjoint ranges of entries only */
+typedef struct
+{
+    int dfd;                    /* descriptor of the directory being read */
+    gboolean defer_links;       /* don't stat targets of symlinks */
+    dir_stat_entry_t *entries;
+    gsize count;
+    gint cancelled;             /* set atomically: remaining entries are skipped */
+
+    GMutex lock;                /* protects finished */
+    GCond cond;                 /* signalled when a task is completed */
+    gsize finished;             /* number of entries processed by completed tasks */
+} dir_stat_batch_t;
+#endif /* DIR_PARALLEL_STAT */
+
 /*** file scope variables ************************************************************************/
 
 /* Reverse flag */
@@ -72,7 +126,6 @@ static int case_sensitive = OS_SORT_CASE_SENSITIVE_DEFAULT;
 /* Are the exec_bit files top in list */
 static gboolean exec_first = TRUE;
 
-static dir_list dir_copy = { NULL, 0, 0 };
 
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -139,46 +192,127 @@ clean_sort_keys (dir_list * list, int start, int count)
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the directory entry is hidden by panel options regardless of its type.
+ * @return TRUE = don't add, FALSE = stat the entry and check it further
+ */
+
+static gboolean
+dir_entry_is_hidden (const char *fname)
+{
+    if (DIR_IS_DOT (fname) || DIR_IS_DOTDOT (fname))
+        return TRUE;
+    if (!panels_options.show_dot_files && (fname[0] == '.'))
+        return TRUE;
+    if (!panels_options.show_backups && fname[strlen (fname) - 1] == '~')
+        return TRUE;
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compile the filter. Names are matched the same way as mc_search() with MC_SEARCH_T_GLOB does,
+ * but the pattern isn't compiled again for every name.
+ */
+
+static void
+dir_filter_init (dir_filter_t * filter, const char *fltr)
+{
+    filter->pattern = fltr;
+    filter->search = NULL;
+
+    if (fltr == NULL)
+        return;
+
+    filter->search = mc_search_new (fltr, NULL);
+    if (filter->search != NULL)
+    {
+        filter->search->search_type = MC_SEARCH_T_GLOB;
+        filter->search->is_case_sensitive = TRUE;
+        filter->search->is_entire_line = TRUE;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_filter_done (dir_filter_t * filter)
+{
+    mc_search_free (filter->search);
+    filter->search = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+dir_filter_match (const dir_filter_t * filter, const char *fname)
+{
+    return (filter->pattern == NULL
+            || (filter->search != NULL
+                && mc_search_run (filter->search, fname, 0, strlen (fname), NULL)));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check the stat'ed directory entry against the filter.
+ * @return FALSE = don't add, TRUE = add to the list
+ */
+
+static gboolean
+dir_entry_is_wanted (const char *fname, const struct stat *st, gboolean link_to_dir,
+                     const dir_filter_t * filter)
+{
+    if (S_ISDIR (st->st_mode))
+        tree_store_mark_checked (fname);
+
+    return (S_ISDIR (st->st_mode) || link_to_dir || dir_filter_match (filter, fname));
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * If you change handle_dirent then check also handle_path.
+ * @param defer_link if TRUE, the target of symlink isn't stat'ed: it's resolved later
  * @return FALSE = don't add, TRUE = add to the list
  */
 
 static gboolean
-handle_dirent (struct dirent *dp, const char *fltr, struct stat *buf1, int *link_to_dir,
-               int *stale_link)
+handle_dirent (const vfs_dirent_t * dp, const dir_filter_t * filter, gboolean defer_link,
+               struct stat *buf1, int *link_to_dir, int *stale_link)
 {
-    vfs_path_t *vpath;
+    vfs_path_t *vpath = NULL;
 
-    if (DIR_IS_DOT (dp->d_name) || DIR_IS_DOTDOT (dp->d_name))
-        return FALSE;
-    if (!panels_options.show_dot_files && (dp->d_name[0] == '.'))
-        return FALSE;
-    if (!panels_options.show_backups && dp->d_name[strlen (dp->d_name) - 1] == '~')
+    if (dir_entry_is_hidden (dp->d_name))
         return FALSE;
 
-    vpath = vfs_path_from_str (dp->d_name);
-    if (mc_lstat (vpath, buf1) == -1)
+    if (dp->d_has_stat)
+        /* VFS class has got it while reading the directory */
+        *buf1 = dp->d_stat;
+    else
     {
-        /*
-         * lstat() fails - such entries should be identified by
-         * buf1->st_mode being 0.
-         * It happens on QNX Neutrino for /fs/cd0 if no CD is inserted.
-         */
-        memset (buf1, 0, sizeof (*buf1));
+        vpath = vfs_path_from_str (dp->d_name);
+        if (mc_lstat (vpath, buf1) == -1)
+        {
+            /*
+             * lstat() fails - such entries should be identified by
+             * buf1->st_mode being 0.
+             * It happens on QNX Neutrino for /fs/cd0 if no CD is inserted.
+             */
+            memset (buf1, 0, sizeof (*buf1));
+        }
     }
 
-    if (S_ISDIR (buf1->st_mode))
-        tree_store_mark_checked (dp->d_name);
-
     /* A link to a file or a directory? */
     *link_to_dir = 0;
     *stale_link = 0;
-    if (S_ISLNK (buf1->st_mode))
+    if (S_ISLNK (buf1->st_mode) && !defer_link)
     {
         struct stat buf2;
 
+        if (vpath == NULL)
+            vpath = vfs_path_from_str (dp->d_name);
+
         if (mc_stat (vpath, &buf2) == 0)
             *link_to_dir = S_ISDIR (buf2.st_mode) != 0;
         else
@@ -187,8 +321,319 @@ handle_dirent (struct dirent *dp, const char *fltr, struct stat *buf1, int *link
 
     vfs_path_free (vpath);
 
-    return (S_ISDIR (buf1->st_mode) || *link_to_dir != 0 || fltr == NULL
-            || mc_search (fltr, NULL, dp->d_name, MC_SEARCH_T_GLOB));
+    return dir_entry_is_wanted (dp->d_name, buf1, *link_to_dir != 0, filter);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Notify the owner of the list about loading progress.
+ * @return FALSE if loading should be stopped
+ */
+
+static gboolean
+dir_list_notify (dir_list * list, dir_list_cb_state_t state)
+{
+    return (list->callback == NULL || list->callback (state, list->callback_data));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Mark the last entry of the list if it was marked before reload.
+ */
+
+static void
+dir_list_restore_mark (dir_list * list, GHashTable * marked_files, int *marked_cnt)
+{
+    file_entry_t *fentry;
+
+    fentry = &list->list[list->len - 1];
+    fentry->f.marked = 0;
+
+    /*
+     * If we have marked files in the copy, scan through the copy
+     * to find matching file.  Decrease number of remaining marks if
+     * we copied one.
+     */
+    if (*marked_cnt > 0 && g_hash_table_lookup (marked_files, fentry->fname) != NULL)
+    {
+        fentry->f.marked = 1;
+        (*marked_cnt)--;
+    }
+}
+
+#ifdef DIR_PARALLEL_STAT
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Task of the worker pool: stat DIR_STAT_CHUNK entries starting at the given index.
+ * Only syscalls are made here: neither the VFS nor the UI may be touched from the workers.
+ */
+
+static void
+dir_stat_worker (gpointer data, gpointer user_data)
+{
+    dir_stat_batch_t *batch = (dir_stat_batch_t *) user_data;
+    gsize i, start, end;
+
+    /* index is shifted by one, because NULL can't be pushed to the pool */
+    start = GPOINTER_TO_SIZE (data) - 1;
+    end = MIN (start + DIR_STAT_CHUNK, batch->count);
+
+    for (i = start; i < end && g_atomic_int_get (&batch->cancelled) == 0; i++)
+    {
+        dir_stat_entry_t *e = &batch->entries[i];
+
+        if (fstatat (batch->dfd, e->fname, &e->st, AT_SYMLINK_NOFOLLOW) == -1)
+            memset (&e->st, 0, sizeof (e->st));
+        else if (S_ISLNK (e->st.st_mode) && !batch->defer_links)
+        {
+            struct stat st2;
+
+            if (fstatat (batch->dfd, e->fname, &st2, 0) == 0)
+                e->link_to_dir = S_ISDIR (st2.st_mode);
+            else
+                e->stale_link = TRUE;
+        }
+
+        e->done = TRUE;
+    }
+
+    g_mutex_lock (&batch->lock);
+    batch->finished += end - start;
+    g_cond_signal (&batch->cond);
+    g_mutex_unlock (&batch->lock);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Wait for the worker pool to stat all entries. The list is notified meanwhile, so its owner
+ * can show progress and cancel loading: then entries which weren't stat'ed yet are skipped.
+ */
+
+static void
+dir_stat_wait (dir_list * list, dir_stat_batch_t * batch)
+{
+    g_mutex_lock (&batch->lock);
+
+    while (batch->finished < batch->count && g_atomic_int_get (&batch->cancelled) == 0)
+    {
+        gint64 end_time;
+
+        end_time = g_get_monotonic_time () + DIR_STAT_NOTIFY_INTERVAL;
+        g_cond_wait_until (&batch->cond, &batch->lock, end_time);
+
+        g_mutex_unlock (&batch->lock);
+        if (!dir_list_notify (list, DIR_READ))
+            g_atomic_int_set (&batch->cancelled, 1);
+        rotate_dash (TRUE);
+        g_mutex_lock (&batch->lock);
+    }
+
+    g_mutex_unlock (&batch->lock);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Open the directory to stat its entries by the worker pool. It is possible for the local
+ * filesystem only, where entries can be stat'ed relative to the directory descriptor.
+ *
+ * @return directory descriptor, -1 if entries should be stat'ed via VFS one by one
+ */
+
+static int
+dir_stat_open (const vfs_path_t * vpath)
+{
+    const char *path;
+
+    path = vfs_file_get_local_path (vpath);
+    if (dir_stat_threads < 2 || path == NULL)
+        return -1;
+
+    return open (path, O_RDONLY | O_DIRECTORY);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read directory entries and stat them concurrently with up to dir_stat_threads workers.
+ * Entries are appended to the list in the order they were read, regardless of the order
+ * in which the stat calls were completed. If the callback of the list asks to stop, entries
+ * up to the first one which wasn't stat'ed yet are appended.
+ *
+ * @return FALSE on failure, TRUE on success
+ */
+
+static gboolean
+dir_list_read_parallel (dir_list * list, DIR * dirp, vfs_dirent_batch_t * dirents, int dfd,
+                        gboolean defer_links, const dir_filter_t * filter,
+                        GHashTable * marked_files, int *marked_cnt)
+{
+    GArray *entries;
+    dir_stat_batch_t batch;
+    GThreadPool *pool = NULL;
+    gsize i;
+    gboolean stop = FALSE;
+    gboolean complete = TRUE;
+    gboolean ret = TRUE;
+
+    entries = g_array_new (FALSE, FALSE, sizeof (dir_stat_entry_t));
+
+    while (!stop && mc_readdir_batch (dirp, dirents) > 0)
+    {
+        guint j;
+
+        for (j = 0; !stop && j < vfs_dirent_batch_len (dirents); j++)
+        {
+            const vfs_dirent_t *d = vfs_dirent_batch_get (dirents, j);
+
+            if (!dir_entry_is_hidden (d->d_name))
+            {
+                dir_stat_entry_t e;
+
+                memset (&e, 0, sizeof (e));
+                e.fname = g_strndup (d->d_name, d->d_namlen);
+                g_array_append_val (entries, e);
+            }
+
+            stop = !dir_list_notify (list, DIR_READ);
+        }
+
+        rotate_dash (TRUE);
+    }
+
+    batch.dfd = dfd;
+    batch.defer_links = defer_links;
+    batch.entries = &g_array_index (entries, dir_stat_entry_t, 0);
+    batch.count = entries->len;
+    /* entries which were read before cancelling are not stat'ed at all */
+    batch.cancelled = stop ? 1 : 0;
+    g_mutex_init (&batch.lock);
+    g_cond_init (&batch.cond);
+    batch.finished = 0;
+
+    if (batch.count >= DIR_STAT_PARALLEL_MIN)
+        pool = g_thread_pool_new (dir_stat_worker, &batch, dir_stat_threads, FALSE, NULL);
+
+    for (i = 0; i < batch.count && g_atomic_int_get (&batch.cancelled) == 0; i += DIR_STAT_CHUNK)
+        if (pool == NULL || !g_thread_pool_push (pool, GSIZE_TO_POINTER (i + 1), NULL))
+        {
+            dir_stat_worker (GSIZE_TO_POINTER (i + 1), &batch);
+            if (!dir_list_notify (list, DIR_READ))
+                g_atomic_int_set (&batch.cancelled, 1);
+        }
+
+    if (pool != NULL)
+    {
+        dir_stat_wait (list, &batch);
+        /* tasks which weren't started yet are dropped if loading was cancelled */
+        g_thread_pool_free (pool, g_atomic_int_get (&batch.cancelled) != 0, TRUE);
+    }
+
+    g_mutex_clear (&batch.lock);
+    g_cond_clear (&batch.cond);
+
+    for (i = 0; i < batch.count; i++)
+    {
+        dir_stat_entry_t *e = &batch.entries[i];
+
+        /* after cancelling, only the stat'ed beginning of the list is kept */
+        if (!e->done)
+            complete = FALSE;
+        else if (ret && complete && dir_entry_is_wanted (e->fname, &e->st, e->link_to_dir, filter))
+        {
+            ret = dir_list_append (list, e->fname, &e->st, e->link_to_dir, e->stale_link);
+            if (ret && defer_links && S_ISLNK (e->st.st_mode))
+                list->list[list->len - 1].f.link_unresolved = 1;
+            if (ret && marked_files != NULL)
+                dir_list_restore_mark (list, marked_files, marked_cnt);
+        }
+
+        g_free (e->fname);
+    }
+
+    g_array_free (entries, TRUE);
+
+    return ret;
+}
+#endif /* DIR_PARALLEL_STAT */
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read directory entries and append them to the list.
+ * Reading is stopped silently if the callback of the list asks so.
+ * In local directories, targets of symlinks are resolved later by the owner of the list
+ * (see dirlink.c) unless the filter is used: links to directories are never filtered out.
+ *
+ * @param marked_files if not NULL, names of entries which must be marked
+ * @param marked_cnt number of entries in @marked_files not found yet
+ *
+ * @return FALSE on failure, TRUE on success
+ */
+
+static gboolean
+dir_list_read (dir_list * list, DIR * dirp, const vfs_path_t * vpath, const char *fltr,
+               GHashTable * marked_files, int *marked_cnt)
+{
+    vfs_dirent_batch_t *dirents;
+    int link_to_dir, stale_link;
+    struct stat st;
+    dir_filter_t filter;
+    gboolean defer_links;
+    gboolean stop = FALSE;
+    gboolean ret = TRUE;
+#ifdef DIR_PARALLEL_STAT
+    int dfd;
+#endif
+
+    dirents = vfs_dirent_batch_new ();
+    dir_filter_init (&filter, fltr);
+    defer_links = fltr == NULL && dir_link_can_defer (vpath);
+
+#ifdef DIR_PARALLEL_STAT
+    dfd = dir_stat_open (vpath);
+    if (dfd != -1)
+    {
+        ret = dir_list_read_parallel (list, dirp, dirents, dfd, defer_links, &filter,
+                                      marked_files, marked_cnt);
+        close (dfd);
+        dir_filter_done (&filter);
+        vfs_dirent_batch_free (dirents);
+        return ret;
+    }
+#endif
+
+    while (ret && !stop && mc_readdir_batch (dirp, dirents) > 0)
+    {
+        guint i;
+
+        for (i = 0; ret && !stop && i < vfs_dirent_batch_len (dirents); i++)
+        {
+            const vfs_dirent_t *d = vfs_dirent_batch_get (dirents, i);
+
+            if (handle_dirent (d, &filter, defer_links, &st, &link_to_dir, &stale_link))
+            {
+                ret = dir_list_append (list, d->d_name, &st, link_to_dir != 0, stale_link != 0);
+                if (!ret)
+                    break;
+
+                if (defer_links && S_ISLNK (st.st_mode))
+                    list->list[list->len - 1].f.link_unresolved = 1;
+
+                if (marked_files != NULL)
+                    dir_list_restore_mark (list, marked_files, marked_cnt);
+
+                if ((list->len & 31) == 0)
+                    rotate_dash (TRUE);
+            }
+
+            /* checked for every entry to let user cancel reading of a directory
+               which has no matching entries */
+            stop = !dir_list_notify (list, DIR_READ);
+        }
+    }
+
+    dir_filter_done (&filter);
+    vfs_dirent_batch_free (dirents);
+
+    return ret;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -218,30 +663,36 @@ dir_get_dotdot_stat (const vfs_path_t * vpath, struct stat *st)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Stat the entry of the directory which is not necessarily the current one.
+ * @return FALSE if the entry doesn't exist anymore
+ */
 
-static void
-alloc_dir_copy (int size)
+static gboolean
+dir_entry_stat (const vfs_path_t * dir_vpath, const char *fname, struct stat *st,
+                int *link_to_dir, int *stale_link)
 {
-    if (dir_copy.size < size)
-    {
-        if (dir_copy.list != NULL)
-        {
-            int i;
+    vfs_path_t *vpath;
+    gboolean ret;
 
-            for (i = 0; i < dir_copy.len; i++)
-            {
-                file_entry_t *fentry;
+    vpath = vfs_path_append_new (dir_vpath, fname, (char *) NULL);
+    ret = mc_lstat (vpath, st) == 0;
 
-                fentry = &(dir_copy.list)[i];
-                g_free (fentry->fname);
-            }
-            g_free (dir_copy.list);
-        }
+    *link_to_dir = 0;
+    *stale_link = 0;
+    if (ret && S_ISLNK (st->st_mode))
+    {
+        struct stat st2;
 
-        dir_copy.list = g_new0 (file_entry_t, size);
-        dir_copy.size = size;
-        dir_copy.len = 0;
+        if (mc_stat (vpath, &st2) == 0)
+            *link_to_dir = S_ISDIR (st2.st_mode) != 0;
+        else
+            *stale_link = 1;
     }
+
+    vfs_path_free (vpath);
+
+    return ret;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -321,6 +772,7 @@ dir_list_append (dir_list * list, const char *fname, const struct stat * st,
     fentry->f.marked = 0;
     fentry->f.link_to_dir = link_to_dir ? 1 : 0;
     fentry->f.stale_link = stale_link ? 1 : 0;
+    fentry->f.link_unresolved = 0;
     fentry->f.dir_size_computed = 0;
     fentry->st = *st;
     fentry->sort_key = NULL;
@@ -520,6 +972,12 @@ dir_list_sort (dir_list * list, GCompareFunc sort, const dir_sort_options_t * so
     reverse = sort_op->reverse ? -1 : 1;
     case_sensitive = sort_op->case_sensitive ? 1 : 0;
     exec_first = sort_op->exec_first;
+
+    /* built-in sort orders are sorted by precomputed keys, others (extension, version,
+       fields defined in Lua) by their comparison functions */
+    if (dir_list_sort_by_keys (list, dot_dot_found, sort, sort_op))
+        return;
+
     qsort (&(list->list)[dot_dot_found], list->len - dot_dot_found, sizeof (file_entry_t), sort);
 
     clean_sort_keys (list, dot_dot_found, list->len - dot_dot_found);
@@ -566,6 +1024,7 @@ dir_list_init (dir_list * list)
     fentry->fname = g_strndup ("..", fentry->fnamelen);
     fentry->f.link_to_dir = 0;
     fentry->f.stale_link = 0;
+    fentry->f.link_unresolved = 0;
     fentry->f.dir_size_computed = 0;
     fentry->f.marked = 0;
     fentry->st.st_mode = 040755;
@@ -625,8 +1084,6 @@ dir_list_load (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
                const dir_sort_options_t * sort_op, const char *fltr)
 {
     DIR *dirp;
-    struct dirent *dp;
-    int link_to_dir, stale_link;
     struct stat st;
     file_entry_t *fentry;
     const char *vpath_str;
@@ -647,32 +1104,48 @@ dir_list_load (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
     }
 
     tree_store_start_check (vpath);
+    dir_list_notify (list, DIR_OPEN);
 
     vpath_str = vfs_path_as_str (vpath);
     /* Do not add a ".." entry to the root directory */
     if (IS_PATH_SEP (vpath_str[0]) && vpath_str[1] == '\0')
         dir_list_clean (list);
 
-    while ((dp = mc_readdir (dirp)) != NULL)
-    {
-        if (!handle_dirent (dp, fltr, &st, &link_to_dir, &stale_link))
-            continue;
+    if (dir_list_read (list, dirp, vpath, fltr, NULL, NULL))
+        dir_list_sort (list, sort, sort_op);
 
-        if (!dir_list_append (list, dp->d_name, &st, link_to_dir != 0, stale_link != 0))
-            goto ret;
-
-        if ((list->len & 31) == 0)
-            rotate_dash (TRUE);
-    }
-
-    dir_list_sort (list, sort, sort_op);
-
-  ret:
     mc_closedir (dirp);
     tree_store_end_check ();
+    dir_list_notify (list, DIR_CLOSE);
     rotate_dash (FALSE);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stat the target of symlink which wasn't resolved while the directory was read.
+ *
+ * @param dir_vpath directory of the entry, if NULL, the entry is looked up in the current one
+ * @param fentry the entry
+ */
+
+void
+dir_entry_resolve_link (const vfs_path_t * dir_vpath, file_entry_t * fentry)
+{
+    vfs_path_t *vpath;
+    struct stat st;
+
+    if (dir_vpath != NULL)
+        vpath = vfs_path_append_new (dir_vpath, fentry->fname, (char *) NULL);
+    else
+        vpath = vfs_path_from_str (fentry->fname);
+    if (mc_stat (vpath, &st) == 0)
+        fentry->f.link_to_dir = S_ISDIR (st.st_mode) ? 1 : 0;
+    else
+        fentry->f.stale_link = 1;
+    fentry->f.link_unresolved = 0;
+    vfs_path_free (vpath);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 gboolean
@@ -685,6 +1158,237 @@ if_link_is_exe (const vfs_path_t * full_name_vpath, const file_entry_t * file)
     return TRUE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Apply changes of some entries to the loaded directory list without reading the whole
+ * directory: changed entries are stat'ed again, removed ones are deleted and new ones are
+ * added. Other entries and marks are kept. The ".." entry is not touched.
+ *
+ * @param list directory list
+ * @param vpath directory
+ * @param names set of names of changed entries
+ * @param sort sort routine
+ * @param sort_op sort options
+ * @param fltr file name filter, if NULL, then all names are matched
+ *
+ * @return TRUE if the list was changed
+ */
+
+gboolean
+dir_list_update (dir_list * list, const vfs_path_t * vpath, GHashTable * names,
+                 GCompareFunc sort, const dir_sort_options_t * sort_op, const char *fltr)
+{
+    GHashTable *added;
+    GHashTableIter iter;
+    gpointer key;
+    dir_filter_t filter;
+    gboolean changed = FALSE;
+    gboolean resort = FALSE;
+    int i, j;
+
+    dir_filter_init (&filter, fltr);
+
+    /* names which are not found in the list are new entries */
+    added = g_hash_table_new (g_str_hash, g_str_equal);
+    g_hash_table_iter_init (&iter, names);
+    while (g_hash_table_iter_next (&iter, &key, NULL))
+        g_hash_table_insert (added, key, key);
+
+    for (i = j = 0; i < list->len; i++)
+    {
+        file_entry_t *fentry = &list->list[i];
+
+        if (!DIR_IS_DOTDOT (fentry->fname) && g_hash_table_remove (added, fentry->fname))
+        {
+            struct stat st;
+            int link_to_dir, stale_link;
+
+            changed = TRUE;
+
+            if (!dir_entry_stat (vpath, fentry->fname, &st, &link_to_dir, &stale_link)
+                || !dir_entry_is_wanted (fentry->fname, &st, link_to_dir != 0, &filter))
+            {
+                /* removed */
+                g_free (fentry->fname);
+                continue;
+            }
+
+            /* the position of entry depends on its type even if it is sorted by name */
+            if (sort != (GCompareFunc) sort_name
+                || (st.st_mode & (S_IFMT | S_IXUSR | S_IXGRP | S_IXOTH))
+                != (fentry->st.st_mode & (S_IFMT | S_IXUSR | S_IXGRP | S_IXOTH))
+                || fentry->f.link_to_dir != (unsigned int) link_to_dir)
+                resort = TRUE;
+
+            fentry->st = st;
+            fentry->f.link_to_dir = link_to_dir;
+            fentry->f.stale_link = stale_link;
+            fentry->f.link_unresolved = 0;
+            fentry->f.dir_size_computed = 0;
+        }
+
+        if (i != j)
+            list->list[j] = *fentry;
+        j++;
+    }
+
+    list->len = j;
+
+    g_hash_table_iter_init (&iter, added);
+    while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+        const char *fname = (const char *) key;
+        struct stat st;
+        int link_to_dir, stale_link;
+
+        if (dir_entry_is_hidden (fname)
+            || !dir_entry_stat (vpath, fname, &st, &link_to_dir, &stale_link)
+            || !dir_entry_is_wanted (fname, &st, link_to_dir != 0, &filter))
+            continue;
+
+        if (!dir_list_append (list, fname, &st, link_to_dir != 0, stale_link != 0))
+            break;
+
+        changed = TRUE;
+        resort = TRUE;
+    }
+
+    g_hash_table_destroy (added);
+    dir_filter_done (&filter);
+
+    if (resort)
+        dir_list_sort (list, sort, sort_op);
+
+    return changed;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether every name matched by the new filter is matched by the old one too, so the
+ * list filtered with the old filter can be filtered with the new one instead of reading
+ * the directory again. Only patterns made of literal parts and asterisks are compared:
+ * it's the case when a pattern like "*abc*" is typed. For other patterns FALSE is returned.
+ *
+ * @param old_fltr filter the list was loaded with, NULL if all names are matched
+ * @param new_fltr new filter, NULL if all names are matched
+ *
+ * @return TRUE if the new filter is the same or narrower
+ */
+
+gboolean
+dir_filter_is_narrower (const char *old_fltr, const char *new_fltr)
+{
+    gchar **olds, **news;
+    guint n, m, i, j;
+    gsize pos, end;
+    gboolean ret;
+
+    if (old_fltr == NULL || old_fltr[strspn (old_fltr, "*")] == '\0')
+        return TRUE;
+    if (new_fltr == NULL)
+        return FALSE;
+    if (strcmp (old_fltr, new_fltr) == 0)
+        return TRUE;
+    /* see mc_search__glob_translate_to_regex() */
+    if (strpbrk (old_fltr, DIR_FILTER_SPECIAL_CHARS) != NULL
+        || strpbrk (new_fltr, DIR_FILTER_SPECIAL_CHARS) != NULL)
+        return FALSE;
+
+    olds = g_strsplit (old_fltr, "*", -1);
+    news = g_strsplit (new_fltr, "*", -1);
+    n = g_strv_length (olds) - 1;
+    m = g_strv_length (news) - 1;
+
+    /* the new pattern starts and ends with the same literal parts as the old one */
+    ret = n != 0 && m != 0 && g_str_has_prefix (news[0], olds[0])
+        && g_str_has_suffix (news[m], olds[n]);
+
+    /* middle literal parts of the old pattern are found in the same order in the new one,
+       each of them within one part, not overlapping the first and the last ones */
+    j = 0;
+    pos = strlen (olds[0]);
+    for (i = 1; ret && i < n; i++)
+    {
+        for (; j <= m; j++, pos = 0)
+        {
+            const char *found;
+
+            end = strlen (news[j]);
+            if (j == m)
+                end -= strlen (olds[n]);
+            if (pos > end)
+                continue;
+
+            found = g_strstr_len (news[j] + pos, end - pos, olds[i]);
+            if (found != NULL)
+            {
+                pos = (found - news[j]) + strlen (olds[i]);
+                break;
+            }
+        }
+
+        ret = j <= m;
+    }
+
+    g_strfreev (olds);
+    g_strfreev (news);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remove entries which are not matched by the filter from the loaded list. The order of other
+ * entries and their marks are kept. As on loading, directories are never removed.
+ *
+ * @param list directory list
+ * @param vpath directory, used to resolve symlinks (see dirlink.c)
+ * @param fltr file name filter, if NULL, then all names are matched
+ *
+ * @return TRUE if some entries were removed
+ */
+
+gboolean
+dir_list_filter (dir_list * list, const vfs_path_t * vpath, const char *fltr)
+{
+    dir_filter_t filter;
+    int i, j;
+
+    if (fltr == NULL)
+        return FALSE;
+
+    dir_filter_init (&filter, fltr);
+
+    for (i = j = 0; i < list->len; i++)
+    {
+        file_entry_t *fentry = &list->list[i];
+
+        if (!S_ISDIR (fentry->st.st_mode) && !dir_filter_match (&filter, fentry->fname))
+        {
+            if (fentry->f.link_unresolved != 0)
+                dir_entry_resolve_link (vpath, fentry);
+
+            if (fentry->f.link_to_dir == 0)
+            {
+                g_free (fentry->fname);
+                continue;
+            }
+        }
+
+        if (i != j)
+            list->list[j] = *fentry;
+        j++;
+    }
+
+    dir_filter_done (&filter);
+
+    if (j == list->len)
+        return FALSE;
+
+    list->len = j;
+    return TRUE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /** If fltr is null, then it is a match */
 
@@ -693,8 +1397,7 @@ dir_list_reload (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
                  const dir_sort_options_t * sort_op, const char *fltr)
 {
     DIR *dirp;
-    struct dirent *dp;
-    int i, link_to_dir, stale_link;
+    int i;
     struct stat st;
     int marked_cnt;
     GHashTable *marked_files;
@@ -710,33 +1413,20 @@ dir_list_reload (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
     }
 
     tree_store_start_check (vpath);
+    dir_list_notify (list, DIR_OPEN);
 
-    marked_files = g_hash_table_new (g_str_hash, g_str_equal);
-    alloc_dir_copy (list->len);
-    for (marked_cnt = i = 0; i < list->len; i++)
-    {
-        file_entry_t *fentry, *dfentry;
-
-        fentry = &list->list[i];
-        dfentry = &dir_copy.list[i];
-
-        dfentry->fnamelen = fentry->fnamelen;
-        dfentry->fname = g_strndup (fentry->fname, fentry->fnamelen);
-        dfentry->f.marked = fentry->f.marked;
-        dfentry->f.dir_size_computed = fentry->f.dir_size_computed;
-        dfentry->f.link_to_dir = fentry->f.link_to_dir;
-        dfentry->f.stale_link = fentry->f.stale_link;
-        dfentry->sort_key = NULL;
-        dfentry->second_sort_key = NULL;
-        if (fentry->f.marked)
+    /* remember names of marked entries to restore marks after reload */
+    marked_cnt = 0;
+    marked_files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    for (i = 0; i < list->len; i++)
+        if (list->list[i].f.marked != 0)
         {
-            g_hash_table_insert (marked_files, dfentry->fname, dfentry);
+            char *fname;
+
+            fname = g_strndup (list->list[i].fname, list->list[i].fnamelen);
+            g_hash_table_insert (marked_files, fname, fname);
             marked_cnt++;
         }
-    }
-
-    /* save len for later dir_list_clean() */
-    dir_copy.len = list->len;
 
     /* Add ".." except to the root directory. The ".." entry
        (if any) must be the first in the list. */
@@ -751,7 +1441,8 @@ dir_list_reload (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
         dir_list_clean (list);
         if (!dir_list_init (list))
         {
-            dir_list_clean (&dir_copy);
+            g_hash_table_destroy (marked_files);
+            dir_list_notify (list, DIR_CLOSE);
             return;
         }
 
@@ -764,55 +1455,32 @@ dir_list_reload (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
         }
     }
 
-    while ((dp = mc_readdir (dirp)) != NULL)
+    if (!dir_list_read (list, dirp, vpath, fltr, marked_files, &marked_cnt))
     {
-        file_entry_t *fentry;
-
-        if (!handle_dirent (dp, fltr, &st, &link_to_dir, &stale_link))
-            continue;
-
-        if (!dir_list_append (list, dp->d_name, &st, link_to_dir != 0, stale_link != 0))
-        {
-            mc_closedir (dirp);
-            /* Norbert (Feb 12, 1997):
-               Just in case someone finds this memory leak:
-               -1 means big trouble (at the moment no memory left),
-               I don't bother with further cleanup because if one gets to
-               this point he will have more problems than a few memory
-               leaks and because one 'dir_list_clean' would not be enough (and
-               because I don't want to spent the time to make it working,
-               IMHO it's not worthwhile).
-               dir_list_clean (&dir_copy);
-             */
-            tree_store_end_check ();
-            g_hash_table_destroy (marked_files);
-            return;
-        }
-        fentry = &list->list[list->len - 1];
-
-        fentry->f.marked = 0;
-
-        /*
-         * If we have marked files in the copy, scan through the copy
-         * to find matching file.  Decrease number of remaining marks if
-         * we copied one.
+        mc_closedir (dirp);
+        /* Norbert (Feb 12, 1997):
+           Just in case someone finds this memory leak:
+           -1 means big trouble (at the moment no memory left),
+           I don't bother with further cleanup because if one gets to
+           this point he will have more problems than a few memory
+           leaks and because one 'dir_list_clean' would not be enough (and
+           because I don't want to spent the time to make it working,
+           IMHO it's not worthwhile).
+           dir_list_clean (&dir_copy);
          */
-        if (marked_cnt > 0 && g_hash_table_lookup (marked_files, dp->d_name) != NULL)
-        {
-            fentry->f.marked = 1;
-            marked_cnt--;
-        }
-
-        if ((list->len & 15) == 0)
-            rotate_dash (TRUE);
+        tree_store_end_check ();
+        g_hash_table_destroy (marked_files);
+        dir_list_notify (list, DIR_CLOSE);
+        return;
     }
+
     mc_closedir (dirp);
     tree_store_end_check ();
     g_hash_table_destroy (marked_files);
 
     dir_list_sort (list, sort, sort_op);
 
-    dir_list_clean (&dir_copy);
+    dir_list_notify (list, DIR_CLOSE);
     rotate_dash (FALSE);
 }
 
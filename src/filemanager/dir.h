@@ -18,8 +18,21 @@
 
 /*** enums ***************************************************************************************/
 
+typedef enum
+{
+    DIR_OPEN = 0,               /**< directory is opened */
+    DIR_READ,                   /**< an entry is read */
+    DIR_CLOSE                   /**< directory is loaded and sorted */
+} dir_list_cb_state_t;
+
 /*** structures declarations (and typedefs of structures)*****************************************/
 
+/**
+ * Callback to be called while the directory is loaded.
+ * On DIR_READ it may return FALSE to stop reading: entries read so far are kept.
+ */
+typedef gboolean (*dir_list_cb_fn) (dir_list_cb_state_t state, void *data);
+
 /**
  * A structure to represent directory content
  */
@@ -28,6 +41,8 @@ typedef struct
     file_entry_t *list; /**< list of file_entry_t objects */
     int size;           /**< number of allocated elements in list (capacity) */
     int len;            /**< number of used elements in list */
+    dir_list_cb_fn callback;    /**< called while the directory is loaded, may be NULL */
+    void *callback_data;        /**< data passed to callback */
 } dir_list;
 
 /**
@@ -52,10 +67,15 @@ void dir_list_load (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort
                     const dir_sort_options_t * sort_op, const char *fltr);
 void dir_list_reload (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
                       const dir_sort_options_t * sort_op, const char *fltr);
+gboolean dir_list_update (dir_list * list, const vfs_path_t * vpath, GHashTable * names,
+                          GCompareFunc sort, const dir_sort_options_t * sort_op, const char *fltr);
 void dir_list_sort (dir_list * list, GCompareFunc sort, const dir_sort_options_t * sort_op);
 gboolean dir_list_init (dir_list * list);
 void dir_list_clean (dir_list * list);
 gboolean handle_path (const char *path, struct stat *buf1, int *link_to_dir, int *stale_link);
+void dir_entry_resolve_link (const vfs_path_t * dir_vpath, file_entry_t * fentry);
+gboolean dir_filter_is_narrower (const char *old_fltr, const char *new_fltr);
+gboolean dir_list_filter (dir_list * list, const vfs_path_t * vpath, const char *fltr);
 
 /* Sorting functions */
 int unsorted (file_entry_t * a, file_entry_t * b);
@@ -72,9 +92,16 @@ gboolean if_link_is_exe (const vfs_path_t * full_name, const file_entry_t * file
 
 /*** inline functions ****************************************************************************/
 
+/**
+ * Check whether the entry of the current directory is a link to directory.
+ * The target of the link is stat'ed now if it wasn't resolved yet.
+ */
 static inline gboolean
-link_isdir (const file_entry_t * file)
+link_isdir (file_entry_t * file)
 {
+    if (file->f.link_unresolved != 0)
+        dir_entry_resolve_link (NULL, file);
+
     return (gboolean) file->f.link_to_dir;
 }
 
@@ -0,0 +1,339 @@
+/*
+   Cache of recently visited directory listings
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file src/filemanager/dircache.c
+ *  \brief Source: cache of recently visited directory listings
+ *
+ *  When a panel leaves a directory, its listing is kept in compact form (dir_compact_t).
+ *  When the panel comes back, the listing is taken from the cache instead of reading
+ *  the directory again, if the modification and change times of the directory are
+ *  the same as they were when the listing was loaded. The least recently used listings
+ *  are dropped when the cache exceeds dir_cache_size kilobytes.
+ *
+ *  Times of the directory don't change when a file in it is modified in place. If the listing
+ *  was kept up to date by the panel, the directory is watched while the listing is cached,
+ *  and the listing is dropped on any change. Otherwise, entries are checked with lstat()
+ *  when the listing is reused: reading of the directory is saved, but not the stat calls.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+#include "src/setup.h"          /* dir_cache_size, panels_options */
+
+#include "dir.h"
+#include "dircompact.h"
+#include "dircache.h"
+#include "dirwatch.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/*** file scope type declarations ****************************************************************/
+
+typedef struct
+{
+    char *path;                 /* key */
+    char *fltr;                 /* filter which was used to load the listing */
+    gboolean show_dot_files;    /* panel options which were used to load the listing */
+    gboolean show_backups;
+    struct stat dir_st;         /* stat of directory when the listing was loaded */
+    dir_compact_t *snapshot;
+    gsize memory;
+    dir_watch_t *watch;         /* NULL if entries are checked when the listing is reused */
+} dir_cache_entry_t;
+
+/*** file scope variables ************************************************************************/
+
+/* entries, most recently used first */
+static GQueue cache = G_QUEUE_INIT;
+static dir_cache_stats_t stats;
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_cache_entry_free (dir_cache_entry_t * entry)
+{
+    g_free (entry->path);
+    g_free (entry->fltr);
+    dir_watch_free (entry->watch);
+    dir_compact_free (entry->snapshot);
+    g_free (entry);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static GList *
+dir_cache_find (const char *path)
+{
+    GList *l;
+
+    for (l = cache.head; l != NULL; l = g_list_next (l))
+        if (strcmp (((dir_cache_entry_t *) l->data)->path, path) == 0)
+            return l;
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static GList *
+dir_cache_find_watch (const dir_watch_t * watch)
+{
+    GList *l;
+
+    for (l = cache.head; l != NULL; l = g_list_next (l))
+        if (((dir_cache_entry_t *) l->data)->watch == watch)
+            return l;
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_cache_unlink (GList * link)
+{
+    dir_cache_entry_t *entry = (dir_cache_entry_t *) link->data;
+
+    stats.count--;
+    stats.memory -= entry->memory;
+    g_queue_delete_link (&cache, link);
+    dir_cache_entry_free (entry);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+dir_cache_entry_is_valid (const dir_cache_entry_t * entry, const char *fltr,
+                          const struct stat *dir_st)
+{
+    return (entry->dir_st.st_mtime == dir_st->st_mtime
+            && entry->dir_st.st_ctime == dir_st->st_ctime
+            && entry->dir_st.st_ino == dir_st->st_ino
+            && entry->dir_st.st_dev == dir_st->st_dev
+            && entry->show_dot_files == panels_options.show_dot_files
+            && entry->show_backups == panels_options.show_backups
+            && g_strcmp0 (entry->fltr, fltr) == 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Check that entries of the listing weren't changed in place */
+
+static gboolean
+dir_cache_entries_are_valid (const dir_cache_entry_t * entry, const vfs_path_t * vpath)
+{
+    const dir_compact_t *dc = entry->snapshot;
+    int i;
+
+    if (entry->watch != NULL)
+        return !dir_watch_has_changes (entry->watch);
+
+    for (i = 0; i < dc->len; i++)
+    {
+        const char *fname;
+        vfs_path_t *tmp_vpath;
+        struct stat st;
+        gboolean same;
+
+        fname = dir_compact_get_name (dc, i);
+        if (DIR_IS_DOTDOT (fname))
+            continue;
+
+        tmp_vpath = vfs_path_append_new (vpath, fname, (char *) NULL);
+        same = mc_lstat (tmp_vpath, &st) == 0 && st.st_ino == dc->ino[i]
+            && st.st_mode == dc->mode[i] && st.st_size == dc->fsize[i]
+            && st.st_mtime == dc->mtime[i] && st.st_ctime == dc->ctime[i];
+        vfs_path_free (tmp_vpath);
+
+        if (!same)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Drop the listing when the watched directory is changed */
+
+static gboolean
+dir_cache_watch_cb (dir_watch_t * watch, GHashTable * names, gboolean overflow)
+{
+    GList *link;
+
+    (void) names;
+    (void) overflow;
+
+    link = dir_cache_find_watch (watch);
+    if (link != NULL)
+        dir_cache_unlink (link);
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Keep the listing of directory.
+ *
+ * @param vpath directory
+ * @param fltr filter which was used to load the listing
+ * @param list the listing. Marks of entries are not kept
+ * @param dir_st stat of directory when the listing was loaded. If times are zero,
+ *               the listing can't be validated and it isn't kept
+ * @param up_to_date TRUE if all changes of the directory since the listing was loaded
+ *                   were applied to it, so it's enough to watch the directory from now on
+ */
+
+void
+dir_cache_put (const vfs_path_t * vpath, const char *fltr, const dir_list * list,
+               const struct stat *dir_st, gboolean up_to_date)
+{
+    dir_cache_entry_t *entry;
+    gsize budget;
+    int i;
+
+    dir_cache_remove (vpath);
+
+    if (dir_cache_size <= 0 || dir_st->st_mtime == 0 || list->len == 0)
+        return;
+
+    budget = (gsize) dir_cache_size * 1024;
+
+    entry = g_new0 (dir_cache_entry_t, 1);
+    entry->path = g_strdup (vfs_path_as_str (vpath));
+    entry->fltr = g_strdup (fltr);
+    entry->show_dot_files = panels_options.show_dot_files;
+    entry->show_backups = panels_options.show_backups;
+    entry->dir_st = *dir_st;
+    entry->snapshot = dir_compact_from_list (list);
+    for (i = 0; entry->snapshot->marked != 0 && i < entry->snapshot->len; i++)
+        dir_compact_set_marked (entry->snapshot, i, FALSE);
+    entry->memory = dir_compact_memory (entry->snapshot);
+    if (up_to_date)
+        entry->watch = dir_watch_new (vpath, dir_cache_watch_cb);
+
+    if (entry->memory > budget)
+    {
+        dir_cache_entry_free (entry);
+        return;
+    }
+
+    g_queue_push_head (&cache, entry);
+    stats.count++;
+    stats.memory += entry->memory;
+
+    while (stats.memory > budget)
+    {
+        dir_cache_unlink (cache.tail);
+        stats.evictions++;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the listing of directory if it is cached and neither the directory nor its entries
+ * were changed since.
+ *
+ * @param vpath directory
+ * @param fltr filter which is used to load the listing
+ * @param list empty directory list to be filled, it should be sorted by caller
+ * @param dir_st stat of directory is returned here
+ *
+ * @return TRUE if the listing was found
+ */
+
+gboolean
+dir_cache_get (const vfs_path_t * vpath, const char *fltr, dir_list * list, struct stat *dir_st)
+{
+    GList *link;
+    dir_cache_entry_t *entry;
+
+    link = dir_cache_find (vfs_path_as_str (vpath));
+    if (link == NULL)
+    {
+        stats.misses++;
+        return FALSE;
+    }
+
+    entry = (dir_cache_entry_t *) link->data;
+
+    if (mc_stat (vpath, dir_st) != 0 || !dir_cache_entry_is_valid (entry, fltr, dir_st)
+        || !dir_cache_entries_are_valid (entry, vpath))
+    {
+        dir_cache_unlink (link);
+        stats.misses++;
+        return FALSE;
+    }
+
+    if (!dir_compact_to_list (entry->snapshot, list))
+    {
+        stats.misses++;
+        return FALSE;
+    }
+
+    /* most recently used */
+    g_queue_unlink (&cache, link);
+    g_queue_push_head_link (&cache, link);
+
+    stats.hits++;
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+dir_cache_remove (const vfs_path_t * vpath)
+{
+    GList *link;
+
+    link = dir_cache_find (vfs_path_as_str (vpath));
+    if (link != NULL)
+        dir_cache_unlink (link);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+dir_cache_clear (void)
+{
+    while (cache.head != NULL)
+        dir_cache_unlink (cache.head);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+dir_cache_get_stats (dir_cache_stats_t * s)
+{
+    *s = stats;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,44 @@
+/** \file dircache.h
+ *  \brief Header: cache of recently visited directory listings
+ */
+
+#ifndef MC__DIRCACHE_H
+#define MC__DIRCACHE_H
+
+#include <sys/stat.h>
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+#include "dir.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct
+{
+    guint hits;                 /**< listings taken from the cache */
+    guint misses;               /**< listings not found in the cache or outdated */
+    guint evictions;            /**< listings removed to stay within the memory budget */
+    guint count;                /**< number of cached listings */
+    gsize memory;               /**< memory used by cached listings, in bytes */
+} dir_cache_stats_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+void dir_cache_put (const vfs_path_t * vpath, const char *fltr, const dir_list * list,
+                    const struct stat *dir_st, gboolean up_to_date);
+gboolean dir_cache_get (const vfs_path_t * vpath, const char *fltr, dir_list * list,
+                        struct stat *dir_st);
+void dir_cache_remove (const vfs_path_t * vpath);
+void dir_cache_clear (void);
+void dir_cache_get_stats (dir_cache_stats_t * stats);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__DIRCACHE_H */
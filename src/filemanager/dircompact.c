@@ -0,0 +1,349 @@
+/*
+   Compact storage of directory content
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file src/filemanager/dircompact.c
+ *  \brief Source: compact storage of directory content
+ *
+ *  See dir_compact_t for what it is used for.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include "lib/global.h"
+#include "lib/util.h"
+
+#include "dir.h"
+#include "dircompact.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define DIR_COMPACT_MIN_SIZE 128
+#define DIR_COMPACT_NAME_SIZE 16        /* expected average length of name */
+
+#define MARK_WORDS(n) (((n) + 31) / 32)
+
+/*** file scope type declarations ****************************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_compact_resize (dir_compact_t * dc, int capacity)
+{
+    int old_words, new_words;
+
+    old_words = MARK_WORDS (dc->capacity);
+    new_words = MARK_WORDS (capacity);
+
+    dc->name_offset = g_renew (gsize, dc->name_offset, capacity);
+    dc->name_len = g_renew (guint32, dc->name_len, capacity);
+    dc->mode = g_renew (mode_t, dc->mode, capacity);
+    dc->nlink = g_renew (nlink_t, dc->nlink, capacity);
+    dc->uid = g_renew (uid_t, dc->uid, capacity);
+    dc->gid = g_renew (gid_t, dc->gid, capacity);
+    dc->fsize = g_renew (off_t, dc->fsize, capacity);
+    dc->atime = g_renew (time_t, dc->atime, capacity);
+    dc->mtime = g_renew (time_t, dc->mtime, capacity);
+    dc->ctime = g_renew (time_t, dc->ctime, capacity);
+    dc->ino = g_renew (ino_t, dc->ino, capacity);
+    dc->dev = g_renew (dev_t, dc->dev, capacity);
+    dc->rdev = g_renew (dev_t, dc->rdev, capacity);
+    dc->flags = g_renew (guint8, dc->flags, capacity);
+    dc->marks = g_renew (guint32, dc->marks, new_words);
+    if (new_words > old_words)
+        memset (dc->marks + old_words, 0, (new_words - old_words) * sizeof (guint32));
+
+    dc->capacity = capacity;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create new compact directory list.
+ *
+ * @param capacity expected number of entries
+ *
+ * @return new empty list
+ */
+
+dir_compact_t *
+dir_compact_new (int capacity)
+{
+    dir_compact_t *dc;
+
+    if (capacity < DIR_COMPACT_MIN_SIZE)
+        capacity = DIR_COMPACT_MIN_SIZE;
+
+    dc = g_new0 (dir_compact_t, 1);
+    dc->names = g_string_sized_new ((gsize) capacity * DIR_COMPACT_NAME_SIZE);
+    dir_compact_resize (dc, capacity);
+
+    return dc;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+dir_compact_free (dir_compact_t * dc)
+{
+    if (dc == NULL)
+        return;
+
+    g_string_free (dc->names, TRUE);
+    g_free (dc->name_offset);
+    g_free (dc->name_len);
+    g_free (dc->mode);
+    g_free (dc->nlink);
+    g_free (dc->uid);
+    g_free (dc->gid);
+    g_free (dc->fsize);
+    g_free (dc->atime);
+    g_free (dc->mtime);
+    g_free (dc->ctime);
+    g_free (dc->ino);
+    g_free (dc->dev);
+    g_free (dc->rdev);
+    g_free (dc->flags);
+    g_free (dc->marks);
+    g_free (dc);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remove all entries but keep allocated memory for reuse.
+ */
+
+void
+dir_compact_clear (dir_compact_t * dc)
+{
+    g_string_set_size (dc->names, 0);
+    memset (dc->marks, 0, MARK_WORDS (dc->capacity) * sizeof (guint32));
+    dc->marked = 0;
+    dc->len = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Append an entry.
+ *
+ * @param dc compact directory list
+ * @param fname name of entry
+ * @param fnamelen length of @fname
+ * @param st stat info of entry
+ * @param flags DIR_COMPACT_* bits
+ *
+ * @return index of new entry
+ */
+
+int
+dir_compact_append (dir_compact_t * dc, const char *fname, size_t fnamelen,
+                    const struct stat *st, guint8 flags)
+{
+    int i;
+
+    if (dc->len == dc->capacity)
+        dir_compact_resize (dc, dc->capacity * 2);
+
+    i = dc->len++;
+
+    dc->name_offset[i] = dc->names->len;
+    dc->name_len[i] = (guint32) fnamelen;
+    g_string_append_len (dc->names, fname, fnamelen);
+    g_string_append_c (dc->names, '\0');
+
+    dc->mode[i] = st->st_mode;
+    dc->nlink[i] = st->st_nlink;
+    dc->uid[i] = st->st_uid;
+    dc->gid[i] = st->st_gid;
+    dc->fsize[i] = st->st_size;
+    dc->atime[i] = st->st_atime;
+    dc->mtime[i] = st->st_mtime;
+    dc->ctime[i] = st->st_ctime;
+    dc->ino[i] = st->st_ino;
+    dc->dev[i] = st->st_dev;
+    dc->rdev[i] = st->st_rdev;
+    dc->flags[i] = flags;
+
+    return i;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Make compact copy of directory list. Marks of entries are kept.
+ *
+ * @param list directory list
+ *
+ * @return new compact list
+ */
+
+dir_compact_t *
+dir_compact_from_list (const dir_list * list)
+{
+    dir_compact_t *dc;
+    int i;
+
+    dc = dir_compact_new (list->len);
+
+    for (i = 0; i < list->len; i++)
+    {
+        const file_entry_t *fe = &list->list[i];
+        guint8 flags = 0;
+        int n;
+
+        if (fe->f.link_to_dir != 0)
+            flags |= DIR_COMPACT_LINK_TO_DIR;
+        if (fe->f.stale_link != 0)
+            flags |= DIR_COMPACT_STALE_LINK;
+        if (fe->f.dir_size_computed != 0)
+            flags |= DIR_COMPACT_DIR_SIZE_COMPUTED;
+        if (fe->f.link_unresolved != 0)
+            flags |= DIR_COMPACT_LINK_UNRESOLVED;
+
+        n = dir_compact_append (dc, fe->fname, fe->fnamelen, &fe->st, flags);
+        if (fe->f.marked != 0)
+            dir_compact_set_marked (dc, n, TRUE);
+    }
+
+    return dc;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Append all entries of compact list to directory list. Marks of entries are kept.
+ *
+ * @param dc compact directory list
+ * @param list directory list
+ *
+ * @return FALSE on failure, TRUE on success
+ */
+
+gboolean
+dir_compact_to_list (const dir_compact_t * dc, dir_list * list)
+{
+    int i, room;
+
+    room = list->size - list->len;
+    if (room < dc->len && !dir_list_grow (list, dc->len - room))
+        return FALSE;
+
+    for (i = 0; i < dc->len; i++)
+    {
+        file_entry_t *fe;
+
+        fe = &list->list[list->len++];
+        dir_compact_get_entry (dc, i, fe);
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Restore stat info of entry. Fields which are not kept are zeroed.
+ */
+
+void
+dir_compact_get_stat (const dir_compact_t * dc, int i, struct stat *st)
+{
+    memset (st, 0, sizeof (*st));
+
+    st->st_mode = dc->mode[i];
+    st->st_nlink = dc->nlink[i];
+    st->st_uid = dc->uid[i];
+    st->st_gid = dc->gid[i];
+    st->st_size = dc->fsize[i];
+    st->st_atime = dc->atime[i];
+    st->st_mtime = dc->mtime[i];
+    st->st_ctime = dc->ctime[i];
+    st->st_ino = dc->ino[i];
+    st->st_dev = dc->dev[i];
+    st->st_rdev = dc->rdev[i];
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Expand entry to file_entry_t. The name is duplicated and must be freed by caller.
+ */
+
+void
+dir_compact_get_entry (const dir_compact_t * dc, int i, file_entry_t * fe)
+{
+    fe->fnamelen = dc->name_len[i];
+    fe->fname = g_strndup (dir_compact_get_name (dc, i), fe->fnamelen);
+    dir_compact_get_stat (dc, i, &fe->st);
+    fe->sort_key = NULL;
+    fe->second_sort_key = NULL;
+    fe->f.marked = dir_compact_is_marked (dc, i) ? 1 : 0;
+    fe->f.link_to_dir = (dc->flags[i] & DIR_COMPACT_LINK_TO_DIR) != 0 ? 1 : 0;
+    fe->f.stale_link = (dc->flags[i] & DIR_COMPACT_STALE_LINK) != 0 ? 1 : 0;
+    fe->f.dir_size_computed = (dc->flags[i] & DIR_COMPACT_DIR_SIZE_COMPUTED) != 0 ? 1 : 0;
+    fe->f.link_unresolved = (dc->flags[i] & DIR_COMPACT_LINK_UNRESOLVED) != 0 ? 1 : 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+dir_compact_set_marked (dir_compact_t * dc, int i, gboolean marked)
+{
+    guint32 bit;
+
+    bit = 1U << (i % 32);
+
+    if (marked && (dc->marks[i / 32] & bit) == 0)
+    {
+        dc->marks[i / 32] |= bit;
+        dc->marked++;
+    }
+    else if (!marked && (dc->marks[i / 32] & bit) != 0)
+    {
+        dc->marks[i / 32] &= ~bit;
+        dc->marked--;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get amount of memory allocated for compact list.
+ */
+
+gsize
+dir_compact_memory (const dir_compact_t * dc)
+{
+    gsize entry;
+
+    entry = sizeof (gsize) + sizeof (guint32) + sizeof (mode_t) + sizeof (nlink_t)
+        + sizeof (uid_t) + sizeof (gid_t) + sizeof (off_t) + 3 * sizeof (time_t)
+        + sizeof (ino_t) + 2 * sizeof (dev_t) + sizeof (guint8);
+
+    return sizeof (*dc) + dc->names->allocated_len + entry * (gsize) dc->capacity
+        + MARK_WORDS (dc->capacity) * sizeof (guint32);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,107 @@
+/** \file dircompact.h
+ *  \brief Header: compact storage of directory content
+ */
+
+#ifndef MC__DIRCOMPACT_H
+#define MC__DIRCOMPACT_H
+
+#include <sys/stat.h>
+
+#include "lib/global.h"
+#include "lib/util.h"
+
+#include "dir.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* bits of dir_compact_t::flags */
+#define DIR_COMPACT_LINK_TO_DIR (1 << 0)
+#define DIR_COMPACT_STALE_LINK (1 << 1)
+#define DIR_COMPACT_DIR_SIZE_COMPUTED (1 << 2)
+#define DIR_COMPACT_LINK_UNRESOLVED (1 << 3)
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/**
+ * Compact representation of directory content.
+ *
+ * Unlike dir_list, which keeps a file_entry_t with the full struct stat and a separately
+ * allocated name for each entry, names are kept in one string arena, only those stat fields
+ * that are used by panels are kept in parallel arrays, and marks are kept in a bitmap.
+ *
+ * It's used for listings kept besides the one shown in a panel: the saved panelized listing,
+ * cached listings of visited directories and the unfiltered listing. The listing shown in
+ * a panel is still a dir_list.
+ */
+typedef struct
+{
+    int len;                    /**< number of entries */
+    int capacity;               /**< number of allocated entries */
+
+    GString *names;             /**< names of entries, each one is terminated with '\0' */
+    gsize *name_offset;         /**< offset of name of entry in names */
+    guint32 *name_len;          /**< length of name of entry */
+
+    /* stat info */
+    mode_t *mode;
+    nlink_t *nlink;
+    uid_t *uid;
+    gid_t *gid;
+    off_t *fsize;
+    time_t *atime;
+    time_t *mtime;
+    time_t *ctime;
+    ino_t *ino;
+    dev_t *dev;
+    dev_t *rdev;
+
+    guint8 *flags;              /**< DIR_COMPACT_* bits */
+    guint32 *marks;             /**< bitmap of marked entries */
+    int marked;                 /**< number of marked entries */
+} dir_compact_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+dir_compact_t *dir_compact_new (int capacity);
+void dir_compact_free (dir_compact_t * dc);
+void dir_compact_clear (dir_compact_t * dc);
+int dir_compact_append (dir_compact_t * dc, const char *fname, size_t fnamelen,
+                        const struct stat *st, guint8 flags);
+dir_compact_t *dir_compact_from_list (const dir_list * list);
+gboolean dir_compact_to_list (const dir_compact_t * dc, dir_list * list);
+void dir_compact_get_stat (const dir_compact_t * dc, int i, struct stat *st);
+void dir_compact_get_entry (const dir_compact_t * dc, int i, file_entry_t * fe);
+void dir_compact_set_marked (dir_compact_t * dc, int i, gboolean marked);
+gsize dir_compact_memory (const dir_compact_t * dc);
+
+/*** inline functions ****************************************************************************/
+
+static inline const char *
+dir_compact_get_name (const dir_compact_t * dc, int i)
+{
+    return dc->names->str + dc->name_offset[i];
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline gboolean
+dir_compact_is_marked (const dir_compact_t * dc, int i)
+{
+    return (dc->marks[i / 32] & (1U << (i % 32))) != 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline gboolean
+dir_compact_is_dir (const dir_compact_t * dc, int i)
+{
+    return S_ISDIR (dc->mode[i]) || (dc->flags[i] & DIR_COMPACT_LINK_TO_DIR) != 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#endif /* MC__DIRCOMPACT_H */
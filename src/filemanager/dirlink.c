@@ -0,0 +1,399 @@
+/*
+   Resolving of symlink targets in background
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file src/filemanager/dirlink.c
+ *  \brief Source: resolving of symlink targets in background
+ *
+ *  Symlinks may point to slow or automounted filesystems, so their targets are not
+ *  stat'ed while a local directory is read. Instead, the panel asks to resolve links
+ *  which are shown or needed for sorting. Targets are stat'ed by a pool of threads
+ *  (up to dir_stat_threads) and results are passed back to the main loop through
+ *  a pipe (add_select_channel()). Requests for visible entries go first.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+#include "lib/tty/key.h"        /* add_select_channel(), delete_select_channel() */
+#include "lib/vfs/vfs.h"
+
+#include "src/setup.h"          /* dir_stat_threads, panels_options */
+
+#include "dirlink.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/*** file scope type declarations ****************************************************************/
+
+struct dir_link_resolver_struct
+{
+    char *path;                 /* local path of the directory */
+    dir_link_cb_fn callback;
+    GHashTable *pending;        /* names requested and not resolved yet -> urgent flag */
+    int refcount;               /* the resolver and its tasks, changed in the main thread only */
+    volatile gint cancelled;
+};
+
+#ifdef HAVE_GLIB_THREADS
+/* Request for the worker pool */
+typedef struct
+{
+    dir_link_t link;            /* must be first: results are passed to the callback as is */
+    dir_link_resolver_t *resolver;
+    char *path;                 /* full path of the link */
+    gboolean urgent;
+    guint serial;
+} dir_link_task_t;
+#endif
+
+/*** file scope variables ************************************************************************/
+
+#ifdef HAVE_GLIB_THREADS
+static GThreadPool *pool = NULL;
+static GAsyncQueue *results = NULL;
+static int wakeup_pipe[2] = { -1, -1 };
+
+static int resolvers = 0;       /* number of resolvers alive */
+static int outstanding = 0;     /* number of tasks pushed to the pool and not handled yet */
+static guint serial = 0;
+#endif
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_GLIB_THREADS
+
+static void
+dir_link_resolver_unref (dir_link_resolver_t * resolver)
+{
+    if (--resolver->refcount > 0)
+        return;
+
+    g_free (resolver->path);
+    g_hash_table_destroy (resolver->pending);
+    g_free (resolver);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_link_task_free (dir_link_task_t * task)
+{
+    dir_link_resolver_unref (task->resolver);
+    g_free (task->link.fname);
+    g_free (task->path);
+    g_free (task);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Urgent tasks first, then in order of requests */
+
+static gint
+dir_link_task_cmp (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    const dir_link_task_t *ta = (const dir_link_task_t *) a;
+    const dir_link_task_t *tb = (const dir_link_task_t *) b;
+
+    (void) user_data;
+
+    if (ta->urgent != tb->urgent)
+        return ta->urgent ? -1 : 1;
+
+    return ta->serial < tb->serial ? -1 : (ta->serial > tb->serial ? 1 : 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Task of the worker pool. Only syscalls are made here: neither the VFS nor the UI may be
+ * touched from the workers.
+ */
+
+static void
+dir_link_worker (gpointer data, gpointer user_data)
+{
+    dir_link_task_t *task = (dir_link_task_t *) data;
+    char c = 0;
+
+    (void) user_data;
+
+    if (g_atomic_int_get (&task->resolver->cancelled) == 0)
+    {
+        struct stat st;
+
+        if (stat (task->path, &st) == 0)
+            task->link.link_to_dir = S_ISDIR (st.st_mode);
+        else
+            task->link.stale_link = TRUE;
+    }
+
+    g_async_queue_push (results, task);
+
+    while (write (wakeup_pipe[1], &c, 1) == -1 && errno == EINTR)
+        ;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_link_done (void)
+{
+    if (pool == NULL || resolvers != 0 || outstanding != 0)
+        return;
+
+    g_thread_pool_free (pool, FALSE, TRUE);
+    pool = NULL;
+    g_async_queue_unref (results);
+    results = NULL;
+
+    delete_select_channel (wakeup_pipe[0]);
+    close (wakeup_pipe[0]);
+    close (wakeup_pipe[1]);
+    wakeup_pipe[0] = wakeup_pipe[1] = -1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Pass resolved links to the owners of resolvers */
+
+static int
+dir_link_results_cb (int fd, void *info)
+{
+    char buf[256];
+    GSList *owners = NULL;
+    GSList *l;
+    dir_link_task_t *task;
+
+    (void) info;
+
+    while (read (fd, buf, sizeof (buf)) > 0)
+        ;
+
+    /* group results by resolvers */
+    while ((task = (dir_link_task_t *) g_async_queue_try_pop (results)) != NULL)
+    {
+        dir_link_resolver_t *resolver = task->resolver;
+        GPtrArray *links;
+
+        outstanding--;
+
+        if (resolver->cancelled != 0)
+        {
+            dir_link_task_free (task);
+            continue;
+        }
+
+        g_hash_table_remove (resolver->pending, task->link.fname);
+
+        for (l = owners; l != NULL; l = g_slist_next (l))
+            if (((dir_link_task_t *) g_ptr_array_index ((GPtrArray *) l->data, 0))->resolver ==
+                resolver)
+                break;
+
+        if (l != NULL)
+            links = (GPtrArray *) l->data;
+        else
+        {
+            links = g_ptr_array_new_with_free_func ((GDestroyNotify) dir_link_task_free);
+            owners = g_slist_prepend (owners, links);
+        }
+
+        g_ptr_array_add (links, task);
+    }
+
+    for (l = owners; l != NULL; l = g_slist_next (l))
+    {
+        GPtrArray *links = (GPtrArray *) l->data;
+        dir_link_resolver_t *resolver;
+
+        resolver = ((dir_link_task_t *) g_ptr_array_index (links, 0))->resolver;
+        /* the callback may free any resolver */
+        if (resolver->cancelled == 0)
+            resolver->callback (resolver, links);
+        g_ptr_array_free (links, TRUE);
+    }
+
+    g_slist_free (owners);
+
+    dir_link_done ();
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+dir_link_init (void)
+{
+    if (pool != NULL)
+        return TRUE;
+
+    if (pipe (wakeup_pipe) != 0)
+        return FALSE;
+
+    fcntl (wakeup_pipe[0], F_SETFL, O_NONBLOCK);
+    fcntl (wakeup_pipe[1], F_SETFL, O_NONBLOCK);
+    fcntl (wakeup_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl (wakeup_pipe[1], F_SETFD, FD_CLOEXEC);
+
+    results = g_async_queue_new ();
+    pool = g_thread_pool_new (dir_link_worker, NULL, MAX (dir_stat_threads, 1), FALSE, NULL);
+    g_thread_pool_set_sort_function (pool, dir_link_task_cmp, NULL);
+
+    add_select_channel (wakeup_pipe[0], dir_link_results_cb, NULL);
+
+    return TRUE;
+}
+
+#endif /* HAVE_GLIB_THREADS */
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether targets of symlinks in the directory may be resolved later by a resolver.
+ * It's possible for directories on the local filesystem only.
+ */
+
+gboolean
+dir_link_can_defer (const vfs_path_t * vpath)
+{
+#ifdef HAVE_GLIB_THREADS
+    return (panels_options.lazy_link_resolution && vfs_file_get_local_path (vpath) != NULL);
+#else
+    (void) vpath;
+
+    return FALSE;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create resolver of symlinks of the directory.
+ *
+ * @param vpath directory
+ * @param callback function to be called when some links have been resolved
+ *
+ * @return new resolver or NULL if links of the directory can't be resolved in background
+ */
+
+dir_link_resolver_t *
+dir_link_resolver_new (const vfs_path_t * vpath, dir_link_cb_fn callback)
+{
+#ifdef HAVE_GLIB_THREADS
+    dir_link_resolver_t *resolver;
+    const char *path;
+
+    path = vfs_file_get_local_path (vpath);
+    if (path == NULL || !dir_link_init ())
+        return NULL;
+
+    resolver = g_new0 (dir_link_resolver_t, 1);
+    resolver->path = g_strdup (path);
+    resolver->callback = callback;
+    resolver->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    resolver->refcount = 1;
+
+    resolvers++;
+
+    return resolver;
+#else
+    (void) vpath;
+    (void) callback;
+
+    return NULL;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Free the resolver. Pending requests are cancelled: their results are dropped.
+ */
+
+void
+dir_link_resolver_free (dir_link_resolver_t * resolver)
+{
+#ifdef HAVE_GLIB_THREADS
+    if (resolver == NULL)
+        return;
+
+    g_atomic_int_set (&resolver->cancelled, 1);
+    resolvers--;
+    dir_link_resolver_unref (resolver);
+    dir_link_done ();
+#else
+    (void) resolver;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Request resolving of the symlink. Repeated requests of the same link are ignored until
+ * it is resolved, unless the link becomes urgent.
+ *
+ * @param resolver the resolver
+ * @param fname name of the link in the directory
+ * @param index index of the entry in the list, passed back to the callback
+ * @param urgent if TRUE, the link is resolved before non-urgent ones (e.g. it's visible)
+ */
+
+void
+dir_link_resolve (dir_link_resolver_t * resolver, const char *fname, int index, gboolean urgent)
+{
+#ifdef HAVE_GLIB_THREADS
+    gpointer was_urgent;
+    dir_link_task_t *task;
+
+    if (g_hash_table_lookup_extended (resolver->pending, fname, NULL, &was_urgent)
+        && (!urgent || GPOINTER_TO_INT (was_urgent) != 0))
+        return;
+
+    g_hash_table_insert (resolver->pending, g_strdup (fname), GINT_TO_POINTER (urgent ? 1 : 0));
+
+    task = g_new0 (dir_link_task_t, 1);
+    task->link.fname = g_strdup (fname);
+    task->link.index = index;
+    task->resolver = resolver;
+    task->path = g_build_filename (resolver->path, fname, (char *) NULL);
+    task->urgent = urgent;
+    task->serial = serial++;
+
+    resolver->refcount++;
+    outstanding++;
+
+    if (!g_thread_pool_push (pool, task, NULL))
+        dir_link_worker (task, NULL);
+#else
+    (void) resolver;
+    (void) fname;
+    (void) index;
+    (void) urgent;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,51 @@
+/** \file dirlink.h
+ *  \brief Header: resolving of symlink targets in background
+ */
+
+#ifndef MC__DIRLINK_H
+#define MC__DIRLINK_H
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct dir_link_resolver_struct dir_link_resolver_t;
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/**
+ * Resolved symlink.
+ */
+typedef struct
+{
+    char *fname;                /**< name of the link in the directory */
+    int index;                  /**< index of the entry in the list when it was requested */
+    gboolean link_to_dir;       /**< the link points to a directory */
+    gboolean stale_link;        /**< the target doesn't exist */
+} dir_link_t;
+
+/**
+ * Called in the main loop when some symlinks have been resolved.
+ *
+ * @param resolver the resolver
+ * @param links array of dir_link_t: they are freed after return
+ */
+typedef void (*dir_link_cb_fn) (dir_link_resolver_t * resolver, GPtrArray * links);
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+gboolean dir_link_can_defer (const vfs_path_t * vpath);
+
+dir_link_resolver_t *dir_link_resolver_new (const vfs_path_t * vpath, dir_link_cb_fn callback);
+void dir_link_resolver_free (dir_link_resolver_t * resolver);
+void dir_link_resolve (dir_link_resolver_t * resolver, const char *fname, int index,
+                       gboolean urgent);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__DIRLINK_H */
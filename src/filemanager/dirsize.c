@@ -0,0 +1,970 @@
+/*
+   Parallel computing of sizes of local directories
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file src/filemanager/dirsize.c
+ *  \brief Source: parallel computing of sizes of local directories
+ *
+ *  "Show directory sizes" walks the tree with one stat() after another. On local
+ *  filesystems, directories of the tree are scanned by a pool of up to dir_stat_threads
+ *  threads instead: a task reads one directory and queues a new task for each of its
+ *  subdirectories, so idle threads take up the work found by busy ones. When all
+ *  subdirectories of a directory are done, its size is added to its parent.
+ *
+ *  Sizes of scanned directories are kept in a database keyed by device and inode, which
+ *  is loaded from MC_DIRSIZE_FILE on first use and saved there when MC exits. Each record
+ *  holds the size of the files of the directory itself and the size of the whole tree,
+ *  both valid while mtime of the directory is the same.
+ *
+ *  Files overwritten in place don't change mtime of their directory, and no change deep
+ *  in a tree changes mtime of its top. File operations of MC update sizes of all
+ *  directories containing the files they create, overwrite or remove
+ *  (dir_size_cache_update()); records of directories whose mtime is changed by that are
+ *  dropped, so only those directories are read again by the next scan. Rescanning of
+ *  panels makes all records unconfirmed (dir_size_cache_revalidate()), but keeps them.
+ *  Records loaded from the file are unconfirmed too, since other programs may have changed
+ *  their trees. Panels show sizes of confirmed records as computed and others as a hint
+ *  until the tree is scanned again. A scan takes the size of a subdirectory whose record
+ *  is confirmed and whose mtime is the same as it is, without reading its tree. Other
+ *  directories are read, but files are stat'ed only in directories whose mtime differs
+ *  from the record, whether it's confirmed or not: files overwritten in place by other
+ *  programs are not noticed.
+ *
+ *  Threads use plain syscalls: neither the VFS nor the UI may be touched from them.
+ */
+
+#include <config.h>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+#include "lib/fileloc.h"        /* MC_DIRSIZE_FILE */
+#include "lib/mcconfig.h"       /* mc_config_get_full_path() */
+#include "lib/vfs/vfs.h"
+
+#include "src/setup.h"          /* dir_stat_threads, dir_size_disk_usage */
+
+#include "dirsize.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* Time to wait for the end of scanning before returning to the caller (in microseconds) */
+#define DIR_SIZE_WAIT (G_USEC_PER_SEC / 25)
+
+/* Directories kept in the database at most */
+#define DIR_SIZE_CACHE_MAX 262144
+
+/* Records of directories not scanned for so long are not saved (in seconds) */
+#define DIR_SIZE_CACHE_KEEP (90 * 24 * 60 * 60)
+
+#define DIR_SIZE_SIGNATURE "MC dirsizes 1"
+
+/*** file scope type declarations ****************************************************************/
+
+#ifdef HAVE_GLIB_THREADS
+
+typedef struct
+{
+    dev_t dev;
+    ino_t ino;
+    time_t mtime;
+    time_t checked;             /* time of the scan */
+    gboolean confirmed;         /* scanned since panels were rescanned rather than loaded */
+    dir_size_t own;             /* files of the directory itself */
+    dir_size_t size;            /* the whole tree */
+} dir_size_cached_t;
+
+typedef struct dir_size_node_struct
+{
+    struct dir_size_node_struct *parent;
+    char *path;
+    dev_t dev;
+    ino_t ino;
+    time_t mtime;
+
+    /* changed under the lock of the scan */
+    dir_size_t own;
+    dir_size_t size;
+    gboolean incomplete;        /* some directories of the tree could not be read */
+
+    /* the task reading the directory and unfinished subdirectories */
+    volatile gint pending;
+} dir_size_node_t;
+
+#endif /* HAVE_GLIB_THREADS */
+
+struct dir_size_scan_struct
+{
+#ifdef HAVE_GLIB_THREADS
+    GThreadPool *pool;
+    GMutex lock;
+    GCond cond;                 /* signalled when the scan is finished */
+#endif
+
+    /* changed by threads under the lock */
+    dir_size_t size;            /* size of the tree when finished, progress until then */
+    char *current;              /* last directory read */
+    gboolean finished;
+
+    volatile gint cancelled;
+};
+
+/*** file scope variables ************************************************************************/
+
+#ifdef HAVE_GLIB_THREADS
+/* (dev, ino) -> dir_size_cached_t */
+static GHashTable *cache = NULL;
+static gboolean cache_loaded = FALSE;
+static gboolean cache_changed = FALSE;
+static GMutex cache_lock;
+#endif
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_GLIB_THREADS
+
+static guint
+dir_size_cached_hash (gconstpointer key)
+{
+    const dir_size_cached_t *c = (const dir_size_cached_t *) key;
+
+    return (guint) c->ino ^ (guint) c->dev;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+dir_size_cached_equal (gconstpointer a, gconstpointer b)
+{
+    const dir_size_cached_t *ca = (const dir_size_cached_t *) a;
+    const dir_size_cached_t *cb = (const dir_size_cached_t *) b;
+
+    return (ca->ino == cb->ino && ca->dev == cb->dev);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Read the database saved by dir_size_cache_save() */
+
+static void
+dir_size_cache_load (void)
+{
+    char *name;
+    FILE *f;
+    char line[BUF_MEDIUM];
+
+    name = mc_config_get_full_path (MC_DIRSIZE_FILE);
+    f = fopen (name, "r");
+    g_free (name);
+
+    if (f == NULL)
+        return;
+
+    if (fgets (line, sizeof (line), f) != NULL
+        && strncmp (line, DIR_SIZE_SIGNATURE, strlen (DIR_SIZE_SIGNATURE)) == 0)
+        while (g_hash_table_size (cache) < DIR_SIZE_CACHE_MAX && fgets (line, sizeof (line), f))
+        {
+            uintmax_t dev, ino, v[8];
+            intmax_t mtime, checked;
+            dir_size_cached_t *c;
+
+            if (sscanf (line, "%ju %ju %jd %jd %ju %ju %ju %ju %ju %ju %ju %ju", &dev, &ino,
+                        &mtime, &checked, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6],
+                        &v[7]) != 12)
+                continue;
+
+            c = g_new (dir_size_cached_t, 1);
+            c->dev = (dev_t) dev;
+            c->ino = (ino_t) ino;
+            c->mtime = (time_t) mtime;
+            c->checked = (time_t) checked;
+            c->confirmed = FALSE;
+            c->own.dirs = (size_t) v[0];
+            c->own.files = (size_t) v[1];
+            c->own.bytes = v[2];
+            c->own.disk = v[3];
+            c->size.dirs = (size_t) v[4];
+            c->size.files = (size_t) v[5];
+            c->size.bytes = v[6];
+            c->size.disk = v[7];
+            g_hash_table_replace (cache, c, c);
+        }
+
+    fclose (f);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Get the database, loading it if it's used for the first time. Must be called under the lock */
+
+static GHashTable *
+dir_size_cache_get (void)
+{
+    if (cache == NULL)
+        cache = g_hash_table_new_full (dir_size_cached_hash, dir_size_cached_equal, NULL, g_free);
+
+    if (!cache_loaded)
+    {
+        cache_loaded = TRUE;
+        dir_size_cache_load ();
+    }
+
+    return cache;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Must be called under the lock */
+
+static dir_size_cached_t *
+dir_size_cache_lookup (GHashTable * table, dev_t dev, ino_t ino)
+{
+    dir_size_cached_t key;
+
+    key.dev = dev;
+    key.ino = ino;
+
+    return (dir_size_cached_t *) g_hash_table_lookup (table, &key);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Get the record of the directory, whether it has been changed since or not */
+
+static gboolean
+dir_size_cache_find (dev_t dev, ino_t ino, dir_size_cached_t * found)
+{
+    const dir_size_cached_t *c;
+
+    g_mutex_lock (&cache_lock);
+    c = dir_size_cache_lookup (dir_size_cache_get (), dev, ino);
+    if (c != NULL)
+        *found = *c;
+    g_mutex_unlock (&cache_lock);
+
+    return (c != NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_size_cache_add (const dir_size_node_t * node, const dir_size_t * own, const dir_size_t * size)
+{
+    time_t now;
+    GHashTable *table;
+    dir_size_cached_t *c;
+
+    now = time (NULL);
+
+    /* the directory may be changed again within the same second unnoticed */
+    if (node->mtime >= now - 1)
+        return;
+
+    g_mutex_lock (&cache_lock);
+
+    table = dir_size_cache_get ();
+    if (g_hash_table_size (table) < DIR_SIZE_CACHE_MAX)
+    {
+        c = g_new (dir_size_cached_t, 1);
+        c->dev = node->dev;
+        c->ino = node->ino;
+        c->mtime = node->mtime;
+        c->checked = now;
+        c->confirmed = TRUE;
+        c->own = *own;
+        c->size = *size;
+        g_hash_table_replace (table, c, c);
+        cache_changed = TRUE;
+    }
+
+    g_mutex_unlock (&cache_lock);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_size_add (dir_size_t * to, const dir_size_t * size)
+{
+    to->dirs += size->dirs;
+    to->files += size->files;
+    to->bytes += size->bytes;
+    to->disk += size->disk;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Replace a part of the size with another one, FALSE if the size doesn't contain that part */
+
+static gboolean
+dir_size_replace (dir_size_t * size, const dir_size_t * removed, const dir_size_t * added)
+{
+    if (size->dirs < removed->dirs || size->files < removed->files
+        || size->bytes < removed->bytes || size->disk < removed->disk)
+        return FALSE;
+
+    size->dirs = size->dirs - removed->dirs + added->dirs;
+    size->files = size->files - removed->files + added->files;
+    size->bytes = size->bytes - removed->bytes + added->bytes;
+    size->disk = size->disk - removed->disk + added->disk;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the size the local entry adds to the tree of its directory. The directory is counted
+ * with its tree if it's known and as an empty one otherwise. Must be called under the lock
+ *
+ * @param st lstat of the entry or NULL if it doesn't exist
+ */
+
+static void
+dir_size_cache_entry (GHashTable * table, const struct stat *st, dir_size_t * size)
+{
+    memset (size, 0, sizeof (*size));
+
+    if (st == NULL)
+        return;
+
+    if (S_ISDIR (st->st_mode))
+    {
+        const dir_size_cached_t *c;
+
+        c = dir_size_cache_lookup (table, st->st_dev, st->st_ino);
+        if (c != NULL && c->mtime == st->st_mtime)
+            *size = c->size;
+        else
+            size->dirs = 1;
+    }
+    else
+    {
+        size->files = 1;
+        size->bytes = (uintmax_t) st->st_size;
+        size->disk = (uintmax_t) st->st_blocks * 512;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Get the path of the local directory or file without trailing separators */
+
+static char *
+dir_size_path_new (const vfs_path_t * vpath)
+{
+    char *path, *sep;
+
+    path = g_strdup (vfs_path_as_str (vpath));
+    for (sep = path + strlen (path) - 1; sep > path && IS_PATH_SEP (*sep); sep--)
+        *sep = '\0';
+
+    return path;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Cut the last component of the path, FALSE if it's the root directory */
+
+static gboolean
+dir_size_path_up (char *path)
+{
+    char *sep;
+
+    sep = strrchr (path, PATH_SEP);
+    if (sep == NULL || sep[1] == '\0')
+        return FALSE;
+
+    sep[sep == path ? 1 : 0] = '\0';
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static dir_size_node_t *
+dir_size_node_new (dir_size_node_t * parent, const char *path, const struct stat *st)
+{
+    dir_size_node_t *node;
+
+    node = g_new0 (dir_size_node_t, 1);
+    node->parent = parent;
+    node->path = g_strdup (path);
+    node->dev = st->st_dev;
+    node->ino = st->st_ino;
+    node->mtime = st->st_mtime;
+    node->pending = 1;
+
+    return node;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Finish a part of the directory: either its own entries or one of its subdirectories.
+ * If that was the last part, the size of the directory is added to its parent, and so on.
+ */
+
+static void
+dir_size_node_done (dir_size_scan_t * scan, dir_size_node_t * node)
+{
+    while (node != NULL && g_atomic_int_dec_and_test (&node->pending))
+    {
+        dir_size_node_t *parent = node->parent;
+        dir_size_t own, size;
+        gboolean incomplete;
+
+        g_mutex_lock (&scan->lock);
+
+        own = node->own;
+        size = node->size;
+        incomplete = node->incomplete || g_atomic_int_get (&scan->cancelled) != 0;
+
+        if (parent != NULL)
+        {
+            dir_size_add (&parent->size, &size);
+            parent->incomplete = parent->incomplete || incomplete;
+        }
+
+        g_mutex_unlock (&scan->lock);
+
+        if (!incomplete)
+            dir_size_cache_add (node, &own, &size);
+
+        if (parent == NULL)
+        {
+            /* the tree is done: no more tasks are queued */
+            g_mutex_lock (&scan->lock);
+            scan->size = size;
+            scan->finished = TRUE;
+            g_cond_broadcast (&scan->cond);
+            g_mutex_unlock (&scan->lock);
+        }
+
+        g_free (node->path);
+        g_free (node);
+        node = parent;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read the directory and queue its subdirectories, except ones whose confirmed size is
+ * still valid. Files are stat'ed only if the directory has been changed since it was
+ * scanned last time.
+ */
+
+static void
+dir_size_worker (gpointer data, gpointer user_data)
+{
+    dir_size_node_t *node = (dir_size_node_t *) data;
+    dir_size_scan_t *scan = (dir_size_scan_t *) user_data;
+    dir_size_cached_t cached;
+    gboolean unchanged;
+    dir_size_t own, known;
+    DIR *dir = NULL;
+    gboolean read = FALSE;
+
+    unchanged = dir_size_cache_find (node->dev, node->ino, &cached)
+        && cached.mtime == node->mtime;
+
+    memset (&own, 0, sizeof (own));
+    memset (&known, 0, sizeof (known));
+
+    if (g_atomic_int_get (&scan->cancelled) == 0)
+        dir = opendir (node->path);
+
+    if (dir != NULL)
+    {
+        GString *path;
+        gsize len;
+        struct dirent *dirent;
+
+        path = g_string_new (node->path);
+        if (path->len == 0 || !IS_PATH_SEP (path->str[path->len - 1]))
+            g_string_append_c (path, PATH_SEP);
+        len = path->len;
+
+        while (g_atomic_int_get (&scan->cancelled) == 0 && (dirent = readdir (dir)) != NULL)
+        {
+            struct stat st;
+
+            if (DIR_IS_DOT (dirent->d_name) || DIR_IS_DOTDOT (dirent->d_name))
+                continue;
+
+#ifdef HAVE_STRUCT_DIRENT_D_TYPE
+            if (unchanged && dirent->d_type != DT_UNKNOWN && dirent->d_type != DT_DIR)
+                continue;
+#endif
+
+            g_string_truncate (path, len);
+            g_string_append (path, dirent->d_name);
+
+            if (lstat (path->str, &st) != 0)
+                continue;
+
+            if (S_ISDIR (st.st_mode))
+            {
+                dir_size_cached_t sub;
+
+                /* sizes of changed files deep in the tree have been updated by MC */
+                if (dir_size_cache_find (st.st_dev, st.st_ino, &sub) && sub.confirmed
+                    && sub.mtime == st.st_mtime)
+                    dir_size_add (&known, &sub.size);
+                else
+                {
+                    g_atomic_int_inc (&node->pending);
+                    g_thread_pool_push (scan->pool, dir_size_node_new (node, path->str, &st),
+                                        NULL);
+                }
+            }
+            else if (!unchanged)
+            {
+                own.files++;
+                own.bytes += (uintmax_t) st.st_size;
+                own.disk += (uintmax_t) st.st_blocks * 512;
+            }
+        }
+
+        g_string_free (path, TRUE);
+        closedir (dir);
+        read = TRUE;
+    }
+
+    if (unchanged)
+        own = cached.own;
+    own.dirs = 1;
+
+    g_mutex_lock (&scan->lock);
+    node->own = own;
+    dir_size_add (&node->size, &own);
+    dir_size_add (&node->size, &known);
+    node->incomplete = node->incomplete || !read;
+    dir_size_add (&scan->size, &own);
+    dir_size_add (&scan->size, &known);
+    g_free (scan->current);
+    scan->current = g_strdup (node->path);
+    g_mutex_unlock (&scan->lock);
+
+    dir_size_node_done (scan, node);
+}
+
+#endif /* HAVE_GLIB_THREADS */
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the directory can be scanned by threads: it must be on the local filesystem.
+ */
+
+gboolean
+dir_size_can_scan (const vfs_path_t * vpath)
+{
+#ifdef HAVE_GLIB_THREADS
+    return (vfs_file_get_local_path (vpath) != NULL);
+#else
+    (void) vpath;
+
+    return FALSE;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start scanning of the directory.
+ *
+ * @param path local path accepted by dir_size_can_scan(). Symlink to a directory is followed
+ *
+ * @return new scan or NULL if the path is not a directory or threads can't be started
+ */
+
+dir_size_scan_t *
+dir_size_scan_start (const char *path)
+{
+#ifdef HAVE_GLIB_THREADS
+    dir_size_scan_t *scan;
+    struct stat st;
+
+    if (stat (path, &st) != 0 || !S_ISDIR (st.st_mode))
+        return NULL;
+
+    /* load the database here rather than in a thread */
+    g_mutex_lock (&cache_lock);
+    (void) dir_size_cache_get ();
+    g_mutex_unlock (&cache_lock);
+
+    scan = g_new0 (dir_size_scan_t, 1);
+    g_mutex_init (&scan->lock);
+    g_cond_init (&scan->cond);
+
+    scan->pool = g_thread_pool_new (dir_size_worker, scan, MAX (dir_stat_threads, 1), FALSE, NULL);
+    if (scan->pool == NULL)
+    {
+        g_cond_clear (&scan->cond);
+        g_mutex_clear (&scan->lock);
+        g_free (scan);
+        return NULL;
+    }
+
+    g_thread_pool_push (scan->pool, dir_size_node_new (NULL, path, &st), NULL);
+
+    return scan;
+#else
+    (void) path;
+
+    return NULL;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Wait a bit for the end of scanning.
+ *
+ * @param scan the scan
+ * @param size size of the tree if scanning is finished, size of directories read so far otherwise
+ * @param current if not NULL, set to the newly allocated path of the last directory read
+ *                (NULL if there was none)
+ *
+ * @return TRUE if scanning is finished
+ */
+
+gboolean
+dir_size_scan_wait (dir_size_scan_t * scan, dir_size_t * size, char **current)
+{
+#ifdef HAVE_GLIB_THREADS
+    gint64 end_time;
+    gboolean finished;
+
+    end_time = g_get_monotonic_time () + DIR_SIZE_WAIT;
+
+    g_mutex_lock (&scan->lock);
+
+    while (!scan->finished && g_cond_wait_until (&scan->cond, &scan->lock, end_time))
+        ;
+
+    *size = scan->size;
+    if (current != NULL)
+        *current = g_strdup (scan->current);
+    finished = scan->finished;
+
+    g_mutex_unlock (&scan->lock);
+
+    return finished;
+#else
+    (void) scan;
+
+    memset (size, 0, sizeof (*size));
+    if (current != NULL)
+        *current = NULL;
+
+    return TRUE;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop scanning, if it's not finished yet, and free the scan.
+ */
+
+void
+dir_size_scan_free (dir_size_scan_t * scan)
+{
+#ifdef HAVE_GLIB_THREADS
+    if (scan == NULL)
+        return;
+
+    g_atomic_int_set (&scan->cancelled, 1);
+
+    /* queued tasks are finished quickly, but they still may queue new ones */
+    g_mutex_lock (&scan->lock);
+    while (!scan->finished)
+        g_cond_wait (&scan->cond, &scan->lock);
+    g_mutex_unlock (&scan->lock);
+
+    g_thread_pool_free (scan->pool, FALSE, TRUE);
+
+    g_cond_clear (&scan->cond);
+    g_mutex_clear (&scan->lock);
+    g_free (scan->current);
+    g_free (scan);
+#else
+    (void) scan;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the size of the directory known from a previous scan.
+ *
+ * @param st stat of a local directory
+ * @param size size of the tree
+ * @param confirmed set to TRUE if the tree has been scanned since panels were rescanned,
+ *                  FALSE if subdirectories may have been changed by other programs
+ *
+ * @return TRUE if the directory has been scanned and not changed since
+ */
+
+gboolean
+dir_size_lookup (const struct stat *st, dir_size_t * size, gboolean * confirmed)
+{
+#ifdef HAVE_GLIB_THREADS
+    dir_size_cached_t cached;
+
+    if (!dir_size_cache_find (st->st_dev, st->st_ino, &cached) || cached.mtime != st->st_mtime)
+        return FALSE;
+
+    *size = cached.size;
+    *confirmed = cached.confirmed;
+    return TRUE;
+#else
+    (void) st;
+    (void) size;
+    (void) confirmed;
+
+    return FALSE;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the size of the tree to be shown to the user: sum of sizes of files or, if
+ * dir_size_disk_usage is set, space allocated for them.
+ */
+
+uintmax_t
+dir_size_value (const dir_size_t * size)
+{
+    return (dir_size_disk_usage != 0 ? size->disk : size->bytes);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Forget sizes of the local directory and of all its parents, because something has been
+ * changed in the directory.
+ */
+
+void
+dir_size_cache_forget (const vfs_path_t * vpath)
+{
+#ifdef HAVE_GLIB_THREADS
+    char *path;
+    GHashTable *table;
+    gboolean more = TRUE;
+
+    if (!dir_size_can_scan (vpath))
+        return;
+
+    path = dir_size_path_new (vpath);
+
+    g_mutex_lock (&cache_lock);
+
+    table = dir_size_cache_get ();
+
+    while (more && g_hash_table_size (table) != 0)
+    {
+        struct stat st;
+
+        if (stat (path, &st) == 0)
+        {
+            dir_size_cached_t key;
+
+            key.dev = st.st_dev;
+            key.ino = st.st_ino;
+            if (g_hash_table_remove (table, &key))
+                cache_changed = TRUE;
+        }
+
+        more = dir_size_path_up (path);
+    }
+
+    g_mutex_unlock (&cache_lock);
+
+    g_free (path);
+#else
+    (void) vpath;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Update sizes of the directories containing the local entry, which has been created,
+ * replaced or removed by a file operation of MC. Sizes of all its parents are changed by
+ * the size of the entry. Records of directories whose mtime differs from the record are
+ * forgotten instead: they have been changed by the operation itself (the directory of
+ * the entry, if the entry is created or removed) or by other programs before.
+ *
+ * A directory entry is counted with its tree if its size is known and as an empty one
+ * otherwise. Removal or creation of a tree of unknown size must be handled by
+ * dir_size_cache_forget().
+ *
+ * @param vpath the entry
+ * @param old_st lstat of the entry before the change, NULL if it didn't exist
+ * @param new_st lstat of the entry after the change, NULL if it doesn't exist
+ */
+
+void
+dir_size_cache_update (const vfs_path_t * vpath, const struct stat *old_st,
+                       const struct stat *new_st)
+{
+#ifdef HAVE_GLIB_THREADS
+    char *path;
+    GHashTable *table;
+    dir_size_t removed, added;
+    gboolean own;
+
+    if (!dir_size_can_scan (vpath))
+        return;
+
+    path = dir_size_path_new (vpath);
+
+    g_mutex_lock (&cache_lock);
+
+    table = dir_size_cache_get ();
+
+    dir_size_cache_entry (table, old_st, &removed);
+    dir_size_cache_entry (table, new_st, &added);
+    /* files are counted in the directory's own size too */
+    own = (old_st == NULL || !S_ISDIR (old_st->st_mode))
+        && (new_st == NULL || !S_ISDIR (new_st->st_mode));
+
+    /* both are zeroed before they are filled */
+    while (g_hash_table_size (table) != 0 && memcmp (&removed, &added, sizeof (removed)) != 0
+           && dir_size_path_up (path))
+    {
+        struct stat st;
+        dir_size_cached_t *c = NULL;
+
+        if (stat (path, &st) == 0)
+            c = dir_size_cache_lookup (table, st.st_dev, st.st_ino);
+
+        if (c != NULL)
+        {
+            if (c->mtime != st.st_mtime || !dir_size_replace (&c->size, &removed, &added)
+                || (own && !dir_size_replace (&c->own, &removed, &added)))
+                g_hash_table_remove (table, c);
+            cache_changed = TRUE;
+        }
+
+        own = FALSE;
+    }
+
+    g_mutex_unlock (&cache_lock);
+
+    g_free (path);
+#else
+    (void) vpath;
+    (void) old_st;
+    (void) new_st;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Take sizes of all directories for hints until they are scanned again: files may have been
+ * changed deep in trees by other programs. Records are kept, so a scan still reads only
+ * directories of the trees and stats files of changed directories only.
+ */
+
+void
+dir_size_cache_revalidate (void)
+{
+#ifdef HAVE_GLIB_THREADS
+    g_mutex_lock (&cache_lock);
+
+    /* not loaded yet: nothing is confirmed */
+    if (cache != NULL)
+    {
+        GHashTableIter iter;
+        gpointer value;
+
+        g_hash_table_iter_init (&iter, cache);
+        while (g_hash_table_iter_next (&iter, NULL, &value))
+            ((dir_size_cached_t *) value)->confirmed = FALSE;
+    }
+
+    g_mutex_unlock (&cache_lock);
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Save sizes of directories to MC_DIRSIZE_FILE.
+ */
+
+void
+dir_size_cache_save (void)
+{
+#ifdef HAVE_GLIB_THREADS
+    char *name, *tmp_name;
+    FILE *f;
+    GHashTableIter iter;
+    gpointer value;
+    time_t oldest;
+    gboolean ok;
+
+    g_mutex_lock (&cache_lock);
+
+    if (!cache_changed)
+    {
+        g_mutex_unlock (&cache_lock);
+        return;
+    }
+
+    name = mc_config_get_full_path (MC_DIRSIZE_FILE);
+    tmp_name = g_strconcat (name, ".tmp", (char *) NULL);
+
+    f = fopen (tmp_name, "w");
+    ok = f != NULL;
+
+    if (ok)
+    {
+        oldest = time (NULL) - DIR_SIZE_CACHE_KEEP;
+
+        ok = fprintf (f, "%s\n", DIR_SIZE_SIGNATURE) > 0;
+
+        g_hash_table_iter_init (&iter, cache);
+        while (ok && g_hash_table_iter_next (&iter, NULL, &value))
+        {
+            const dir_size_cached_t *c = (const dir_size_cached_t *) value;
+
+            if (c->checked >= oldest)
+                ok = fprintf (f, "%ju %ju %jd %jd %ju %ju %ju %ju %ju %ju %ju %ju\n",
+                              (uintmax_t) c->dev, (uintmax_t) c->ino, (intmax_t) c->mtime,
+                              (intmax_t) c->checked, (uintmax_t) c->own.dirs,
+                              (uintmax_t) c->own.files, c->own.bytes, c->own.disk,
+                              (uintmax_t) c->size.dirs, (uintmax_t) c->size.files,
+                              c->size.bytes, c->size.disk) > 0;
+        }
+
+        ok = (fclose (f) == 0) && ok;
+    }
+
+    if (ok && rename (tmp_name, name) == 0)
+        cache_changed = FALSE;
+    else
+        unlink (tmp_name);
+
+    g_free (tmp_name);
+    g_free (name);
+
+    g_mutex_unlock (&cache_lock);
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,49 @@
+/** \file dirsize.h
+ *  \brief Header: parallel computing of sizes of local directories
+ */
+
+#ifndef MC__DIRSIZE_H
+#define MC__DIRSIZE_H
+
+#include <sys/stat.h>
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct dir_size_scan_struct dir_size_scan_t;
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct
+{
+    size_t dirs;                /* number of directories, including the scanned one */
+    size_t files;               /* number of other entries */
+    uintmax_t bytes;            /* sum of sizes of files */
+    uintmax_t disk;             /* space allocated for files, in bytes */
+} dir_size_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+gboolean dir_size_can_scan (const vfs_path_t * vpath);
+dir_size_scan_t *dir_size_scan_start (const char *path);
+gboolean dir_size_scan_wait (dir_size_scan_t * scan, dir_size_t * size, char **current);
+void dir_size_scan_free (dir_size_scan_t * scan);
+
+gboolean dir_size_lookup (const struct stat *st, dir_size_t * size, gboolean * confirmed);
+uintmax_t dir_size_value (const dir_size_t * size);
+
+void dir_size_cache_forget (const vfs_path_t * vpath);
+void dir_size_cache_update (const vfs_path_t * vpath, const struct stat *old_st,
+                            const struct stat *new_st);
+void dir_size_cache_revalidate (void);
+void dir_size_cache_save (void);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__DIRSIZE_H */
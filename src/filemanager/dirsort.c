@@ -0,0 +1,385 @@
+/*
+   Sorting of directory content by precomputed keys
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file src/filemanager/dirsort.c
+ *  \brief Source: sorting of directory content by precomputed keys
+ *
+ *  The comparison functions in dir.c (sort_name(), sort_size(), ...) check the type of entries
+ *  and the sort options on every call and create collation keys lazily. For big directories
+ *  this makes qsort() slow. Here the keys are computed once for each entry: the group
+ *  (directories, executables, other files), a packed integer key for numeric sort orders
+ *  and the collation key of the name. Entries are sorted by LSD radix sort on the integer
+ *  key and the group, and then runs of equal keys are sorted by name with stable merge sort.
+ *  Resulting order is the same as produced by the comparison functions.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include "lib/global.h"
+#include "lib/strutil.h"
+#include "lib/util.h"
+
+#include "src/setup.h"          /* panels_options */
+
+#include "dir.h"
+#include "dirsort.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define SIGN_BIT G_GUINT64_CONSTANT (0x8000000000000000)
+
+/*** file scope type declarations ****************************************************************/
+
+typedef enum
+{
+    SORT_KEY_NAME = 0,
+    SORT_KEY_MTIME,
+    SORT_KEY_CTIME,
+    SORT_KEY_ATIME,
+    SORT_KEY_SIZE,
+    SORT_KEY_INODE
+} sort_key_t;
+
+typedef struct
+{
+    guint64 key;                /* packed integer key, inverted for reverse sort */
+    guint64 prefix;             /* first bytes of name_key, big-endian */
+    char *name_key;             /* collation key of name, NULL if not needed */
+    int index;                  /* index of entry in list */
+    guint8 group;               /* 0: directories, 1: executables, 2: other files */
+    guint8 dot;                 /* 0: name starts with dot, 1: other names */
+} sort_item_t;
+
+typedef struct
+{
+    int reverse;                /* 1 or -1 */
+    int case_sen;
+    gboolean bytewise;          /* collation keys can be compared by prefix */
+} sort_ctx_t;
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+sort_key_by_routine (GCompareFunc sort, sort_key_t * key)
+{
+    if (sort == (GCompareFunc) sort_name)
+        *key = SORT_KEY_NAME;
+    else if (sort == (GCompareFunc) sort_time)
+        *key = SORT_KEY_MTIME;
+    else if (sort == (GCompareFunc) sort_ctime)
+        *key = SORT_KEY_CTIME;
+    else if (sort == (GCompareFunc) sort_atime)
+        *key = SORT_KEY_ATIME;
+    else if (sort == (GCompareFunc) sort_size)
+        *key = SORT_KEY_SIZE;
+    else if (sort == (GCompareFunc) sort_inode)
+        *key = SORT_KEY_INODE;
+    else
+        return FALSE;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Map signed value to unsigned one keeping the order */
+
+static inline guint64
+signed_key (gint64 value)
+{
+    return ((guint64) value) ^ SIGN_BIT;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+sort_item_init (sort_item_t * item, const file_entry_t * fe, int index, sort_key_t key,
+                const dir_sort_options_t * sort_op)
+{
+    const struct stat *st = &fe->st;
+
+    item->index = index;
+    item->name_key = NULL;
+    item->prefix = 0;
+    item->dot = 1;
+
+    if (panels_options.mix_all_files || S_ISDIR (st->st_mode) || fe->f.link_to_dir != 0)
+        item->group = 0;
+    else if (sort_op->exec_first && is_exe (st->st_mode))
+        item->group = 1;
+    else
+        item->group = 2;
+
+    switch (key)
+    {
+    case SORT_KEY_MTIME:
+        item->key = signed_key ((gint64) st->st_mtime);
+        break;
+    case SORT_KEY_CTIME:
+        item->key = signed_key ((gint64) st->st_ctime);
+        break;
+    case SORT_KEY_ATIME:
+        item->key = signed_key ((gint64) st->st_atime);
+        break;
+    case SORT_KEY_SIZE:
+        item->key = signed_key ((gint64) st->st_size);
+        break;
+    case SORT_KEY_INODE:
+        item->key = (guint64) st->st_ino;
+        break;
+    default:
+        item->key = 0;
+        break;
+    }
+
+    if (sort_op->reverse)
+        item->key = ~item->key;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+sort_item_make_name_key (sort_item_t * item, const file_entry_t * fe, const sort_ctx_t * ctx)
+{
+    int i;
+
+    item->name_key = str_create_key_for_filename (fe->fname, ctx->case_sen);
+    item->dot = item->name_key[0] == '.' ? 0 : 1;
+
+    if (ctx->bytewise)
+        for (i = 0; i < 8 && item->name_key[i] != '\0'; i++)
+            item->prefix |= ((guint64) (unsigned char) item->name_key[i]) << (56 - 8 * i);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Same order as key_collate() in dir.c: names which start with dot go first regardless of
+   the reverse flag */
+
+static inline int
+sort_item_cmp_name (const sort_item_t * a, const sort_item_t * b, const sort_ctx_t * ctx)
+{
+    if (a->dot != b->dot)
+        return (int) a->dot - (int) b->dot;
+
+    if (ctx->bytewise && a->prefix != b->prefix)
+        return (a->prefix < b->prefix ? -1 : 1) * ctx->reverse;
+
+    return str_key_collate (a->name_key, b->name_key, ctx->case_sen) * ctx->reverse;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stable bottom-up merge sort of items by name.
+ *
+ * @param items items to sort
+ * @param tmp buffer of the same size
+ * @param n number of items
+ */
+
+static void
+sort_items_by_name (sort_item_t * items, sort_item_t * tmp, int n, const sort_ctx_t * ctx)
+{
+    sort_item_t *src = items;
+    sort_item_t *dst = tmp;
+    int width;
+
+    for (width = 1; width < n; width *= 2)
+    {
+        sort_item_t *t;
+        int lo;
+
+        for (lo = 0; lo < n; lo += 2 * width)
+        {
+            int mid, hi, i, j, k;
+
+            mid = MIN (lo + width, n);
+            hi = MIN (lo + 2 * width, n);
+
+            for (i = lo, j = mid, k = lo; i < mid && j < hi; k++)
+                if (sort_item_cmp_name (&src[j], &src[i], ctx) < 0)
+                    dst[k] = src[j++];
+                else
+                    dst[k] = src[i++];
+
+            if (i < mid)
+                memcpy (&dst[k], &src[i], (mid - i) * sizeof (sort_item_t));
+            else if (j < hi)
+                memcpy (&dst[k], &src[j], (hi - j) * sizeof (sort_item_t));
+        }
+
+        t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != items)
+        memcpy (items, src, n * sizeof (sort_item_t));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** The last pass of radix sort is on the group */
+
+static inline unsigned int
+radix_digit (const sort_item_t * item, int shift)
+{
+    return shift == 64 ? item->group : (unsigned int) ((item->key >> shift) & 0xFF);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stable LSD radix sort of items by integer key and then by group.
+ * Passes on bytes which are equal in all keys are skipped.
+ *
+ * @param items pointer to items to sort, on return points to sorted items
+ * @param tmp pointer to buffer of the same size, on return points to the other buffer
+ * @param n number of items
+ */
+
+static void
+sort_items_by_key (sort_item_t ** items, sort_item_t ** tmp, int n)
+{
+    sort_item_t *src = *items;
+    sort_item_t *dst = *tmp;
+    int shift, i;
+    gsize count[256];
+
+    for (shift = 0; shift <= 64; shift += 8)
+    {
+        gsize offset;
+        unsigned int b;
+        sort_item_t *t;
+
+        memset (count, 0, sizeof (count));
+
+        for (i = 0; i < n; i++)
+            count[radix_digit (&src[i], shift)]++;
+
+        if (count[radix_digit (&src[0], shift)] == (gsize) n)
+            continue;
+
+        for (offset = 0, b = 0; b < G_N_ELEMENTS (count); b++)
+        {
+            gsize c = count[b];
+
+            count[b] = offset;
+            offset += c;
+        }
+
+        for (i = 0; i < n; i++)
+            dst[count[radix_digit (&src[i], shift)]++] = src[i];
+
+        t = src;
+        src = dst;
+        dst = t;
+    }
+
+    *items = src;
+    *tmp = dst;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Sort directory list by precomputed keys.
+ *
+ * @param list directory list
+ * @param start index of the first entry to sort (1 to skip "..")
+ * @param sort sort routine which defines the order
+ * @param sort_op sort options
+ *
+ * @return TRUE if list is sorted, FALSE if the order defined by @sort is not supported
+ *         and the list should be sorted with qsort()
+ */
+
+gboolean
+dir_list_sort_by_keys (dir_list * list, int start, GCompareFunc sort,
+                       const dir_sort_options_t * sort_op)
+{
+    file_entry_t *entries, *sorted;
+    sort_item_t *items, *tmp, *buf;
+    sort_key_t key;
+    sort_ctx_t ctx;
+    int n, i, j;
+
+    if (!sort_key_by_routine (sort, &key))
+        return FALSE;
+
+    entries = &list->list[start];
+    n = list->len - start;
+    if (n < 2)
+        return TRUE;
+
+    ctx.reverse = sort_op->reverse ? -1 : 1;
+    ctx.case_sen = sort_op->case_sensitive ? 1 : 0;
+    ctx.bytewise = str_key_is_bytewise (ctx.case_sen);
+
+    buf = g_new (sort_item_t, 2 * n);
+    items = buf;
+    tmp = buf + n;
+
+    for (i = 0; i < n; i++)
+        sort_item_init (&items[i], &entries[i], i, key, sort_op);
+
+    sort_items_by_key (&items, &tmp, n);
+
+    /* sort runs of equal keys by name */
+    for (i = 0; i < n; i = j)
+    {
+        for (j = i + 1; j < n && items[j].key == items[i].key && items[j].group == items[i].group;
+             j++)
+            ;
+
+        if (j - i > 1 && key != SORT_KEY_INODE)
+        {
+            int k;
+
+            for (k = i; k < j; k++)
+                sort_item_make_name_key (&items[k], &entries[items[k].index], &ctx);
+
+            sort_items_by_name (&items[i], &tmp[i], j - i, &ctx);
+        }
+    }
+
+    sorted = g_new (file_entry_t, n);
+    for (i = 0; i < n; i++)
+    {
+        sorted[i] = entries[items[i].index];
+        if (items[i].name_key != NULL)
+            str_release_key (items[i].name_key, ctx.case_sen);
+    }
+    memcpy (entries, sorted, n * sizeof (file_entry_t));
+
+    g_free (sorted);
+    g_free (buf);
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
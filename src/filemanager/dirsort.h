@@ -0,0 +1,27 @@
+/** \file dirsort.h
+ *  \brief Header: sorting of directory content by precomputed keys
+ */
+
+#ifndef MC__DIRSORT_H
+#define MC__DIRSORT_H
+
+#include "lib/global.h"
+
+#include "dir.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+gboolean dir_list_sort_by_keys (dir_list * list, int start, GCompareFunc sort,
+                                const dir_sort_options_t * sort_op);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__DIRSORT_H */
@@ -0,0 +1,428 @@
+/*
+   Watching of directories for changes
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file src/filemanager/dirwatch.c
+ *  \brief Source: watching of directories for changes
+ *
+ *  Directories on the local filesystem are watched with inotify. All watches share
+ *  one inotify descriptor which is checked by the main loop (add_select_channel()).
+ *  Names of changed entries are collected for a short time, so a burst of events
+ *  results in one call of the callback. Without inotify, no directory can be watched.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#if defined (HAVE_SYS_INOTIFY_H) && defined (HAVE_SYS_TIMERFD_H)
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#endif
+
+#include "lib/global.h"
+#include "lib/tty/key.h"        /* add_select_channel(), delete_select_channel() */
+#include "lib/vfs/vfs.h"
+
+#include "dirwatch.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#if defined (HAVE_SYS_INOTIFY_H) && defined (HAVE_SYS_TIMERFD_H)
+#define DIR_WATCH_INOTIFY 1
+#endif
+
+#ifdef DIR_WATCH_INOTIFY
+/* Events are collected for this time before the callback is called (in nanoseconds) */
+#define DIR_WATCH_DELAY 200000000
+/* Delay before changes rejected by the callback are reported again (in seconds) */
+#define DIR_WATCH_RETRY_DELAY 1
+/* If more entries are changed at once, the directory is reloaded completely */
+#define DIR_WATCH_MAX_NAMES 4096
+
+#define DIR_WATCH_EVENTS (IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_MOVED_FROM \
+                          | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+#define DIR_WATCH_SELF_EVENTS (IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT | IN_IGNORED)
+#endif
+
+/*** file scope type declarations ****************************************************************/
+
+struct dir_watch_struct
+{
+    vfs_path_t *vpath;
+    dir_watch_cb_fn callback;
+    int wd;                     /* inotify watch descriptor */
+    GHashTable *names;          /* names of changed entries collected so far */
+    gboolean overflow;
+};
+
+/*** file scope variables ************************************************************************/
+
+#ifdef DIR_WATCH_INOTIFY
+static int inotify_fd = -1;
+static int timer_fd = -1;
+static gboolean timer_armed = FALSE;
+
+static GSList *watches = NULL;
+#endif
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef DIR_WATCH_INOTIFY
+
+static void
+dir_watch_arm_timer (gboolean retry)
+{
+    struct itimerspec its;
+
+    if (timer_armed)
+        return;
+
+    memset (&its, 0, sizeof (its));
+    if (retry)
+        its.it_value.tv_sec = DIR_WATCH_RETRY_DELAY;
+    else
+        its.it_value.tv_nsec = DIR_WATCH_DELAY;
+
+    timer_armed = timerfd_settime (timer_fd, 0, &its, NULL) == 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_watch_add_name (dir_watch_t * watch, const char *name)
+{
+    if (watch->overflow)
+        return;
+
+    if (g_hash_table_size (watch->names) >= DIR_WATCH_MAX_NAMES)
+    {
+        /* reloading is cheaper than applying so many changes */
+        watch->overflow = TRUE;
+        g_hash_table_remove_all (watch->names);
+        return;
+    }
+
+    if (g_hash_table_lookup (watch->names, name) == NULL)
+    {
+        char *key;
+
+        key = g_strdup (name);
+        g_hash_table_insert (watch->names, key, key);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_watch_merge (dir_watch_t * watch, GHashTable * names)
+{
+    GHashTableIter iter;
+    gpointer key;
+
+    g_hash_table_iter_init (&iter, names);
+    while (g_hash_table_iter_next (&iter, &key, NULL))
+        dir_watch_add_name (watch, (const char *) key);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_watch_handle_event (const struct inotify_event *ev)
+{
+    GSList *l;
+
+    for (l = watches; l != NULL; l = g_slist_next (l))
+    {
+        dir_watch_t *watch = (dir_watch_t *) l->data;
+
+        if ((ev->mask & IN_Q_OVERFLOW) != 0)
+        {
+            watch->overflow = TRUE;
+            g_hash_table_remove_all (watch->names);
+        }
+        else if (watch->wd != ev->wd)
+            continue;
+        else if ((ev->mask & DIR_WATCH_SELF_EVENTS) != 0)
+        {
+            watch->overflow = TRUE;
+            g_hash_table_remove_all (watch->names);
+        }
+        else if (ev->len != 0)
+            dir_watch_add_name (watch, ev->name);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Read inotify events and start the timer to collect more of them */
+
+static int
+dir_watch_inotify_cb (int fd, void *info)
+{
+    union
+    {
+        struct inotify_event ev;
+        char buf[16 * 1024];
+    } u;
+    ssize_t len;
+
+    (void) info;
+
+    while ((len = read (fd, u.buf, sizeof (u.buf))) > 0)
+    {
+        const char *p = u.buf;
+
+        while (p < u.buf + len)
+        {
+            const struct inotify_event *ev = (const struct inotify_event *) p;
+
+            dir_watch_handle_event (ev);
+            p += sizeof (struct inotify_event) + ev->len;
+        }
+    }
+
+    dir_watch_arm_timer (FALSE);
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Report changes collected since the timer was started */
+
+static int
+dir_watch_timer_cb (int fd, void *info)
+{
+    guint64 expirations;
+    GSList *pending = NULL;
+    GSList *l;
+    gboolean retry = FALSE;
+
+    (void) info;
+
+    if (read (fd, &expirations, sizeof (expirations)) < 0 && errno == EAGAIN)
+        return 0;
+
+    timer_armed = FALSE;
+
+    for (l = watches; l != NULL; l = g_slist_next (l))
+    {
+        dir_watch_t *watch = (dir_watch_t *) l->data;
+
+        if (watch->overflow || g_hash_table_size (watch->names) != 0)
+            pending = g_slist_prepend (pending, watch);
+    }
+
+    for (l = pending; l != NULL; l = g_slist_next (l))
+    {
+        dir_watch_t *watch = (dir_watch_t *) l->data;
+        GHashTable *names;
+        gboolean overflow;
+
+        /* the callback may free other watches */
+        if (g_slist_find (watches, watch) == NULL)
+            continue;
+
+        names = watch->names;
+        overflow = watch->overflow;
+        watch->names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        watch->overflow = FALSE;
+
+        if (watch->callback (watch, names, overflow))
+            g_hash_table_destroy (names);
+        else
+        {
+            /* keep changes until the owner is ready to apply them */
+            GHashTable *tmp = watch->names;
+
+            watch->names = names;
+            watch->overflow = watch->overflow || overflow;
+            dir_watch_merge (watch, tmp);
+            g_hash_table_destroy (tmp);
+            retry = TRUE;
+        }
+    }
+
+    g_slist_free (pending);
+
+    if (retry)
+        dir_watch_arm_timer (TRUE);
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+dir_watch_init (void)
+{
+    if (inotify_fd != -1)
+        return TRUE;
+
+    inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd == -1)
+        return FALSE;
+
+    timer_fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd == -1)
+    {
+        close (inotify_fd);
+        inotify_fd = -1;
+        return FALSE;
+    }
+
+    add_select_channel (inotify_fd, dir_watch_inotify_cb, NULL);
+    add_select_channel (timer_fd, dir_watch_timer_cb, NULL);
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_watch_done (void)
+{
+    if (inotify_fd == -1)
+        return;
+
+    delete_select_channel (inotify_fd);
+    delete_select_channel (timer_fd);
+    close (inotify_fd);
+    close (timer_fd);
+    inotify_fd = -1;
+    timer_fd = -1;
+    timer_armed = FALSE;
+}
+
+#endif /* DIR_WATCH_INOTIFY */
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start watching of directory.
+ *
+ * @param vpath directory
+ * @param callback function to be called when entries of the directory have changed
+ *
+ * @return new watch or NULL if the directory can't be watched
+ */
+
+dir_watch_t *
+dir_watch_new (const vfs_path_t * vpath, dir_watch_cb_fn callback)
+{
+#ifdef DIR_WATCH_INOTIFY
+    dir_watch_t *watch;
+    const char *path;
+    int wd;
+
+    path = vfs_file_get_local_path (vpath);
+    if (path == NULL || !dir_watch_init ())
+        return NULL;
+
+    wd = inotify_add_watch (inotify_fd, path, DIR_WATCH_EVENTS);
+    if (wd == -1)
+    {
+        if (watches == NULL)
+            dir_watch_done ();
+        return NULL;
+    }
+
+    watch = g_new0 (dir_watch_t, 1);
+    watch->vpath = vfs_path_clone (vpath);
+    watch->callback = callback;
+    watch->wd = wd;
+    watch->names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    watches = g_slist_prepend (watches, watch);
+
+    return watch;
+#else
+    (void) vpath;
+    (void) callback;
+
+    return NULL;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+dir_watch_free (dir_watch_t * watch)
+{
+#ifdef DIR_WATCH_INOTIFY
+    GSList *l;
+
+    if (watch == NULL)
+        return;
+
+    watches = g_slist_remove (watches, watch);
+
+    /* the same directory can be watched more than once with the same descriptor */
+    for (l = watches; l != NULL; l = g_slist_next (l))
+        if (((dir_watch_t *) l->data)->wd == watch->wd)
+            break;
+    if (l == NULL)
+        inotify_rm_watch (inotify_fd, watch->wd);
+
+    vfs_path_free (watch->vpath);
+    g_hash_table_destroy (watch->names);
+    g_free (watch);
+
+    if (watches == NULL)
+        dir_watch_done ();
+#else
+    (void) watch;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether changes of the watched directory are known which were not reported yet.
+ * Events which were not read by the main loop yet are taken too.
+ */
+
+gboolean
+dir_watch_has_changes (dir_watch_t * watch)
+{
+#ifdef DIR_WATCH_INOTIFY
+    dir_watch_inotify_cb (inotify_fd, NULL);
+
+    return watch->overflow || g_hash_table_size (watch->names) != 0;
+#else
+    (void) watch;
+
+    return FALSE;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+const vfs_path_t *
+dir_watch_get_path (const dir_watch_t * watch)
+{
+    return watch->vpath;
+}
+
+/* --------------------------------------------------------------------------------------------- */
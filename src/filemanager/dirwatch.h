@@ -0,0 +1,42 @@
+/** \file dirwatch.h
+ *  \brief Header: watching of directories for changes
+ */
+
+#ifndef MC__DIRWATCH_H
+#define MC__DIRWATCH_H
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct dir_watch_struct dir_watch_t;
+
+/**
+ * Called when entries of the watched directory have changed.
+ *
+ * @param watch the watch
+ * @param names set of names of created, deleted, modified or renamed entries
+ * @param overflow if TRUE, changes were lost or the directory itself was removed or renamed:
+ *                 it should be reloaded completely
+ *
+ * @return FALSE if changes can't be applied now: they are reported again later
+ */
+typedef gboolean (*dir_watch_cb_fn) (dir_watch_t * watch, GHashTable * names, gboolean overflow);
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+dir_watch_t *dir_watch_new (const vfs_path_t * vpath, dir_watch_cb_fn callback);
+void dir_watch_free (dir_watch_t * watch);
+gboolean dir_watch_has_changes (dir_watch_t * watch);
+const vfs_path_t *dir_watch_get_path (const dir_watch_t * watch);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__DIRWATCH_H */
@@ -53,14 +53,18 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "lib/global.h"
+#include "lib/fileloc.h"        /* MC_MANIFEST_DIR */
+#include "lib/mcconfig.h"       /* mc_config_get_full_path() */
 #include "lib/tty/tty.h"
 #include "lib/tty/key.h"
 #include "lib/search.h"
@@ -82,7 +86,15 @@
 #include "tree.h"
 #include "midnight.h"           /* current_panel */
 #include "layout.h"             /* rotate_dash() */
-#include "ioblksize.h"          /* io_blksize() */
+#include "iotune.h"             /* io_tune_bufsize() */
+#include "copypool.h"
+#include "copyring.h"
+#include "copydelta.h"
+#include "copyjournal.h"
+#include "copyhash.h"
+#include "copyprefetch.h"
+#include "totalscan.h"
+#include "dirsize.h"            /* dir_size_cache_update() */
 
 #include "file.h"
 
@@ -104,6 +116,29 @@ const char *op_names[3] = {
 
 #define FILEOP_UPDATE_INTERVAL 2
 #define FILEOP_STALLING_INTERVAL 4
+/* Amount of data copied in the kernel at once, between updates of the progress */
+#define FILEOP_KERNEL_COPY_SIZE (8 * 1024 * 1024)
+/* Bigger files are not copied in parallel: they are limited by bandwidth, not latency */
+#define FILEOP_PARALLEL_MAX_SIZE (1024 * 1024)
+/* Number of files queued for each thread of parallel copying */
+#define FILEOP_PARALLEL_QUEUE 4
+/* Smaller files are not worth starting the reader and the writer threads */
+#define FILEOP_RING_MIN_SIZE (16 * 1024 * 1024)
+/* Block size used to compare contents of files in sync mode */
+#define FILEOP_SYNC_BUFSIZE (128 * 1024)
+/* Amount of data copied between records of the journal about a big file */
+#define FILEOP_JOURNAL_STEP (64 * 1024 * 1024)
+
+/*
+ * Local trees are erased with syscalls relative to descriptors of directories. Only
+ * recursive_erase() has such a variant: copy_dir_dir() and move_dir_dir() work via VFS
+ * on full paths, and erase_dir_iff_empty() reads each directory before rmdir() because
+ * errno of a failed rmdir() can't be trusted on all filesystems (see erase_dir()).
+ */
+#if defined (HAVE_OPENAT) && defined (HAVE_UNLINKAT) && defined (HAVE_FDOPENDIR) \
+    && defined (HAVE_FSTATAT)
+#define FILEOP_ERASE_AT 1
+#endif
 
 /*** file scope type declarations ****************************************************************/
 
@@ -113,7 +148,7 @@ struct link
     const struct vfs_class *vfs;
     dev_t dev;
     ino_t ino;
-    short linkcount;
+    nlink_t linkcount;          /* links of the inode which are not copied yet */
     mode_t st_mode;
     vfs_path_t *src_vpath;
     vfs_path_t *dst_vpath;
@@ -127,6 +162,23 @@ typedef enum
     DEST_FULL = 2               /* Created, fully copied */
 } dest_status_t;
 
+/* Ways to keep holes of sparse files in the target file */
+typedef enum
+{
+    SPARSE_NONE = 0,            /* write all data */
+    SPARSE_SEEK,                /* skip holes of the source file found with SEEK_DATA/SEEK_HOLE */
+    SPARSE_ZEROES               /* skip blocks of zeroes */
+} sparse_mode_t;
+
+/* Target directory whose attributes are set when its files copied in parallel are done */
+typedef struct
+{
+    vfs_path_t *dst_vpath;
+    struct stat src_stat;
+    int pending;                /* files of the directory in the copy pool */
+    gboolean complete;          /* all entries of the directory were processed */
+} copy_dir_attrs_t;
+
 /*
  * This array introduced to avoid translation problems. The former (op_names)
  * is assumed to be nouns, suitable in dialog box titles; this one should
@@ -168,23 +220,28 @@ static const char *prompt_parts[] = {
 
 /*** file scope variables ************************************************************************/
 
-/* the hard link cache */
-static GSList *linklist = NULL;
+/* the hard link cache: struct link by vfs, dev and ino */
+static GHashTable *linklist = NULL;
 
 /* the files-to-be-erased list */
 static GSList *erase_list = NULL;
 
 /*
- * In copy_dir_dir we use two additional single linked lists: The first -
- * variable name 'parent_dirs' - holds information about already copied
- * directories and is used to detect cyclic symbolic links.
+ * In copy_dir_dir we use two additional sets of directories: The first -
+ * variable name 'parent_dirs' - holds information about directories being
+ * copied (the ancestors of the current one) and is used to detect cyclic
+ * symbolic links. It is a list, as long as the depth of the tree.
  * The second ('dest_dirs' below) holds information about just created
  * target directories and is used to detect when an directory is copied
- * into itself (we don't want to copy infinitly).
- * Both lists don't use the linkcount and name structure members of struct
+ * into itself (we don't want to copy infinitly). It's a hash table like
+ * the hard link cache, as it grows with the number of copied directories.
+ * Both sets don't use the linkcount and name structure members of struct
  * link.
  */
-static GSList *dest_dirs = NULL;
+static GHashTable *dest_dirs = NULL;
+
+/* workers which copy small files of copy_dir_dir() in parallel */
+static copy_pool_t *copy_pool = NULL;
 
 static FileProgressStatus transform_error = FILE_CONT;
 
@@ -285,6 +342,71 @@ free_linklist (GSList * lp)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static guint
+link_hash (gconstpointer key)
+{
+    const struct link *lnk = (const struct link *) key;
+    guint64 ino = (guint64) lnk->ino;
+    guint64 dev = (guint64) lnk->dev;
+
+    return g_direct_hash (lnk->vfs) ^ (guint) ino ^ (guint) (ino >> 32) ^ (guint) (dev * 31)
+        ^ (guint) (dev >> 32);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+link_equal (gconstpointer a, gconstpointer b)
+{
+    const struct link *la = (const struct link *) a;
+    const struct link *lb = (const struct link *) b;
+
+    return (la->vfs == lb->vfs && la->ino == lb->ino && la->dev == lb->dev);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Add the entry to the cache of links (linklist or dest_dirs), creating it if needed */
+
+static void
+link_cache_add (GHashTable ** cache, struct link *lnk)
+{
+    if (*cache == NULL)
+        *cache = g_hash_table_new_full (link_hash, link_equal, NULL, free_link);
+
+    /* the entry is both the key and the value */
+    g_hash_table_replace (*cache, lnk, lnk);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static struct link *
+link_cache_lookup (GHashTable * cache, const struct vfs_class *vfs, const struct stat *sb)
+{
+    struct link key;
+
+    if (cache == NULL)
+        return NULL;
+
+    key.vfs = vfs;
+    key.ino = sb->st_ino;
+    key.dev = sb->st_dev;
+
+    return (struct link *) g_hash_table_lookup (cache, &key);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline void *
+free_link_cache (GHashTable * cache)
+{
+    if (cache != NULL)
+        g_hash_table_destroy (cache);
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static gboolean
 is_in_linklist (const GSList * lp, const vfs_path_t * vpath, const struct stat *sb)
 {
@@ -315,7 +437,6 @@ is_in_linklist (const GSList * lp, const vfs_path_t * vpath, const struct stat *
 static gboolean
 check_hardlinks (const vfs_path_t * src_vpath, const vfs_path_t * dst_vpath, struct stat *pstat)
 {
-    GSList *lp;
     struct link *lnk;
 
     const struct vfs_class *my_vfs;
@@ -328,47 +449,46 @@ check_hardlinks (const vfs_path_t * src_vpath, const vfs_path_t * dst_vpath, str
 
     my_vfs = vfs_path_get_by_index (src_vpath, -1)->class;
 
-    for (lp = linklist; lp != NULL; lp = g_slist_next (lp))
+    lnk = link_cache_lookup (linklist, my_vfs, pstat);
+    if (lnk != NULL)
     {
-        lnk = (struct link *) lp->data;
+        const struct vfs_class *lp_name_class;
+        int stat_result;
+
+        lp_name_class = vfs_path_get_last_path_vfs (lnk->src_vpath);
+        stat_result = mc_stat (lnk->src_vpath, &link_stat);
 
-        if (lnk->vfs == my_vfs && lnk->ino == ino && lnk->dev == dev)
+        if (stat_result == 0 && link_stat.st_ino == ino
+            && link_stat.st_dev == dev && lp_name_class == my_vfs)
         {
-            const struct vfs_class *lp_name_class;
-            int stat_result;
+            const struct vfs_class *p_class, *dst_name_class;
 
-            lp_name_class = vfs_path_get_last_path_vfs (lnk->src_vpath);
-            stat_result = mc_stat (lnk->src_vpath, &link_stat);
+            dst_name_class = vfs_path_get_last_path_vfs (dst_vpath);
+            p_class = vfs_path_get_last_path_vfs (lnk->dst_vpath);
 
-            if (stat_result == 0 && link_stat.st_ino == ino
-                && link_stat.st_dev == dev && lp_name_class == my_vfs)
+            if (dst_name_class == p_class &&
+                mc_stat (lnk->dst_vpath, &link_stat) == 0 &&
+                mc_link (lnk->dst_vpath, dst_vpath) == 0)
             {
-                const struct vfs_class *p_class, *dst_name_class;
-
-                dst_name_class = vfs_path_get_last_path_vfs (dst_vpath);
-                p_class = vfs_path_get_last_path_vfs (lnk->dst_vpath);
-
-                if (dst_name_class == p_class &&
-                    mc_stat (lnk->dst_vpath, &link_stat) == 0 &&
-                    mc_link (lnk->dst_vpath, dst_vpath) == 0)
-                    return TRUE;
+                /* all links of the inode are made, it won't be met again */
+                if (--lnk->linkcount == 0)
+                    g_hash_table_remove (linklist, lnk);
+                return TRUE;
             }
-
-            message (D_ERROR, MSG_ERROR, _("Cannot make the hardlink"));
-            return FALSE;
         }
+
+        message (D_ERROR, MSG_ERROR, _("Cannot make the hardlink"));
+        return FALSE;
     }
 
     lnk = g_new0 (struct link, 1);
-    if (lnk != NULL)
-    {
-        lnk->vfs = my_vfs;
-        lnk->ino = ino;
-        lnk->dev = dev;
-        lnk->src_vpath = vfs_path_clone (src_vpath);
-        lnk->dst_vpath = vfs_path_clone (dst_vpath);
-        linklist = g_slist_prepend (linklist, lnk);
-    }
+    lnk->vfs = my_vfs;
+    lnk->ino = ino;
+    lnk->dev = dev;
+    lnk->linkcount = pstat->st_nlink - 1;
+    lnk->src_vpath = vfs_path_clone (src_vpath);
+    lnk->dst_vpath = vfs_path_clone (dst_vpath);
+    link_cache_add (&linklist, lnk);
 
     return FALSE;
 }
@@ -622,6 +742,264 @@ progress_update_one (file_op_total_context_t * tctx, file_op_context_t * ctx, of
     return check_progress_buttons (ctx);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Update known sizes of the directories containing the local entry changed by the operation.
+ *
+ * @param old_st lstat of the entry before the change, NULL if it didn't exist
+ */
+
+static void
+dir_size_update_entry (const vfs_path_t * vpath, const struct stat *old_st)
+{
+    struct stat st;
+
+    if (dir_size_can_scan (vpath))
+        dir_size_cache_update (vpath, old_st, mc_lstat (vpath, &st) == 0 ? &st : NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Update known sizes of the directories containing the local tree removed or renamed in one
+ * piece. If the size of the tree is unknown or the tree is left in place partially, sizes of
+ * the directories are forgotten.
+ *
+ * @param st lstat of the tree before the change
+ * @param dst_vpath new name of the tree, NULL if it's removed
+ */
+
+static void
+dir_size_update_tree (const vfs_path_t * src_vpath, const struct stat *st,
+                      const vfs_path_t * dst_vpath)
+{
+    struct stat rest;
+    dir_size_t size;
+    gboolean confirmed;
+
+    if (!dir_size_can_scan (src_vpath))
+        return;
+
+    if (mc_lstat (src_vpath, &rest) == 0
+        || (S_ISDIR (st->st_mode) && !dir_size_lookup (st, &size, &confirmed)))
+    {
+        dir_size_cache_forget (src_vpath);
+        if (dst_vpath != NULL)
+            dir_size_cache_forget (dst_vpath);
+    }
+    else
+    {
+        dir_size_cache_update (src_vpath, st, NULL);
+        /* mtime of the renamed directory may be changed: take the size it had */
+        if (dst_vpath != NULL)
+            dir_size_cache_update (dst_vpath, NULL, st);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Read up to size bytes, less only at the end of the file */
+
+static ssize_t
+copy_sync_read (int fd, char *buf, size_t size)
+{
+    size_t done = 0;
+
+    while (done < size)
+    {
+        ssize_t n;
+
+        n = mc_read (fd, buf + done, size - done);
+        if (n < 0 && errno != EINTR)
+            return -1;
+        if (n == 0)
+            break;
+        if (n > 0)
+            done += (size_t) n;
+    }
+
+    return (ssize_t) done;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Compare contents of two files of the same size */
+
+static gboolean
+copy_sync_same_data (const vfs_path_t * src_vpath, const vfs_path_t * dst_vpath)
+{
+    int src_fd, dst_fd;
+    char *src_buf, *dst_buf;
+    gboolean same = FALSE;
+
+    src_fd = mc_open (src_vpath, O_RDONLY | O_LINEAR);
+    if (src_fd == -1)
+        return FALSE;
+
+    dst_fd = mc_open (dst_vpath, O_RDONLY | O_LINEAR);
+    if (dst_fd == -1)
+    {
+        mc_close (src_fd);
+        return FALSE;
+    }
+
+    src_buf = g_malloc (FILEOP_SYNC_BUFSIZE);
+    dst_buf = g_malloc (FILEOP_SYNC_BUFSIZE);
+
+    while (TRUE)
+    {
+        ssize_t src_n, dst_n;
+
+        src_n = copy_sync_read (src_fd, src_buf, FILEOP_SYNC_BUFSIZE);
+        dst_n = copy_sync_read (dst_fd, dst_buf, FILEOP_SYNC_BUFSIZE);
+
+        if (src_n < 0 || src_n != dst_n || memcmp (src_buf, dst_buf, (size_t) src_n) != 0)
+            break;
+
+        if (src_n == 0)
+        {
+            same = TRUE;
+            break;
+        }
+    }
+
+    g_free (dst_buf);
+    g_free (src_buf);
+    mc_close (dst_fd);
+    mc_close (src_fd);
+
+    return same;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Hash the file, or its first limit bytes if limit isn't negative. If from_disk is TRUE,
+ * the local file is dropped from the page cache before, so its data is read from the disk.
+ *
+ * @return TRUE on success, FALSE on error (errno is set)
+ */
+
+static gboolean
+copy_verify_hash_file (const vfs_path_t * vpath, off_t limit, gboolean from_disk,
+                       copy_hash_t * hash)
+{
+    int fd, saved_errno;
+    char *buf;
+    off_t done = 0;
+    gboolean ok = TRUE;
+
+    fd = mc_open (vpath, O_RDONLY | O_LINEAR);
+    if (fd == -1)
+        return FALSE;
+
+#ifdef HAVE_POSIX_FADVISE
+    if (from_disk && vfs_local_fd (fd) != -1)
+    {
+        /* dirty pages are not dropped */
+        (void) fsync (vfs_local_fd (fd));
+        (void) posix_fadvise (vfs_local_fd (fd), 0, 0, POSIX_FADV_DONTNEED);
+    }
+#else
+    (void) from_disk;
+#endif
+
+    buf = g_malloc (FILEOP_SYNC_BUFSIZE);
+
+    while (limit < 0 || done < limit)
+    {
+        ssize_t n;
+
+        n = mc_read (fd, buf, limit < 0 ? FILEOP_SYNC_BUFSIZE
+                     : (size_t) MIN ((off_t) FILEOP_SYNC_BUFSIZE, limit - done));
+        if (n == 0)
+            break;
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            ok = FALSE;
+            break;
+        }
+
+        copy_hash_update (hash, buf, (size_t) n);
+        done += n;
+    }
+
+    saved_errno = errno;
+    g_free (buf);
+    mc_close (fd);
+    errno = saved_errno;
+
+    return ok;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the target of the regular file is up to date in sync mode: it has the same
+ * size and modification time as the source or, if sync_compare_content is set, the same size
+ * and contents. Up to date targets are not copied, but counted as done.
+ *
+ * @param status set to the result of the progress update if the file is skipped
+ *
+ * @return TRUE if the file is skipped
+ */
+
+static gboolean
+copy_sync_skip (file_op_total_context_t * tctx, file_op_context_t * ctx,
+                const vfs_path_t * src_vpath, const struct stat *src_stat,
+                const vfs_path_t * dst_vpath, const struct stat *dst_stat,
+                FileProgressStatus * status)
+{
+    if (!ctx->sync || !S_ISREG (src_stat->st_mode) || !S_ISREG (dst_stat->st_mode)
+        || src_stat->st_size != dst_stat->st_size)
+        return FALSE;
+
+    if (src_stat->st_mtime != dst_stat->st_mtime)
+    {
+        struct utimbuf utb;
+
+        if (sync_compare_content == 0 || !copy_sync_same_data (src_vpath, dst_vpath))
+            return FALSE;
+
+        /* the next sync won't need to read the file: copied files get the time of their
+           sources too, whether attributes are preserved or not */
+        utb.actime = src_stat->st_atime;
+        utb.modtime = src_stat->st_mtime;
+        mc_utime (dst_vpath, &utb);
+    }
+
+    tctx->skipped_count++;
+    tctx->skipped_bytes += (uintmax_t) src_stat->st_size;
+    tctx->copied_bytes = tctx->progress_bytes + (uintmax_t) src_stat->st_size;
+    *status = progress_update_one (tctx, ctx, src_stat->st_size);
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check the target of the file of the copied directory in sync mode, see copy_sync_skip().
+ * Up to date targets are found without opening the files or querying the user.
+ */
+
+static gboolean
+copy_dir_sync_skip (file_op_total_context_t * tctx, file_op_context_t * ctx,
+                    const vfs_path_t * src_vpath, const struct stat *src_stat, const char *dst_dir,
+                    FileProgressStatus * status)
+{
+    vfs_path_t *dst_vpath;
+    struct stat dst_stat;
+    gboolean skipped;
+
+    if (!ctx->sync || !S_ISREG (src_stat->st_mode))
+        return FALSE;
+
+    dst_vpath = vfs_path_build_filename (dst_dir, x_basename (vfs_path_as_str (src_vpath)),
+                                         (char *) NULL);
+    skipped = mc_stat (dst_vpath, &dst_stat) == 0
+        && copy_sync_skip (tctx, ctx, src_vpath, src_stat, dst_vpath, &dst_stat, status);
+    vfs_path_free (dst_vpath);
+
+    return skipped;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static FileProgressStatus
@@ -896,7 +1274,8 @@ copy_file_file_display_progress (file_op_total_context_t * tctx, file_op_context
             if (total_secs < 1)
                 total_secs = 1;
 
-            tctx->bps = tctx->copied_bytes / total_secs;
+            /* files skipped in sync mode take no time */
+            tctx->bps = (tctx->copied_bytes - tctx->skipped_bytes) / total_secs;
             tctx->eta_secs = (tctx->bps != 0) ? remain_bytes / tctx->bps : 0;
         }
 #else
@@ -908,6 +1287,242 @@ copy_file_file_display_progress (file_op_total_context_t * tctx, file_op_context
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Choose the way to keep holes of the source file. Holes are left by seeking in the target
+ * file, so it should be a local regular file, and not appended to: skipped blocks of a device
+ * would keep their old data.
+ *
+ * @param dst_stat stat of the opened target
+ */
+
+static sparse_mode_t
+copy_file_file_sparse_mode (const vfs_path_t * src_vpath, const struct stat *src_stat,
+                            const vfs_path_t * dst_vpath, const struct stat *dst_stat,
+                            gboolean appending)
+{
+    if (appending || !S_ISREG (src_stat->st_mode) || src_stat->st_size == 0
+        || !S_ISREG (dst_stat->st_mode) || !vfs_file_is_local (dst_vpath))
+        return SPARSE_NONE;
+
+    /* holes of files in archives and on remote hosts are unknown */
+    if (!vfs_file_is_local (src_vpath))
+        return SPARSE_ZEROES;
+
+#ifdef HAVE_STRUCT_STAT_ST_BLOCKS
+    /* the file occupies less blocks than its size requires */
+    if ((off_t) src_stat->st_blocks * 512 < src_stat->st_size)
+#ifdef SEEK_DATA
+        return SPARSE_SEEK;
+#else
+        return SPARSE_ZEROES;
+#endif
+#endif
+
+    return SPARSE_NONE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the next data of the local source file and move both files there.
+ *
+ * @param pos current offset in both files
+ * @param file_size size of the source file
+ * @param data_end the end of found data is returned here
+ *
+ * @return offset of found data (data_end if there is no more data), -1 if holes can't be found
+ */
+
+static off_t
+copy_file_file_seek_data (int src_desc, int dest_desc, off_t pos, off_t file_size,
+                          off_t * data_end)
+{
+#ifdef SEEK_DATA
+    off_t data, hole;
+
+    data = mc_lseek (src_desc, pos, SEEK_DATA);
+    if (data == -1 && errno == ENXIO)
+    {
+        /* only a hole is left */
+        data = hole = MAX (pos, file_size);
+    }
+    else if (data == -1 || (hole = mc_lseek (src_desc, data, SEEK_HOLE)) == -1)
+    {
+        mc_lseek (src_desc, pos, SEEK_SET);
+        return -1;
+    }
+
+    if (mc_lseek (src_desc, data, SEEK_SET) != data || mc_lseek (dest_desc, data, SEEK_SET) != data)
+    {
+        mc_lseek (src_desc, pos, SEEK_SET);
+        mc_lseek (dest_desc, pos, SEEK_SET);
+        return -1;
+    }
+
+    *data_end = hole;
+    return data;
+#else
+    (void) src_desc;
+    (void) dest_desc;
+    (void) pos;
+    (void) file_size;
+    (void) data_end;
+
+    return -1;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Cut the target of the interrupted copy to the part recorded in the journal.
+ *
+ * @return TRUE on success, FALSE if the target can't be cut here (it's not local)
+ */
+
+static gboolean
+copy_resume_truncate (const vfs_path_t * dst_vpath, off_t offset)
+{
+    int fd;
+    gboolean ok;
+
+    fd = mc_open (dst_vpath, O_WRONLY | O_LINEAR);
+    if (fd == -1)
+        return FALSE;
+
+    ok = vfs_local_fd (fd) != -1 && ftruncate (vfs_local_fd (fd), offset) == 0;
+    mc_close (fd);
+
+    return ok;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+is_zero_block (const char *buf, size_t len)
+{
+    return (len != 0 && buf[0] == '\0' && memcmp (buf, buf + 1, len - 1) == 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Set mode and times of the target directory when all its entries have been copied */
+
+static void
+copy_dir_set_attrs (file_op_context_t * ctx, const vfs_path_t * dst_vpath, struct stat *cbuf)
+{
+    if (ctx->preserve)
+    {
+        struct utimbuf utb;
+
+        mc_chmod (dst_vpath, cbuf->st_mode & ctx->umask_kill);
+        utb.actime = cbuf->st_atime;
+        utb.modtime = cbuf->st_mtime;
+        mc_utime (dst_vpath, &utb);
+    }
+    else
+    {
+        cbuf->st_mode = umask (-1);
+        umask (cbuf->st_mode);
+        cbuf->st_mode = 0100777 & ~cbuf->st_mode;
+        mc_chmod (dst_vpath, cbuf->st_mode & ctx->umask_kill);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Account the file copied by the pool. If the pool failed to copy it, copy it here, so
+ * the overwrite query or the error is shown and handled as usual.
+ */
+
+static FileProgressStatus
+copy_pool_task_done (file_op_total_context_t * tctx, file_op_context_t * ctx,
+                     copy_pool_task_t * task)
+{
+    copy_dir_attrs_t *attrs = (copy_dir_attrs_t *) task->data;
+    FileProgressStatus status = FILE_CONT;
+
+    if (task->error == 0)
+    {
+        vfs_path_t *vpath;
+
+        vpath = vfs_path_from_str (task->src_path);
+        file_progress_show_source (ctx, vpath);
+        if (ctx->journal != NULL)
+        {
+            struct stat st;
+
+            if (mc_stat (vpath, &st) == 0)
+                copy_journal_done (ctx->journal, task->dst_path, &st);
+        }
+        vfs_path_free (vpath);
+
+        /* the pool creates new files only */
+        vpath = vfs_path_from_str (task->dst_path);
+        dir_size_update_entry (vpath, NULL);
+        vfs_path_free (vpath);
+
+        tctx->copied_bytes = tctx->progress_bytes + task->size;
+        status = progress_update_one (tctx, ctx, task->size);
+    }
+    else if (!task->cancelled)
+        status = copy_file_file (tctx, ctx, task->src_path, task->dst_path);
+
+    if (--attrs->pending == 0 && attrs->complete)
+    {
+        copy_dir_set_attrs (ctx, attrs->dst_vpath, &attrs->src_stat);
+        vfs_path_free (attrs->dst_vpath);
+        g_free (attrs);
+    }
+
+    copy_pool_task_free (task);
+
+    return status;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Handle files copied by the pool, waiting until no more than max_pending files are left
+ * in it. If the operation is aborted, remaining files are cancelled.
+ */
+
+static FileProgressStatus
+copy_pool_collect (file_op_total_context_t * tctx, file_op_context_t * ctx, int max_pending)
+{
+    FileProgressStatus status = FILE_CONT;
+
+    while (TRUE)
+    {
+        copy_pool_task_t *task;
+        gboolean wait;
+
+        wait = copy_pool_pending (copy_pool) > max_pending;
+        task = copy_pool_pop (copy_pool, wait);
+
+        if (task != NULL)
+        {
+            if (copy_pool_task_done (tctx, ctx, task) == FILE_ABORT)
+                status = FILE_ABORT;
+        }
+        else if (!wait)
+            break;
+        else if (status != FILE_ABORT)
+        {
+            /* let the user abort while waiting */
+            mc_refresh ();
+            status = check_progress_buttons (ctx);
+            if (status != FILE_ABORT)
+                status = FILE_CONT;
+        }
+
+        if (status == FILE_ABORT)
+        {
+            copy_pool_cancel (copy_pool);
+            max_pending = 0;
+        }
+    }
+
+    return status;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 /* {{{ Move routines */
@@ -917,6 +1532,7 @@ move_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx, const c
 {
     struct stat src_stats, dst_stats;
     FileProgressStatus return_status = FILE_CONT;
+    gboolean dst_exists = FALSE;
     gboolean copy_done = FALSE;
     gboolean old_ask_overwrite;
     vfs_path_t *src_vpath, *dst_vpath;
@@ -959,6 +1575,8 @@ move_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx, const c
             goto ret;
         }
 
+        dst_exists = TRUE;
+
         if (S_ISDIR (dst_stats.st_mode))
         {
             message (D_ERROR, MSG_ERROR, _("Cannot overwrite directory \"%s\""), d);
@@ -967,7 +1585,9 @@ move_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx, const c
             goto ret;
         }
 
-        if (confirm_overwrite)
+        /* targets of the interrupted operation are continued by copy_file_file() */
+        if (confirm_overwrite
+            && copy_journal_lookup (ctx->journal, d, &src_stats, NULL) == COPY_JOURNAL_NONE)
         {
             return_status = query_replace (ctx, d, &src_stats, &dst_stats);
             if (return_status != FILE_CONT)
@@ -982,12 +1602,17 @@ move_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx, const c
         {
             return_status = make_symlink (ctx, s, d);
             if (return_status == FILE_CONT)
+            {
+                dir_size_update_entry (dst_vpath, dst_exists ? &dst_stats : NULL);
                 goto retry_src_remove;
+            }
             goto ret;
         }
 
         if (mc_rename (src_vpath, dst_vpath) == 0)
         {
+            dir_size_update_entry (src_vpath, &src_stats);
+            dir_size_update_entry (dst_vpath, dst_exists ? &dst_stats : NULL);
             return_status = progress_update_one (tctx, ctx, src_stats.st_size);
             goto ret;
         }
@@ -1046,6 +1671,8 @@ move_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx, const c
         goto ret;
     }
 
+    dir_size_update_entry (src_vpath, &src_stats);
+
     if (!copy_done)
         return_status = progress_update_one (tctx, ctx, src_stats.st_size);
 
@@ -1066,6 +1693,7 @@ static FileProgressStatus
 erase_file (file_op_total_context_t * tctx, file_op_context_t * ctx, const vfs_path_t * vpath)
 {
     struct stat buf;
+    gboolean sized;
 
     file_progress_show_deleting (ctx, vfs_path_as_str (vpath), &tctx->progress_count);
     file_progress_show_count (ctx, tctx->progress_count, ctx->progress_count);
@@ -1074,11 +1702,8 @@ erase_file (file_op_total_context_t * tctx, file_op_context_t * ctx, const vfs_p
 
     mc_refresh ();
 
-    if (tctx->progress_count != 0 && mc_lstat (vpath, &buf) != 0)
-    {
-        /* ignore, most likely the mc_unlink fails, too */
-        buf.st_size = 0;
-    }
+    /* the file is taken off known sizes of its directories */
+    sized = dir_size_can_scan (vpath) && mc_lstat (vpath, &buf) == 0;
 
     while (mc_unlink (vpath) != 0 && !ctx->skip_all)
     {
@@ -1094,6 +1719,9 @@ erase_file (file_op_total_context_t * tctx, file_op_context_t * ctx, const vfs_p
         break;
     }
 
+    if (sized)
+        dir_size_update_entry (vpath, &buf);
+
     if (tctx->progress_count == 0)
         return FILE_CONT;
 
@@ -1114,6 +1742,8 @@ recursive_erase (file_op_total_context_t * tctx, file_op_context_t * ctx, const
     struct dirent *next;
     DIR *reading;
     const char *s;
+    struct stat st;
+    gboolean sized;
     FileProgressStatus return_status = FILE_CONT;
 
     reading = mc_opendir (vpath);
@@ -1155,6 +1785,9 @@ recursive_erase (file_op_total_context_t * tctx, file_op_context_t * ctx, const
 
     mc_refresh ();
 
+    /* files of the directory have been taken off sizes already */
+    sized = dir_size_can_scan (vpath) && mc_lstat (vpath, &st) == 0;
+
     while (my_rmdir (s) != 0 && !ctx->skip_all)
     {
         return_status = file_error (_("Cannot remove directory \"%s\"\n%s"), s);
@@ -1167,8 +1800,154 @@ recursive_erase (file_op_total_context_t * tctx, file_op_context_t * ctx, const
         break;
     }
 
+    if (sized)
+        dir_size_update_entry (vpath, &st);
+
+    return return_status;
+}
+
+#ifdef FILEOP_ERASE_AT
+/* --------------------------------------------------------------------------------------------- */
+/** The same as erase_file(), for the file name relative to the directory descriptor */
+
+static FileProgressStatus
+erase_file_at (file_op_total_context_t * tctx, file_op_context_t * ctx, int dfd,
+               const char *name, const char *path)
+{
+    file_progress_show_deleting (ctx, path, &tctx->progress_count);
+    file_progress_show_count (ctx, tctx->progress_count, ctx->progress_count);
+    if (check_progress_buttons (ctx) == FILE_ABORT)
+        return FILE_ABORT;
+
+    mc_refresh ();
+
+    while (unlinkat (dfd, name, 0) != 0 && !ctx->skip_all)
+    {
+        int return_status;
+
+        return_status = file_error (_("Cannot delete file \"%s\"\n%s"), path);
+        if (return_status == FILE_ABORT)
+            return return_status;
+        if (return_status == FILE_RETRY)
+            continue;
+        if (return_status == FILE_SKIPALL)
+            ctx->skip_all = TRUE;
+        break;
+    }
+
+    if (tctx->progress_count == 0)
+        return FILE_CONT;
+
+    return check_progress_buttons (ctx);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * The same as recursive_erase(), for the local tree. Each directory is opened relative to
+ * its parent and its entries are removed relative to it, so paths are not resolved again
+ * for every file and no vfs_path_t is built. Types of entries are taken from d_type,
+ * if the filesystem fills it.
+ *
+ * @param parent_fd descriptor of the parent directory or AT_FDCWD
+ * @param name name of the directory relative to parent_fd
+ * @param path full path of the directory, for messages. Names of entries are appended
+ *             to it while they are erased
+ */
+
+static FileProgressStatus
+recursive_erase_at (file_op_total_context_t * tctx, file_op_context_t * ctx, int parent_fd,
+                    const char *name, GString * path)
+{
+    int dfd;
+    DIR *reading;
+    struct dirent *next;
+    FileProgressStatus return_status = FILE_CONT;
+
+    dfd = openat (parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (dfd == -1 && errno == EMFILE)
+    {
+        vfs_path_t *vpath;
+
+        /* too deep tree: erase the rest via VFS */
+        vpath = vfs_path_from_str (path->str);
+        return_status = recursive_erase (tctx, ctx, vpath);
+        vfs_path_free (vpath);
+        return return_status;
+    }
+    if (dfd == -1)
+        return FILE_RETRY;
+
+    reading = fdopendir (dfd);
+    if (reading == NULL)
+    {
+        close (dfd);
+        return FILE_RETRY;
+    }
+
+    while (return_status != FILE_ABORT && (next = readdir (reading)) != NULL)
+    {
+        gsize len = path->len;
+        gboolean is_dir;
+
+        if (DIR_IS_DOT (next->d_name) || DIR_IS_DOTDOT (next->d_name))
+            continue;
+
+        if (len == 0 || !IS_PATH_SEP (path->str[len - 1]))
+            g_string_append_c (path, PATH_SEP);
+        g_string_append (path, next->d_name);
+
+#ifdef HAVE_STRUCT_DIRENT_D_TYPE
+        if (next->d_type != DT_UNKNOWN)
+            is_dir = next->d_type == DT_DIR;
+        else
+#endif
+        {
+            struct stat buf;
+
+            if (fstatat (dfd, next->d_name, &buf, AT_SYMLINK_NOFOLLOW) != 0)
+            {
+                closedir (reading);
+                g_string_truncate (path, len);
+                return FILE_RETRY;
+            }
+            is_dir = S_ISDIR (buf.st_mode);
+        }
+
+        if (is_dir)
+            return_status = recursive_erase_at (tctx, ctx, dfd, next->d_name, path);
+        else
+            return_status = erase_file_at (tctx, ctx, dfd, next->d_name, path->str);
+
+        g_string_truncate (path, len);
+    }
+    /* dfd is closed too */
+    closedir (reading);
+
+    if (return_status == FILE_ABORT)
+        return FILE_ABORT;
+
+    file_progress_show_deleting (ctx, path->str, NULL);
+    file_progress_show_count (ctx, tctx->progress_count, ctx->progress_count);
+    if (check_progress_buttons (ctx) == FILE_ABORT)
+        return FILE_ABORT;
+
+    mc_refresh ();
+
+    while (unlinkat (parent_fd, name, AT_REMOVEDIR) != 0 && !ctx->skip_all)
+    {
+        return_status = file_error (_("Cannot remove directory \"%s\"\n%s"), path->str);
+        if (return_status == FILE_RETRY)
+            continue;
+        if (return_status == FILE_ABORT)
+            break;
+        if (return_status == FILE_SKIPALL)
+            ctx->skip_all = TRUE;
+        break;
+    }
+
     return return_status;
 }
+#endif /* FILEOP_ERASE_AT */
 
 /* --------------------------------------------------------------------------------------------- */
 /** Return -1 on error, 1 if there are no entries besides "." and ".." 
@@ -1215,6 +1994,11 @@ erase_dir_iff_empty (file_op_context_t * ctx, const vfs_path_t * vpath, size_t c
 
     if (check_dir_is_empty (vpath) == 1)        /* not empty or error */
     {
+        struct stat st;
+        gboolean sized;
+
+        sized = dir_size_can_scan (vpath) && mc_lstat (vpath, &st) == 0;
+
         while (my_rmdir (s) != 0 && !ctx->skip_all)
         {
             error = file_error (_("Cannot remove directory \"%s\"\n%s"), s);
@@ -1223,6 +2007,9 @@ erase_dir_iff_empty (file_op_context_t * ctx, const vfs_path_t * vpath, size_t c
             if (error != FILE_RETRY)
                 break;
         }
+
+        if (sized)
+            dir_size_update_entry (vpath, &st);
     }
 
     return error;
@@ -1263,6 +2050,15 @@ panel_get_file (WPanel * panel)
     return panel->dir.list[panel->selected].fname;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Check whether the marked entry is processed as a directory: symlinks are if they're followed */
+
+static gboolean
+panel_entry_is_dir (file_entry_t * fe, gboolean follow_links)
+{
+    return (S_ISDIR (fe->st.st_mode) || (follow_links && link_isdir (fe)));
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * panel_compute_totals:
@@ -1289,7 +2085,7 @@ panel_compute_totals (const WPanel * panel, dirsize_status_msg_t * sm, size_t *
 
         s = &panel->dir.list[i].st;
 
-        if (S_ISDIR (s->st_mode))
+        if (panel_entry_is_dir (&panel->dir.list[i], compute_symlinks))
         {
             vfs_path_t *p;
             FileProgressStatus status;
@@ -1308,7 +2104,78 @@ panel_compute_totals (const WPanel * panel, dirsize_status_msg_t * sm, size_t *
         }
     }
 
-    return FILE_CONT;
+    return FILE_CONT;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start computing of totals in background, if the files are local. The operation
+ * is started at once then, and totals grow while it goes on.
+ *
+ * @return TRUE if the scan is started
+ */
+
+static gboolean
+panel_operate_scan_totals (const WPanel * panel, const char *source, file_op_context_t * ctx)
+{
+    GPtrArray *paths;
+    size_t count = 0;
+    uintmax_t bytes = 0;
+
+    if (source != NULL)
+    {
+        vfs_path_t *p;
+        gboolean local;
+
+        p = vfs_path_from_str (source);
+        local = total_scan_can_scan (p);
+        vfs_path_free (p);
+
+        if (!local)
+            return FALSE;
+
+        paths = g_ptr_array_new_with_free_func (g_free);
+        g_ptr_array_add (paths, g_strdup (source));
+    }
+    else
+    {
+        int i;
+
+        if (!total_scan_can_scan (panel->cwd_vpath))
+            return FALSE;
+
+        paths = g_ptr_array_new_with_free_func (g_free);
+
+        for (i = 0; i < panel->dir.len; i++)
+        {
+            file_entry_t *fe = &panel->dir.list[i];
+
+            if (!fe->f.marked)
+                continue;
+
+            if (panel_entry_is_dir (fe, ctx->follow_links))
+                g_ptr_array_add (paths, g_build_filename (vfs_path_as_str (panel->cwd_vpath),
+                                                          fe->fname, (char *) NULL));
+            else
+            {
+                count++;
+                bytes += (uintmax_t) fe->st.st_size;
+            }
+        }
+    }
+
+    ctx->totals_scan = total_scan_start (paths, ctx->follow_links, count, bytes);
+    if (ctx->totals_scan == NULL)
+    {
+        g_ptr_array_free (paths, TRUE);
+        return FALSE;
+    }
+
+    ctx->progress_count = count;
+    ctx->progress_bytes = bytes;
+    ctx->progress_totals_computed = TRUE;
+
+    return TRUE;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1325,7 +2192,10 @@ panel_operate_init_totals (const WPanel * panel, const char *source, file_op_con
         return FILE_CONT;
 #endif
 
-    if (verbose && file_op_compute_totals)
+    if (verbose && file_op_compute_totals && file_op_background_totals
+        && panel_operate_scan_totals (panel, source, ctx))
+        status = FILE_CONT;
+    else if (verbose && file_op_compute_totals)
     {
         dirsize_status_msg_t dsm;
 
@@ -1371,6 +2241,172 @@ panel_operate_init_totals (const WPanel * panel, const char *source, file_op_con
     return status;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+static gint
+panel_operate_compare_names (gconstpointer a, gconstpointer b)
+{
+    return strcmp (*(const char *const *) a, *(const char *const *) b);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Name the journal of the operation after its sources and its destination, so the same
+ * operation started again finds the journal left by the interrupted one. Marked files are
+ * taken by name, so the key doesn't depend on the sort order of the panel.
+ */
+
+static char *
+panel_operate_journal_key (const WPanel * panel, FileOperation operation, const char *source,
+                           const char *dest)
+{
+    GChecksum *sum;
+    const char *cwd;
+    char *key;
+
+    sum = g_checksum_new (G_CHECKSUM_MD5);
+    g_checksum_update (sum, (const guchar *) (operation == OP_MOVE ? "move" : "copy"), 5);
+    cwd = vfs_path_as_str (panel->cwd_vpath);
+    g_checksum_update (sum, (const guchar *) cwd, strlen (cwd) + 1);
+    g_checksum_update (sum, (const guchar *) dest, strlen (dest) + 1);
+
+    if (source != NULL)
+        g_checksum_update (sum, (const guchar *) source, strlen (source) + 1);
+    else
+    {
+        GPtrArray *names;
+        guint i;
+
+        names = g_ptr_array_sized_new ((guint) panel->marked);
+        for (i = 0; i < (guint) panel->dir.len; i++)
+            if (panel->dir.list[i].f.marked)
+                g_ptr_array_add (names, panel->dir.list[i].fname);
+        g_ptr_array_sort (names, panel_operate_compare_names);
+
+        for (i = 0; i < names->len; i++)
+        {
+            const char *name = (const char *) g_ptr_array_index (names, i);
+
+            g_checksum_update (sum, (const guchar *) name, strlen (name) + 1);
+        }
+
+        g_ptr_array_free (names, TRUE);
+    }
+
+    key = g_strdup (g_checksum_get_string (sum));
+    g_checksum_free (sum);
+
+    return key;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create the manifest for digests of files verified by the operation. Its lines are
+ * in the format of 'xxhsum -H64'.
+ */
+
+static FILE *
+panel_operate_open_manifest (void)
+{
+    char *dir, *name;
+    char stamp[BUF_TINY];
+    time_t now;
+    FILE *f = NULL;
+
+    now = time (NULL);
+    strftime (stamp, sizeof (stamp), "%Y%m%d-%H%M%S", localtime (&now));
+
+    dir = mc_config_get_full_path (MC_MANIFEST_DIR);
+    name = g_strdup_printf ("%s" PATH_SEP_STR "%s-%d.xxh64", dir, stamp, (int) getpid ());
+
+    if (g_mkdir_with_parents (dir, S_IRWXU) == 0)
+        f = fopen (name, "w");
+
+    if (f == NULL && !mc_global.we_are_background)
+        message (D_ERROR, MSG_ERROR, _("Cannot create manifest file \"%s\"\n%s"), name,
+                 unix_error_string (errno));
+
+    g_free (name);
+    g_free (dir);
+
+    return f;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Queue the source for read-ahead by the path it's copied by in panel_operate() */
+
+static void
+panel_operate_prefetch_add (copy_prefetch_t * prefetch, const WPanel * panel, const char *name,
+                            const struct stat *st, gboolean unescape)
+{
+    vfs_path_t *vpath;
+    char *path;
+
+    if (g_path_is_absolute (name))
+        vpath = vfs_path_from_str (name);
+    else
+        vpath = vfs_path_append_new (panel->cwd_vpath, name, (char *) NULL);
+
+    path = unescape ? strutils_shell_unescape (vfs_path_as_str (vpath))
+        : g_strdup (vfs_path_as_str (vpath));
+    copy_prefetch_add (prefetch, path, st);
+
+    g_free (path);
+    vfs_path_free (vpath);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start read-ahead of files copied by the operation: the single source or marked files
+ * of the panel. Files moved or cloned within the filesystem are not read, so only
+ * the copying to other device is helped by it.
+ */
+
+static copy_prefetch_t *
+panel_operate_prefetch_new (const WPanel * panel, const char *source,
+                            const struct stat *source_stat, const vfs_path_t * dest_vpath)
+{
+    struct stat src_stat, dst_stat;
+    int dst_result;
+    copy_prefetch_t *prefetch;
+    int i;
+
+    if (copy_prefetch_size <= 0 || vfs_file_get_local_path (panel->cwd_vpath) == NULL
+        || mc_stat (panel->cwd_vpath, &src_stat) != 0)
+        return NULL;
+
+    /* the target of the single file or directory may not exist yet */
+    dst_result = mc_stat (dest_vpath, &dst_stat);
+    if (dst_result != 0)
+    {
+        char *parent;
+        vfs_path_t *parent_vpath;
+
+        parent = g_path_get_dirname (vfs_path_as_str (dest_vpath));
+        parent_vpath = vfs_path_from_str (parent);
+        dst_result = mc_stat (parent_vpath, &dst_stat);
+        vfs_path_free (parent_vpath);
+        g_free (parent);
+    }
+
+    if (dst_result == 0 && dst_stat.st_dev == src_stat.st_dev)
+        return NULL;
+
+    prefetch = copy_prefetch_new ((off_t) copy_prefetch_size * 1024 * 1024);
+    if (prefetch == NULL)
+        return NULL;
+
+    if (source != NULL)
+        panel_operate_prefetch_add (prefetch, panel, source, source_stat, FALSE);
+    else
+        for (i = 0; i < panel->dir.len; i++)
+            if (panel->dir.list[i].f.marked)
+                panel_operate_prefetch_add (prefetch, panel, panel->dir.list[i].fname,
+                                            &panel->dir.list[i].st, TRUE);
+
+    return prefetch;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Generate user prompt for panel operation.
@@ -1497,6 +2533,16 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
     int open_flags;
     vfs_path_t *src_vpath = NULL, *dst_vpath = NULL;
     char *buf = NULL;
+    vfs_copy_method_t copy_with;
+    sparse_mode_t sparse;
+    copy_ring_t *ring = NULL;
+    copy_delta_t *delta = NULL;
+    gboolean use_delta = FALSE;
+    gboolean resumed = FALSE;
+    copy_hash_t *hash = NULL;
+    struct stat dst_lstat;
+    const struct stat *dst_old = NULL;
+    gboolean dst_touched = FALSE;
 
     /* FIXME: We should not be using global variables! */
     ctx->do_reget = 0;
@@ -1562,8 +2608,47 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
             goto ret_fast;
         }
 
-        /* Should we replace destination? */
-        if (tctx->ask_overwrite)
+        /* continue the interrupted operation: copied data is not read again */
+        if (S_ISREG (dst_stat.st_mode))
+        {
+            off_t offset;
+
+            switch (copy_journal_lookup (ctx->journal, dst_path, &src_stat, &offset))
+            {
+            case COPY_JOURNAL_DONE:
+                if (dst_stat.st_size == offset)
+                {
+                    tctx->copied_bytes = tctx->progress_bytes + (uintmax_t) offset;
+                    return_status = progress_update_one (tctx, ctx, offset);
+                    goto ret_fast;
+                }
+                break;
+
+            case COPY_JOURNAL_PARTIAL:
+                /* the recorded part was synced: the target can't be shorter unless changed */
+                if (dst_stat.st_size >= offset && offset > 0
+                    && copy_resume_truncate (dst_vpath, offset))
+                {
+                    ctx->do_reget = offset;
+                    ctx->do_append = TRUE;
+                    resumed = TRUE;
+                }
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        if (!resumed
+            && copy_sync_skip (tctx, ctx, src_vpath, &src_stat, dst_vpath, &dst_stat,
+                               &return_status))
+            goto ret_fast;
+
+        /* Should we replace destination? In sync mode, changed files are replaced
+           without asking unless the target is newer */
+        if (tctx->ask_overwrite && !resumed
+            && (!ctx->sync || dst_stat.st_mtime > src_stat.st_mtime))
         {
             ctx->do_reget = 0;
             return_status = query_replace (ctx, dst_path, &src_stat, &dst_stat);
@@ -1572,6 +2657,11 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
         }
     }
 
+    /* the target is created or changed from here on */
+    dst_touched = dir_size_can_scan (dst_vpath);
+    if (dst_touched && mc_lstat (dst_vpath, &dst_lstat) == 0)
+        dst_old = &dst_lstat;
+
     if (!ctx->do_append)
     {
         /* Check the hardlinks */
@@ -1687,8 +2777,18 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
     utb.modtime = src_stat.st_mtime;
     file_size = src_stat.st_size;
 
+    /* a big local target is updated in place: only changed blocks are written */
+    use_delta = dst_exists && !ctx->do_append && ctx->do_reget == 0 && !ctx->verify
+        && copy_delta_min_size > 0
+        && file_size >= (off_t) copy_delta_min_size * 1024 * 1024
+        && dst_stat.st_size >= (off_t) copy_delta_min_size * 1024 * 1024
+        && S_ISREG (dst_stat.st_mode) && vfs_file_is_local (src_vpath)
+        && vfs_file_is_local (dst_vpath);
+
     open_flags = O_WRONLY;
-    if (dst_exists)
+    if (use_delta)
+        open_flags = O_RDWR;
+    else if (dst_exists)
     {
         if (ctx->do_append)
             open_flags |= O_APPEND;
@@ -1739,8 +2839,46 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
         goto ret;
     }
 
-    /* try preallocate space; if fail, try copy anyway */
-    while (vfs_preallocate (dest_desc, file_size, appending ? dst_stat.st_size : 0) != 0)
+    copy_with = (vfs_copy_method_t) CLAMP (copy_method, VFS_COPY_READ_WRITE, VFS_COPY_CLONE);
+
+    /* blocks are compared through buffers; the target has its space allocated already */
+    use_delta = use_delta && vfs_local_fd (src_desc) != -1 && vfs_local_fd (dest_desc) != -1;
+    if (use_delta)
+        copy_with = VFS_COPY_READ_WRITE;
+
+    /* verified data must pass through the buffer */
+    if (ctx->verify)
+        copy_with = VFS_COPY_READ_WRITE;
+
+    /* try to share data with the source file; there is nothing to preallocate then */
+    if (copy_with == VFS_COPY_CLONE && file_size > ctx->do_reget
+        && vfs_clone_file (dest_desc, src_desc, ctx->do_reget,
+                           appending ? dst_stat.st_size : 0) == 0)
+    {
+        struct timeval tv_current;
+
+        gettimeofday (&tv_current, NULL);
+        tctx->copied_bytes = tctx->progress_bytes + file_size;
+        copy_file_file_display_progress (tctx, ctx, tv_current, tv_transfer_start, file_size,
+                                         file_size - ctx->do_reget);
+        file_progress_show (ctx, file_size, file_size, "", TRUE);
+
+        dst_status = DEST_FULL;
+        return_status = FILE_CONT;
+        goto ret;
+    }
+
+    sparse = use_delta ? SPARSE_NONE
+        : copy_file_file_sparse_mode (src_vpath, &src_stat, dst_vpath, &dst_stat, appending);
+    /* holes are read as zeroes to be hashed */
+    if (ctx->verify && sparse == SPARSE_SEEK)
+        sparse = SPARSE_ZEROES;
+    if (sparse == SPARSE_ZEROES)
+        copy_with = VFS_COPY_READ_WRITE;
+
+    /* try preallocate space; if fail, try copy anyway. Holes of sparse files would be filled */
+    while (!use_delta && sparse == SPARSE_NONE
+           && vfs_preallocate (dest_desc, file_size, appending ? dst_stat.st_size : 0) != 0)
     {
         if (ctx->skip_all)
         {
@@ -1792,19 +2930,149 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
         int secs, update_secs;
         const char *stalled_msg = "";
         gboolean is_first_time = TRUE;
+        off_t data_end = 0;     /* end of data of the source file, for SPARSE_SEEK */
+        gboolean dst_hole = FALSE;      /* the target file ends with a hole */
+        off_t journal_offset = ctx->do_reget;   /* the target is recorded up to here */
 
         tv_last_update = tv_transfer_start;
 
-        bufsize = io_blksize (dst_stat);
+        bufsize = io_tune_bufsize (src_vpath, &src_stat, dst_vpath, &dst_stat);
         buf = g_malloc (bufsize);
 
+        if (use_delta)
+            delta = copy_delta_new (vfs_local_fd (src_desc), vfs_local_fd (dest_desc), bufsize);
+
+        /* the source is hashed as it's copied; the part copied before is read again */
+        if (ctx->verify)
+        {
+            hash = copy_hash_new ();
+            while (ctx->do_reget > 0
+                   && !copy_verify_hash_file (src_vpath, ctx->do_reget, FALSE, hash))
+            {
+                if (ctx->skip_all)
+                    return_status = FILE_SKIPALL;
+                else
+                {
+                    return_status =
+                        file_error (_("Cannot read source file \"%s\"\n%s"), src_path);
+                    if (return_status == FILE_RETRY)
+                    {
+                        copy_hash_free (hash);
+                        hash = copy_hash_new ();
+                        continue;
+                    }
+                    if (return_status == FILE_SKIPALL)
+                        ctx->skip_all = TRUE;
+                }
+                goto ret;
+            }
+        }
+
+        /* overlap reading and writing of a big file if the target is on other device */
+        if (delta == NULL && hash == NULL && copy_queue_depth > 1 && sparse == SPARSE_NONE
+            && !appending && ctx->do_reget == 0
+            && file_size >= FILEOP_RING_MIN_SIZE && src_stat.st_dev != dst_stat.st_dev
+            && vfs_local_fd (src_desc) != -1 && vfs_local_fd (dest_desc) != -1)
+        {
+            ring = copy_ring_new (vfs_local_fd (src_desc), vfs_local_fd (dest_desc),
+                                  copy_queue_depth, (size_t) MAX (copy_buffer_size, 4) * 1024);
+            if (ring != NULL)
+                copy_with = VFS_COPY_READ_WRITE;
+        }
+
         while (TRUE)
         {
             ssize_t n_read = -1, n_written;
+            gboolean in_kernel = FALSE;
+            gboolean ring_busy = FALSE;
+            off_t pos = n_read_total + ctx->do_reget;
+            size_t count = FILEOP_KERNEL_COPY_SIZE;
+
+            /* skip holes of the source file */
+            if (sparse == SPARSE_SEEK && pos >= data_end)
+            {
+                off_t data;
+
+                data = copy_file_file_seek_data (src_desc, dest_desc, pos, file_size, &data_end);
+                if (data == -1)
+                {
+                    /* holes can't be found, look for zeroes */
+                    sparse = SPARSE_ZEROES;
+                    copy_with = VFS_COPY_READ_WRITE;
+                }
+                else if (data > pos)
+                {
+                    n_read_total += data - pos;
+                    pos = data;
+                    dst_hole = TRUE;
+                }
+            }
+
+            if (sparse == SPARSE_SEEK)
+                count = (size_t) MIN ((off_t) count, data_end - pos);
+
+            /* data is copied by the threads of the ring, just see how far they are */
+            if (ring != NULL)
+            {
+                gboolean done;
+                off_t written;
+
+                written = copy_ring_wait (ring, &done);
+                n_read = (ssize_t) (written - n_read_total);
+                in_kernel = TRUE;
+                ring_busy = !done;
+
+                if (done && copy_ring_error (ring) != 0)
+                {
+                    /* continue after the written data: the error is reported by the query */
+                    copy_ring_free (ring);
+                    ring = NULL;
+                    mc_lseek (src_desc, written, SEEK_SET);
+                    mc_lseek (dest_desc, written, SEEK_SET);
+
+                    if (n_read == 0)
+                    {
+                        in_kernel = FALSE;
+                        n_read = -1;
+                    }
+                }
+            }
+
+            /* compare data with the target and write changed blocks only */
+            if (delta != NULL)
+            {
+                n_read = copy_delta_step (delta, MIN (count, bufsize));
+                in_kernel = n_read >= 0;
+
+                if (n_read < 0)
+                {
+                    /* copy the rest as usual: the error is reported by the query */
+                    copy_delta_free (delta);
+                    delta = NULL;
+                    mc_lseek (src_desc, pos, SEEK_SET);
+                    mc_lseek (dest_desc, pos, SEEK_SET);
+                    (void) ftruncate (vfs_local_fd (dest_desc), pos);
+                }
+            }
+
+            /* copy data without passing it through the buffer, if both files are local */
+            if (copy_with != VFS_COPY_READ_WRITE)
+            {
+                n_read = vfs_copy_range (src_desc, dest_desc, count, &copy_with);
+
+                /* some filesystems (e.g. sysfs) copy nothing instead of reporting errors */
+                if (n_read == 0 && pos < file_size)
+                    copy_with = VFS_COPY_READ_WRITE;
+
+                in_kernel = copy_with != VFS_COPY_READ_WRITE;
+                if (!in_kernel)
+                    n_read = -1;
+            }
 
             /* src_read */
-            if (mc_ctl (src_desc, VFS_CTL_IS_NOTREADY, 0) == 0)
-                while ((n_read = mc_read (src_desc, buf, bufsize)) < 0 && !ctx->skip_all)
+            if (!in_kernel && mc_ctl (src_desc, VFS_CTL_IS_NOTREADY, 0) == 0)
+                while ((n_read = mc_read (src_desc, buf, MIN (count, bufsize))) < 0
+                       && !ctx->skip_all)
                 {
                     return_status = file_error (_("Cannot read source file \"%s\"\n%s"), src_path);
                     if (return_status == FILE_RETRY)
@@ -1814,7 +3082,7 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
                     goto ret;
                 }
 
-            if (n_read == 0)
+            if (n_read == 0 && !ring_busy)
                 break;
 
             gettimeofday (&tv_current, NULL);
@@ -1822,6 +3090,7 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
             if (n_read > 0)
             {
                 char *t = buf;
+                gboolean hole = FALSE;
 
                 n_read_total += n_read;
 
@@ -1833,8 +3102,16 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
                     src_mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
                 gettimeofday (&tv_last_input, NULL);
 
+                if (!in_kernel && hash != NULL)
+                    copy_hash_update (hash, buf, (size_t) n_read);
+
+                /* leave a hole instead of zeroes */
+                if (!in_kernel && sparse == SPARSE_ZEROES && is_zero_block (buf, (size_t) n_read))
+                    hole = mc_lseek (dest_desc, n_read, SEEK_CUR) != -1;
+
                 /* dst_write */
-                while ((n_written = mc_write (dest_desc, t, (size_t) n_read)) < n_read)
+                while (!in_kernel && !hole
+                       && (n_written = mc_write (dest_desc, t, (size_t) n_read)) < n_read)
                 {
                     gboolean write_errno_nospace;
 
@@ -1868,10 +3145,21 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
                     if (return_status != FILE_RETRY)
                         goto ret;
                 }
+
+                dst_hole = hole;
             }
 
             tctx->copied_bytes = tctx->progress_bytes + n_read_total + ctx->do_reget;
 
+            /* the journal records only data which is on the disk */
+            if (ctx->journal != NULL && !dst_hole
+                && n_read_total + ctx->do_reget - journal_offset >= FILEOP_JOURNAL_STEP
+                && vfs_local_fd (dest_desc) != -1 && fsync (vfs_local_fd (dest_desc)) == 0)
+            {
+                journal_offset = n_read_total + ctx->do_reget;
+                copy_journal_progress (ctx->journal, dst_path, &src_stat, journal_offset);
+            }
+
             secs = (tv_current.tv_sec - tv_last_update.tv_sec);
             update_secs = (tv_current.tv_sec - tv_last_input.tv_sec);
 
@@ -1915,10 +3203,46 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
             }
         }
 
+        /* the target updated in place may be longer than the source */
+        while (delta != NULL && !copy_delta_finish (delta))
+        {
+            if (ctx->skip_all)
+                return_status = FILE_SKIPALL;
+            else
+            {
+                return_status = file_error (_("Cannot write target file \"%s\"\n%s"), dst_path);
+                if (return_status == FILE_RETRY)
+                    continue;
+                if (return_status == FILE_SKIPALL)
+                    ctx->skip_all = TRUE;
+            }
+            goto ret;
+        }
+
+        /* a hole at the end of the target file is made by writing its last byte */
+        while (dst_hole
+               && (mc_lseek (dest_desc, n_read_total + ctx->do_reget - 1, SEEK_SET) == -1
+                   || mc_write (dest_desc, "", 1) != 1))
+        {
+            if (ctx->skip_all)
+                return_status = FILE_SKIPALL;
+            else
+            {
+                return_status = file_error (_("Cannot write target file \"%s\"\n%s"), dst_path);
+                if (return_status == FILE_RETRY)
+                    continue;
+                if (return_status == FILE_SKIPALL)
+                    ctx->skip_all = TRUE;
+            }
+            goto ret;
+        }
+
         dst_status = DEST_FULL; /* copy successful, don't remove target file */
     }
 
   ret:
+    copy_ring_free (ring);
+    copy_delta_free (delta);
     g_free (buf);
 
     rotate_dash (FALSE);
@@ -1955,7 +3279,54 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
     else if (dst_status == DEST_FULL)
     {
         /* Copy has succeeded */
-        if (!appending && ctx->preserve_uidgid)
+        gboolean verified = TRUE;
+
+        /* read the target back and compare it with the data which was written */
+        if (hash != NULL)
+        {
+            file_progress_show (ctx, file_size, file_size, _("(verifying)"), TRUE);
+            mc_refresh ();
+        }
+
+        while (hash != NULL)
+        {
+            copy_hash_t *dst_hash;
+            gboolean read_ok;
+
+            dst_hash = copy_hash_new ();
+            read_ok = copy_verify_hash_file (dst_vpath, -1, TRUE, dst_hash);
+            verified = read_ok && copy_hash_digest (dst_hash) == copy_hash_digest (hash);
+            copy_hash_free (dst_hash);
+
+            if (verified)
+            {
+                if (ctx->manifest != NULL)
+                    fprintf (ctx->manifest, "%016" G_GINT64_MODIFIER "x  %s\n",
+                             copy_hash_digest (hash), dst_path);
+                break;
+            }
+
+            if (ctx->skip_all)
+                temp_status = FILE_SKIPALL;
+            else if (read_ok)
+                temp_status =
+                    file_error (_("Target file \"%s\" differs from the source after copying"),
+                                dst_path);
+            else
+                temp_status = file_error (_("Cannot read target file \"%s\"\n%s"), dst_path);
+
+            if (temp_status == FILE_RETRY)
+                continue;
+            if (temp_status == FILE_SKIPALL)
+                ctx->skip_all = TRUE;
+            return_status = temp_status == FILE_ABORT ? FILE_ABORT : FILE_SKIP;
+            break;
+        }
+
+        /* A target which failed verification keeps the time of copying, so a later sync
+           doesn't take it for an up to date one. The resumed target was created by
+           the operation, its attributes are not set yet */
+        if (verified && (!appending || resumed) && ctx->preserve_uidgid)
         {
             while (mc_chown (dst_vpath, src_uid, src_gid) != 0 && !ctx->skip_all)
             {
@@ -1973,7 +3344,7 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
             }
         }
 
-        if (!appending)
+        if (verified && (!appending || resumed))
         {
             if (ctx->preserve)
             {
@@ -1992,7 +3363,7 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
                     break;
                 }
             }
-            else if (!dst_exists)
+            else if (!dst_exists || resumed)
             {
                 src_mode = umask (-1);
                 umask (src_mode);
@@ -2001,12 +3372,21 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
             }
             mc_utime (dst_vpath, &utb);
         }
+
+        /* a target recorded as done is not touched again, its attributes must be set */
+        if (verified)
+            copy_journal_done (ctx->journal, dst_path, &src_stat);
     }
 
     if (return_status == FILE_CONT)
         return_status = progress_update_one (tctx, ctx, file_size);
 
   ret_fast:
+    /* the file may be overwritten without changing mtime of its directory */
+    if (dst_touched)
+        dir_size_update_entry (dst_vpath, dst_old);
+
+    copy_hash_free (hash);
     vfs_path_free (src_vpath);
     vfs_path_free (dst_vpath);
     return return_status;
@@ -2031,6 +3411,8 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
     struct link *lp;
     vfs_path_t *src_vpath, *dst_vpath;
     gboolean do_mkdir = TRUE;
+    gboolean own_pool = FALSE;
+    copy_dir_attrs_t *attrs = NULL;
 
     src_vpath = vfs_path_from_str (s);
     dst_vpath = vfs_path_from_str (d);
@@ -2053,7 +3435,7 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
         goto ret_fast;
     }
 
-    if (is_in_linklist (dest_dirs, src_vpath, &cbuf))
+    if (link_cache_lookup (dest_dirs, vfs_path_get_last_path_vfs (src_vpath), &cbuf) != NULL)
     {
         /* Don't copy a directory we created before (we don't want to copy 
            infinitely if a directory is copied into itself) */
@@ -2168,12 +3550,14 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
                 goto ret;
         }
 
+        dir_size_update_entry (dst_vpath, NULL);
+
         lp = g_new0 (struct link, 1);
         mc_stat (dst_vpath, &buf);
         lp->vfs = vfs_path_get_by_index (dst_vpath, -1)->class;
         lp->ino = buf.st_ino;
         lp->dev = buf.st_dev;
-        dest_dirs = g_slist_prepend (dest_dirs, lp);
+        link_cache_add (&dest_dirs, lp);
     }
 
     if (ctx->preserve_uidgid)
@@ -2198,6 +3582,15 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
     if (reading == NULL)
         goto ret;
 
+    /* copy small files of the tree in parallel, if both trees are local */
+    if (copy_pool == NULL && copy_threads > 1 && !do_delete && ctx->operation == OP_COPY
+        && !ctx->verify && vfs_file_get_local_path (src_vpath) != NULL
+        && vfs_file_get_local_path (dst_vpath) != NULL)
+    {
+        copy_pool = copy_pool_new (copy_threads, ctx);
+        own_pool = copy_pool != NULL;
+    }
+
     while ((next = mc_readdir (reading)) && return_status != FILE_ABORT)
     {
         char *path;
@@ -2213,6 +3606,8 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
         path = mc_build_filename (s, next->d_name, (char *) NULL);
         tmp_vpath = vfs_path_from_str (path);
 
+        copy_prefetch_next (ctx->prefetch, path);
+
         (*ctx->stat_func) (tmp_vpath, &buf);
         if (S_ISDIR (buf.st_mode))
         {
@@ -2229,6 +3624,31 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
                 copy_dir_dir (tctx, ctx, path, mdpath, FALSE, FALSE, do_delete, parent_dirs);
             g_free (mdpath);
         }
+        else if (copy_dir_sync_skip (tctx, ctx, tmp_vpath, &buf, d, &return_status))
+        {
+            /* the target is up to date: the file is counted as copied */
+        }
+        else if (copy_pool != NULL && !do_delete && S_ISREG (buf.st_mode)
+                 && buf.st_size <= FILEOP_PARALLEL_MAX_SIZE
+                 && (ctx->follow_links || buf.st_nlink == 1))
+        {
+            char *dest_file;
+
+            if (attrs == NULL)
+            {
+                attrs = g_new0 (copy_dir_attrs_t, 1);
+                attrs->dst_vpath = vfs_path_clone (dst_vpath);
+                attrs->src_stat = cbuf;
+            }
+
+            attrs->pending++;
+            dest_file = mc_build_filename (d, x_basename (path), (char *) NULL);
+            copy_pool_push (copy_pool, path, dest_file, attrs);
+            g_free (dest_file);
+
+            return_status =
+                copy_pool_collect (tctx, ctx, copy_threads * FILEOP_PARALLEL_QUEUE);
+        }
         else
         {
             char *dest_file;
@@ -2259,21 +3679,28 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
     }
     mc_closedir (reading);
 
-    if (ctx->preserve)
+    if (own_pool)
     {
-        struct utimbuf utb;
+        /* wait for all files of the tree */
+        if (copy_pool_collect (tctx, ctx, 0) == FILE_ABORT)
+            return_status = FILE_ABORT;
+        copy_pool_free (copy_pool);
+        copy_pool = NULL;
+    }
 
-        mc_chmod (dst_vpath, cbuf.st_mode & ctx->umask_kill);
-        utb.actime = cbuf.st_atime;
-        utb.modtime = cbuf.st_mtime;
-        mc_utime (dst_vpath, &utb);
+    if (attrs != NULL && attrs->pending != 0)
+    {
+        /* attributes are set when the last file of the directory is copied */
+        attrs->complete = TRUE;
     }
     else
     {
-        cbuf.st_mode = umask (-1);
-        umask (cbuf.st_mode);
-        cbuf.st_mode = 0100777 & ~cbuf.st_mode;
-        mc_chmod (dst_vpath, cbuf.st_mode & ctx->umask_kill);
+        if (attrs != NULL)
+        {
+            vfs_path_free (attrs->dst_vpath);
+            g_free (attrs);
+        }
+        copy_dir_set_attrs (ctx, dst_vpath, &cbuf);
     }
 
   ret:
@@ -2293,10 +3720,10 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
 FileProgressStatus
 move_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const char *s, const char *d)
 {
-    struct stat sbuf, dbuf;
+    struct stat sbuf, dbuf, lbuf;
     FileProgressStatus return_status = FILE_CONT;
     gboolean move_over = FALSE;
-    gboolean dstat_ok;
+    gboolean dstat_ok, lstat_ok;
     vfs_path_t *src_vpath, *dst_vpath;
 
     src_vpath = vfs_path_from_str (s);
@@ -2366,9 +3793,14 @@ move_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
         goto ret_fast;
     }
 
+    /* the symlink is renamed rather than its target */
+    lstat_ok = mc_lstat (src_vpath, &lbuf) == 0;
+
   retry_rename:
     if (mc_rename (src_vpath, dst_vpath) == 0)
     {
+        if (lstat_ok)
+            dir_size_update_tree (src_vpath, &lbuf, dst_vpath);
         return_status = FILE_CONT;
         goto ret;
     }
@@ -2440,6 +3872,8 @@ FileProgressStatus
 erase_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const vfs_path_t * s_vpath)
 {
     FileProgressStatus error;
+    struct stat st;
+    gboolean sized;
 
     file_progress_show_deleting (ctx, vfs_path_as_str (s_vpath), NULL);
     file_progress_show_count (ctx, tctx->progress_count, ctx->progress_count);
@@ -2460,10 +3894,35 @@ erase_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const vfs_pa
     {                           /* not empty */
         error = query_recursive (ctx, vfs_path_as_str (s_vpath));
         if (error == FILE_CONT)
-            error = recursive_erase (tctx, ctx, s_vpath);
+        {
+#ifdef FILEOP_ERASE_AT
+            const char *path;
+
+            path = vfs_file_get_local_path (s_vpath);
+            if (path != NULL && mc_lstat (s_vpath, &st) == 0)
+            {
+                GString *tree_path;
+                char *name;
+
+                /* the name must stay the same while names of entries are appended */
+                name = g_strdup (path);
+                tree_path = g_string_new (path);
+                error = recursive_erase_at (tctx, ctx, AT_FDCWD, name, tree_path);
+                g_string_free (tree_path, TRUE);
+                g_free (name);
+
+                /* entries are removed without their paths: the tree is taken off at once */
+                dir_size_update_tree (s_vpath, &st, NULL);
+            }
+            else
+#endif
+                error = recursive_erase (tctx, ctx, s_vpath);
+        }
         return error;
     }
 
+    sized = dir_size_can_scan (s_vpath) && mc_lstat (s_vpath, &st) == 0;
+
     while (my_rmdir (vfs_path_as_str (s_vpath)) == -1 && !ctx->skip_all)
     {
         error = file_error (_("Cannot remove directory \"%s\"\n%s"), vfs_path_as_str (s_vpath));
@@ -2471,6 +3930,9 @@ erase_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const vfs_pa
             return error;
     }
 
+    if (sized)
+        dir_size_update_entry (s_vpath, &st);
+
     return FILE_CONT;
 }
 
@@ -2613,7 +4075,7 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
     struct stat src_stat;
     gboolean ret_val = TRUE;
     int i;
-    FileProgressStatus value;
+    FileProgressStatus value = FILE_CONT;
     file_op_context_t *ctx;
     file_op_total_context_t *tctx;
     vfs_path_t *tmp_vpath;
@@ -2629,8 +4091,8 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
         i18n_flag = TRUE;
     }
 
-    linklist = free_linklist (linklist);
-    dest_dirs = free_linklist (dest_dirs);
+    linklist = free_link_cache (linklist);
+    dest_dirs = free_link_cache (dest_dirs);
 
     if (single_entry)
     {
@@ -2786,6 +4248,11 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
         /* If we are the parent */
         if (v == 1)
         {
+            /* sizes are updated by the child in its own copy of the database */
+            dir_size_cache_forget (panel->cwd_vpath);
+            if (dest_vpath != NULL)
+                dir_size_cache_forget (dest_vpath);
+
             mc_setctl (panel->cwd_vpath, VFS_SETCTL_FORGET, NULL);
 
             mc_setctl (dest_vpath, VFS_SETCTL_FORGET, NULL);
@@ -2820,6 +4287,24 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
         && (mc_setctl (panel->cwd_vpath, VFS_SETCTL_STALE_DATA, GUINT_TO_POINTER (1)) != 0))
         save_cwd = g_strdup (vfs_path_as_str (panel->cwd_vpath));
 
+    /* record copied files to resume the operation if it's interrupted */
+    if (operation != OP_DELETE && copy_journal != 0 && vfs_file_is_local (dest_vpath))
+    {
+        char *key;
+
+        key = panel_operate_journal_key (panel, operation, source, dest);
+        ctx->journal = copy_journal_open (key);
+        g_free (key);
+    }
+
+    if (operation != OP_DELETE && ctx->verify && verify_manifest != 0)
+        ctx->manifest = panel_operate_open_manifest ();
+
+    /* read files ahead while the previous ones are written */
+    if (operation != OP_DELETE && (!single_entry || S_ISDIR (src_stat.st_mode)))
+        ctx->prefetch = panel_operate_prefetch_new (panel, single_entry ? source : NULL, &src_stat,
+                                                    dest_vpath);
+
     /* Now, let's do the job */
 
     /* This code is only called by the tree and panel code */
@@ -2850,8 +4335,10 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
         else
             source_with_vpath = vfs_path_append_new (panel->cwd_vpath, source, (char *) NULL);
 #endif /* WITH_FULL_PATHS */
-        if (panel_operate_init_totals (panel, vfs_path_as_str (source_with_vpath), ctx, dialog_type)
-            == FILE_CONT)
+        value =
+            panel_operate_init_totals (panel, vfs_path_as_str (source_with_vpath), ctx,
+                                       dialog_type);
+        if (value == FILE_CONT)
         {
             if (operation == OP_DELETE)
             {
@@ -2942,7 +4429,8 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
                 goto clean_up;
         }
 
-        if (panel_operate_init_totals (panel, NULL, ctx, dialog_type) == FILE_CONT)
+        value = panel_operate_init_totals (panel, NULL, ctx, dialog_type);
+        if (value == FILE_CONT)
         {
             /* Loop for every file, perform the actual copy operation */
             for (i = 0; i < panel->dir.len; i++)
@@ -2996,6 +4484,8 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
                         temp = strutils_shell_unescape (temp2);
                         g_free (temp2);
 
+                        copy_prefetch_next (ctx->prefetch, source_with_path_str);
+
                         switch (operation)
                         {
                         case OP_COPY:
@@ -3012,7 +4502,7 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
                                                       TRUE, FALSE, FALSE, NULL);
                             else
                                 value = copy_file_file (tctx, ctx, source_with_path_str, temp);
-                            dest_dirs = free_linklist (dest_dirs);
+                            dest_dirs = free_link_cache (dest_dirs);
                             break;
 
                         case OP_MOVE:
@@ -3048,7 +4538,10 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
                     file_progress_show (ctx, 0, 0, "", FALSE);
 
                 if (check_progress_buttons (ctx) == FILE_ABORT)
+                {
+                    value = FILE_ABORT;
                     break;
+                }
 
                 mc_refresh ();
             }                   /* Loop for every file */
@@ -3056,6 +4549,26 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
     }                           /* Many entries */
 
   clean_up:
+    /* the journal of the aborted operation is kept to resume it */
+    copy_journal_close (ctx->journal, ret_val && value != FILE_ABORT);
+    ctx->journal = NULL;
+
+    copy_prefetch_free (ctx->prefetch);
+    ctx->prefetch = NULL;
+
+    if (ctx->manifest != NULL)
+    {
+        fclose (ctx->manifest);
+        ctx->manifest = NULL;
+    }
+
+    if (tctx->skipped_count != 0 && !mc_global.we_are_background)
+        message (D_NORMAL, op_names[operation],
+                 ngettext ("%zu unchanged file (%s) was not copied",
+                           "%zu unchanged files (%s) were not copied", tctx->skipped_count),
+                 tctx->skipped_count,
+                 size_trunc_sep (tctx->skipped_bytes, panels_options.kilobyte_si));
+
     /* Clean up */
     if (save_cwd != NULL)
     {
@@ -3073,8 +4586,8 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
         g_free (save_dest);
     }
 
-    linklist = free_linklist (linklist);
-    dest_dirs = free_linklist (dest_dirs);
+    linklist = free_link_cache (linklist);
+    dest_dirs = free_link_cache (dest_dirs);
 #ifdef WITH_FULL_PATHS
     vfs_path_free (source_with_vpath);
 #endif /* WITH_FULL_PATHS */
@@ -63,6 +63,7 @@
 #include <errno.h>
 #include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>             /* atoi() */
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -157,7 +158,8 @@ statfs (char const *filename, struct fs_info *buf)
 #include "lib/util.h"
 #include "lib/widget.h"
 
-#include "src/setup.h"          /* verbose */
+#include "src/setup.h"          /* verbose, copy_threads */
+#include "src/history.h"        /* MC_HISTORY_FM_COPY_THREADS */
 
 #include "midnight.h"
 #include "fileopctx.h"          /* FILE_CONT */
@@ -941,6 +943,10 @@ file_progress_show_count (file_op_context_t * ctx, size_t done, size_t total)
     if (ui->total_files_processed_label == NULL)
         return;
 
+    /* totals grow while they are scanned in background */
+    if (file_op_context_update_totals (ctx))
+        total = ctx->progress_count;
+
     if (ctx->progress_totals_computed)
         g_snprintf (buffer, sizeof (buffer), _("Files processed: %zu/%zu"), done, total);
     else
@@ -964,14 +970,18 @@ file_progress_show_total (file_op_total_context_t * tctx, file_op_context_t * ct
 
     ui = ctx->ui;
 
+    file_op_context_update_totals (ctx);
+
     if (ui->progress_total_gauge != NULL)
     {
         if (ctx->progress_bytes == 0)
             gauge_show (ui->progress_total_gauge, 0);
         else
         {
+            /* the scan in background may be behind the operation */
             gauge_set_value (ui->progress_total_gauge, 1024,
-                             (int) (1024 * copied_bytes / ctx->progress_bytes));
+                             (int) (1024 * MIN (copied_bytes, ctx->progress_bytes) /
+                                    ctx->progress_bytes));
             gauge_show (ui->progress_total_gauge, 1);
         }
     }
@@ -987,7 +997,8 @@ file_progress_show_total (file_op_total_context_t * tctx, file_op_context_t * ct
         gettimeofday (&tv_current, NULL);
         file_frmt_time (buffer2, tv_current.tv_sec - tctx->transfer_start.tv_sec);
 
-        if (ctx->progress_totals_computed)
+        /* ETA makes no sense until all files are counted */
+        if (ctx->progress_totals_computed && ctx->totals_scan == NULL)
         {
             file_eta_prepare_for_show (buffer3, tctx->eta_secs, TRUE);
             if (tctx->bps == 0)
@@ -1230,6 +1241,8 @@ file_mask_dialog (file_op_context_t * ctx, FileOperation operation,
         char *source_mask, *orig_mask;
         int val;
         struct stat buf;
+        char threads[BUF_TINY];
+        char *threads_new;
 
         quick_widget_t quick_widgets[] = {
             /* *INDENT-OFF* */
@@ -1247,10 +1260,15 @@ file_mask_dialog (file_op_context_t * ctx, FileOperation operation,
             QUICK_START_COLUMNS,
                 QUICK_CHECKBOX (N_("Follow &links"), &ctx->follow_links, NULL),
                 QUICK_CHECKBOX (N_("Preserve &attributes"), &ctx->op_preserve, NULL),
+                QUICK_CHECKBOX (N_("Skip u&nchanged files"), &ctx->sync, NULL),
             QUICK_NEXT_COLUMN,
                 QUICK_CHECKBOX (N_("Di&ve into subdir if exists"), &ctx->dive_into_subdirs, NULL),
                 QUICK_CHECKBOX (N_("&Stable symlinks"), &ctx->stable_symlinks, NULL),
+                QUICK_CHECKBOX (N_("Ve&rify copied data"), &ctx->verify, NULL),
             QUICK_STOP_COLUMNS,
+            QUICK_LABELED_INPUT (N_("&Parallel copies of small files:"), input_label_left,
+                                 threads, MC_HISTORY_FM_COPY_THREADS, &threads_new, NULL,
+                                 FALSE, FALSE, INPUT_COMPLETE_NONE),
             QUICK_START_BUTTONS (TRUE, TRUE),
                 QUICK_BUTTON (N_("&OK"), B_ENTER, NULL, NULL),
 #ifdef ENABLE_BACKGROUND
@@ -1267,6 +1285,18 @@ file_mask_dialog (file_op_context_t * ctx, FileOperation operation,
             quick_widgets, NULL, NULL
         };
 
+        g_snprintf (threads, sizeof (threads), "%d", copy_threads);
+
+        /* only copied trees are copied in parallel */
+        if (operation != OP_COPY)
+        {
+            quick_widget_t *qw;
+
+            for (qw = quick_widgets; qw->widget_type != quick_end; qw++)
+                if (qw->widget_type == quick_input && qw->u.input.result == &threads_new)
+                    qw->options = W_DISABLED;
+        }
+
       ask_file_mask:
         val = quick_dialog_skip (&qdlg, 4);
 
@@ -1276,6 +1306,9 @@ file_mask_dialog (file_op_context_t * ctx, FileOperation operation,
             return NULL;
         }
 
+        copy_threads = MAX (atoi (threads_new), 1);
+        g_free (threads_new);
+
         if (ctx->follow_links)
             ctx->stat_func = mc_stat;
         else
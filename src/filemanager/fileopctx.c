@@ -41,6 +41,8 @@
 #include "lib/search.h"
 #include "lib/vfs/vfs.h"
 
+#include "totalscan.h"
+
 /*** global variables ****************************************************************************/
 
 /*** file scope macro definitions ****************************************************************/
@@ -101,11 +103,35 @@ file_op_context_destroy (file_op_context_t * ctx)
     if (ctx != NULL)
     {
         file_op_context_destroy_ui (ctx);
+        total_scan_free (ctx->totals_scan);
         mc_search_free (ctx->search_handle);
         g_free (ctx);
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Take totals found by the scan running in background.
+ *
+ * @param ctx The file operation context.
+ * @return TRUE if totals were scanned in background, i.e. they may have been changed
+ */
+
+gboolean
+file_op_context_update_totals (file_op_context_t * ctx)
+{
+    if (ctx->totals_scan == NULL)
+        return FALSE;
+
+    if (total_scan_get (ctx->totals_scan, &ctx->progress_count, &ctx->progress_bytes))
+    {
+        total_scan_free (ctx->totals_scan);
+        ctx->totals_scan = NULL;
+    }
+
+    return TRUE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 file_op_total_context_t *
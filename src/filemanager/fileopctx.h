@@ -8,6 +8,7 @@
 #ifndef MC__FILEOPCTX_H
 #define MC__FILEOPCTX_H
 
+#include <stdio.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/time.h>
@@ -67,6 +68,9 @@ enum OperationMode
 /*** structures declarations (and typedefs of structures)*****************************************/
 
 struct mc_search_struct;
+struct total_scan_struct;
+struct copy_journal_struct;
+struct copy_prefetch_struct;
 
 /* This structure describes a context for file operations.  It is used to update
  * the progress windows and pass around options.
@@ -87,6 +91,9 @@ typedef struct
 
     /* Whether the panel total has been computed */
     gboolean progress_totals_computed;
+
+    /* Scan of trees which computes totals while the operation goes on, NULL if it's finished */
+    struct total_scan_struct *totals_scan;
     filegui_dialog_type_t dialog_type;
 
     /* Counters for progress indicators */
@@ -140,6 +147,23 @@ typedef struct
     /* Whether to dive into subdirectories for recursive operations */
     gboolean dive_into_subdirs;
 
+    /* Sync mode: targets of the same size and modification time as their sources
+     * are left alone, other targets are overwritten without asking
+     */
+    gboolean sync;
+
+    /* Journal of copied files, if the operation may be resumed after it's interrupted */
+    struct copy_journal_struct *journal;
+
+    /* Read-ahead of files to be copied next, if many local files are copied to other device */
+    struct copy_prefetch_struct *prefetch;
+
+    /* Verify mode: copied data is hashed and compared with the target read back */
+    gboolean verify;
+
+    /* Digests of verified targets are written here, if it's not NULL */
+    FILE *manifest;
+
     /* When moving directories cross filesystem boundaries delete the
      * successfully copied files when all files below the directory and its
      * subdirectories were processed.
@@ -169,6 +193,8 @@ typedef struct
     size_t prev_progress_count; /* Used in OP_MOVE between copy and remove directories */
     uintmax_t progress_bytes;
     uintmax_t copied_bytes;
+    size_t skipped_count;       /* files found unchanged in sync mode */
+    uintmax_t skipped_bytes;
     size_t bps;
     size_t bps_count;
     struct timeval transfer_start;
@@ -185,6 +211,7 @@ extern const char *op_names[3];
 
 file_op_context_t *file_op_context_new (FileOperation op);
 void file_op_context_destroy (file_op_context_t * ctx);
+gboolean file_op_context_update_totals (file_op_context_t * ctx);
 
 file_op_total_context_t *file_op_total_context_new (void);
 void file_op_total_context_destroy (file_op_total_context_t * tctx);
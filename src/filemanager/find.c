@@ -1248,13 +1248,40 @@ find_rotate_dash (const WDialog * h, gboolean show)
     mc_refresh ();
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the next entry of the directory being searched, skipping invalid filenames.
+ */
+
+static const vfs_dirent_t *
+find_next_dirent (DIR * dirp, vfs_dirent_batch_t * dirents, guint * pos)
+{
+    while (TRUE)
+    {
+        while (*pos < vfs_dirent_batch_len (dirents))
+        {
+            const vfs_dirent_t *d;
+
+            d = vfs_dirent_batch_get (dirents, (*pos)++);
+            if (str_is_valid_string (d->d_name))
+                return d;
+        }
+
+        *pos = 0;
+        if (mc_readdir_batch (dirp, dirents) <= 0)
+            return NULL;
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static int
 do_search (WDialog * h)
 {
-    static struct dirent *dp = NULL;
+    static const vfs_dirent_t *dp = NULL;
     static DIR *dirp = NULL;
+    static vfs_dirent_batch_t *dirents = NULL;
+    static guint dirents_pos = 0;
     static char *directory = NULL;
     struct stat tmp_stat;
     gsize bytes_found;
@@ -1268,10 +1295,15 @@ do_search (WDialog * h)
             dirp = NULL;
         }
         MC_PTR_FREE (directory);
+        vfs_dirent_batch_free (dirents);
+        dirents = NULL;
         dp = NULL;
         return 1;
     }
 
+    if (dirents == NULL)
+        dirents = vfs_dirent_batch_new ();
+
     for (count = 0; count < 32; count++)
     {
         while (dp == NULL)
@@ -1338,17 +1370,14 @@ do_search (WDialog * h)
                 vfs_path_free (tmp_vpath);
             }                   /* while (!dirp) */
 
-            /* skip invalid filenames */
-            while ((dp = mc_readdir (dirp)) != NULL && !str_is_valid_string (dp->d_name))
-                ;
+            vfs_dirent_batch_clear (dirents);
+            dirents_pos = 0;
+            dp = find_next_dirent (dirp, dirents, &dirents_pos);
         }                       /* while (!dp) */
 
         if (DIR_IS_DOT (dp->d_name) || DIR_IS_DOTDOT (dp->d_name))
         {
-            /* skip invalid filenames */
-            while ((dp = mc_readdir (dirp)) != NULL && !str_is_valid_string (dp->d_name))
-                ;
-
+            dp = find_next_dirent (dirp, dirents, &dirents_pos);
             return 1;
         }
 
@@ -1367,7 +1396,10 @@ do_search (WDialog * h)
 
                     tmp_vpath = vfs_path_build_filename (directory, dp->d_name, (char *) NULL);
 
-                    if (mc_lstat (tmp_vpath, &tmp_stat) == 0 && S_ISDIR (tmp_stat.st_mode))
+                    /* don't stat entries which type is known already */
+                    if (dp->d_type == DT_DIR
+                        || (dp->d_type == DT_UNKNOWN && mc_lstat (tmp_vpath, &tmp_stat) == 0
+                            && S_ISDIR (tmp_stat.st_mode)))
                         push_directory (tmp_vpath);
                     else
                         vfs_path_free (tmp_vpath);
@@ -1375,7 +1407,7 @@ do_search (WDialog * h)
             }
 
             search_ok = mc_search_run (search_file_handle, dp->d_name,
-                                       0, strlen (dp->d_name), &bytes_found);
+                                       0, dp->d_namlen, &bytes_found);
 
             if (search_ok)
             {
@@ -1386,9 +1418,7 @@ do_search (WDialog * h)
             }
         }
 
-        /* skip invalid filenames */
-        while ((dp = mc_readdir (dirp)) != NULL && !str_is_valid_string (dp->d_name))
-            ;
+        dp = find_next_dirent (dirp, dirents, &dirents_pos);
     }                           /* for */
 
     find_rotate_dash (h, TRUE);
@@ -1800,6 +1830,7 @@ do_find (const char *start_dir, ssize_t start_dir_len, const char *ignore_dirs,
             list->list[list->len].f.marked = 0;
             list->list[list->len].f.link_to_dir = link_to_dir;
             list->list[list->len].f.stale_link = stale_link;
+            list->list[list->len].f.link_unresolved = 0;
             list->list[list->len].f.dir_size_computed = 0;
             list->list[list->len].st = st;
             list->list[list->len].sort_key = NULL;
@@ -0,0 +1,403 @@
+/*
+   Choosing of the block size for copying
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file src/filemanager/iotune.c
+ *  \brief Source: choosing of the block size for copying
+ *
+ *  IO_BUFSIZE minimizes the overhead of syscalls, but disks are read faster with blocks
+ *  as big as the readahead of the device, and written faster with blocks of the optimal
+ *  I/O size of the device (e.g. the stripe of a RAID). Both are taken from sysfs
+ *  (or with the BLKRAGET ioctl) for local files and kept per device.
+ *
+ *  If io_block_size is set, it's used instead. io_tune_bench() measures block sizes
+ *  on the disk of the given directory and saves the fastest one there
+ *  (mc --bench-io).
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_IOCTL_H
+#include <sys/ioctl.h>
+#endif
+#ifdef HAVE_LINUX_FS_H
+#include <linux/fs.h>           /* BLKRAGET */
+#endif
+
+#include "lib/global.h"
+#include "lib/mcconfig.h"
+#include "lib/unixcompat.h"     /* major(), minor() */
+#include "lib/util.h"           /* unix_error_string() */
+#include "lib/vfs/vfs.h"
+
+#include "src/setup.h"          /* io_block_size */
+
+#include "ioblksize.h"          /* io_blksize() */
+#include "iotune.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* Readahead of some RAIDs is huge, don't allocate that much */
+#define IO_TUNE_MAX_BUFSIZE (8 * 1024 * 1024)
+
+/* Size of the file copied by the benchmark */
+#define IO_TUNE_BENCH_SIZE (256 * 1024 * 1024)
+
+/*** file scope type declarations ****************************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* dev_t -> preferred block size of the device */
+static GHashTable *devices = NULL;
+
+/* block sizes measured by the benchmark */
+static const size_t bench_sizes[] = {
+    64 * 1024, 128 * 1024, 256 * 1024, 512 * 1024,
+    1024 * 1024, 2 * 1024 * 1024, 4 * 1024 * 1024, 8 * 1024 * 1024
+};
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/** Read the number from the queue attributes of the block device */
+
+static size_t
+io_tune_read_queue_attr (dev_t dev, const char *attr)
+{
+    char *path;
+    char *contents = NULL;
+    size_t value = 0;
+
+    path = g_strdup_printf ("/sys/dev/block/%u:%u/queue/%s", (unsigned int) major (dev),
+                            (unsigned int) minor (dev), attr);
+    if (!g_file_get_contents (path, &contents, NULL, NULL))
+    {
+        /* partitions share the queue of their disk */
+        g_free (path);
+        path = g_strdup_printf ("/sys/dev/block/%u:%u/../queue/%s", (unsigned int) major (dev),
+                                (unsigned int) minor (dev), attr);
+        (void) g_file_get_contents (path, &contents, NULL, NULL);
+    }
+
+    if (contents != NULL)
+        value = (size_t) g_ascii_strtoull (contents, NULL, 10);
+
+    g_free (contents);
+    g_free (path);
+
+    return value;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Get the readahead of the block device, in bytes */
+
+static size_t
+io_tune_readahead (dev_t dev)
+{
+    size_t readahead;
+
+    readahead = io_tune_read_queue_attr (dev, "read_ahead_kb") * 1024;
+
+#ifdef BLKRAGET
+    if (readahead == 0)
+    {
+        char *path;
+        int fd;
+
+        /* sysfs is not mounted: ask the device, if it can be opened */
+        path = g_strdup_printf ("/dev/block/%u:%u", (unsigned int) major (dev),
+                                (unsigned int) minor (dev));
+        fd = open (path, O_RDONLY | O_NONBLOCK);
+        if (fd != -1)
+        {
+            long sectors = 0;
+
+            if (ioctl (fd, BLKRAGET, &sectors) == 0 && sectors > 0)
+                readahead = (size_t) sectors * 512;
+            close (fd);
+        }
+        g_free (path);
+    }
+#endif
+
+    return readahead;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Get the preferred block size of the device, or 0 if it's unknown */
+
+static size_t
+io_tune_device_bufsize (dev_t dev)
+{
+    gint64 key = (gint64) dev;
+    gpointer value;
+    size_t bufsize;
+
+    if (devices == NULL)
+        devices = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
+    else if (g_hash_table_lookup_extended (devices, &key, NULL, &value))
+        return GPOINTER_TO_SIZE (value);
+
+    bufsize = MAX (io_tune_readahead (dev), io_tune_read_queue_attr (dev, "optimal_io_size"));
+    bufsize = MIN (bufsize, IO_TUNE_MAX_BUFSIZE);
+
+    g_hash_table_insert (devices, g_memdup (&key, sizeof (key)), GSIZE_TO_POINTER (bufsize));
+
+    return bufsize;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+io_tune_write_all (int fd, const char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n;
+
+        n = write (fd, buf, len);
+        if (n < 0 && errno != EINTR)
+            return FALSE;
+        if (n > 0)
+        {
+            buf += n;
+            len -= (size_t) n;
+        }
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Drop the file from the page cache, so it's read from the disk */
+
+static void
+io_tune_drop_cache (int fd)
+{
+#ifdef HAVE_POSIX_FADVISE
+    (void) fdatasync (fd);
+    (void) posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+#else
+    (void) fd;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Copy the file with blocks of given size, like copy_file_file() does.
+ *
+ * @return transfer rate in bytes per second, or -1 on error
+ */
+
+static double
+io_tune_bench_copy (const char *src_path, const char *dst_path, char *buf, size_t bufsize)
+{
+    int src_fd, dst_fd;
+    int saved_errno;
+    gint64 start, elapsed;
+    gboolean ok = TRUE;
+
+    src_fd = open (src_path, O_RDONLY);
+    if (src_fd == -1)
+        return -1;
+
+    dst_fd = open (dst_path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (dst_fd == -1)
+    {
+        saved_errno = errno;
+        close (src_fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    io_tune_drop_cache (src_fd);
+
+    start = g_get_monotonic_time ();
+
+    while (ok)
+    {
+        ssize_t n;
+
+        n = read (src_fd, buf, bufsize);
+        if (n == 0)
+            break;
+        if (n < 0)
+            ok = errno == EINTR;
+        else
+            ok = io_tune_write_all (dst_fd, buf, (size_t) n);
+    }
+
+    /* the data must reach the disk */
+    ok = ok && fsync (dst_fd) == 0;
+    /* the caller reports the reason of the failure */
+    saved_errno = errno;
+
+    elapsed = g_get_monotonic_time () - start;
+
+    close (src_fd);
+    close (dst_fd);
+    unlink (dst_path);
+
+    if (!ok)
+    {
+        errno = saved_errno;
+        return -1;
+    }
+
+    return (double) IO_TUNE_BENCH_SIZE * G_USEC_PER_SEC / MAX (elapsed, 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Choose the size of the buffer for copying of the file.
+ *
+ * @param src_vpath source file
+ * @param src_stat stat of the source file
+ * @param dst_vpath target file
+ * @param dst_stat stat of the target file
+ *
+ * @return size of the buffer
+ */
+
+size_t
+io_tune_bufsize (const vfs_path_t * src_vpath, const struct stat *src_stat,
+                 const vfs_path_t * dst_vpath, const struct stat *dst_stat)
+{
+    size_t bufsize;
+
+    if (io_block_size > 0)
+        return (size_t) io_block_size * 1024;
+
+    bufsize = io_blksize (*dst_stat);
+
+    /* st_dev of files on other VFSes is made up */
+    if (vfs_file_is_local (src_vpath))
+        bufsize = MAX (bufsize, io_tune_device_bufsize (src_stat->st_dev));
+    if (vfs_file_is_local (dst_vpath))
+        bufsize = MAX (bufsize, io_tune_device_bufsize (dst_stat->st_dev));
+
+    return bufsize;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Measure the speed of copying a file within the directory with various block sizes,
+ * print results and save the fastest block size as io_block_size.
+ *
+ * @param dir directory on the disk to be measured
+ *
+ * @return TRUE on success
+ */
+
+gboolean
+io_tune_bench (const char *dir)
+{
+    char *src_path, *dst_path;
+    char *buf;
+    int fd;
+    off_t size;
+    size_t i, best = 0;
+    double best_rate = 0;
+    gboolean ok;
+    GError *error = NULL;
+
+    src_path = g_build_filename (dir, ".mc-bench-io-XXXXXX", (char *) NULL);
+    fd = g_mkstemp (src_path);
+    if (fd == -1)
+    {
+        fprintf (stderr, _("Cannot create temporary file \"%s\"\n%s\n"), src_path,
+                 unix_error_string (errno));
+        g_free (src_path);
+        return FALSE;
+    }
+
+    dst_path = g_strconcat (src_path, ".copy", (char *) NULL);
+    buf = g_malloc (bench_sizes[G_N_ELEMENTS (bench_sizes) - 1]);
+
+    /* random data: compressing filesystems shouldn't get it for free */
+    for (i = 0; i < bench_sizes[G_N_ELEMENTS (bench_sizes) - 1] / sizeof (guint32); i++)
+        ((guint32 *) buf)[i] = g_random_int ();
+
+    printf (_("Writing %d MiB to %s...\n"), IO_TUNE_BENCH_SIZE / (1024 * 1024), src_path);
+
+    for (ok = TRUE, size = 0; ok && size < IO_TUNE_BENCH_SIZE; size += 1024 * 1024)
+        ok = io_tune_write_all (fd, buf, 1024 * 1024);
+    ok = ok && fsync (fd) == 0;
+
+    if (!ok)
+        fprintf (stderr, _("Cannot write file \"%s\"\n%s\n"), src_path, unix_error_string (errno));
+    close (fd);
+
+    for (i = 0; ok && i < G_N_ELEMENTS (bench_sizes); i++)
+    {
+        double rate;
+
+        rate = io_tune_bench_copy (src_path, dst_path, buf, bench_sizes[i]);
+        if (rate < 0)
+        {
+            fprintf (stderr, _("Cannot copy file \"%s\"\n%s\n"), src_path,
+                     unix_error_string (errno));
+            ok = FALSE;
+            break;
+        }
+
+        printf ("%6zu KiB  %8.1f MiB/s\n", bench_sizes[i] / 1024, rate / (1024 * 1024));
+        fflush (stdout);
+
+        if (rate > best_rate)
+        {
+            best_rate = rate;
+            best = bench_sizes[i];
+        }
+    }
+
+    unlink (src_path);
+    g_free (buf);
+    g_free (dst_path);
+    g_free (src_path);
+
+    if (!ok)
+        return FALSE;
+
+    io_block_size = (int) (best / 1024);
+    mc_config_set_int (mc_global.main_config, CONFIG_APP_SECTION, "io_block_size", io_block_size);
+    if (!mc_config_save_file (mc_global.main_config, &error))
+    {
+        fprintf (stderr, _("Cannot save setup\n%s\n"), error->message);
+        g_error_free (error);
+        return FALSE;
+    }
+
+    printf (_("io_block_size=%d is saved to %s\n"), io_block_size, mc_global.main_config->ini_path);
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
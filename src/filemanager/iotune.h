@@ -0,0 +1,30 @@
+/** \file iotune.h
+ *  \brief Header: choosing of the block size for copying
+ */
+
+#ifndef MC__IOTUNE_H
+#define MC__IOTUNE_H
+
+#include <sys/stat.h>
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+size_t io_tune_bufsize (const vfs_path_t * src_vpath, const struct stat *src_stat,
+                        const vfs_path_t * dst_vpath, const struct stat *dst_stat);
+
+gboolean io_tune_bench (const char *dir);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__IOTUNE_H */
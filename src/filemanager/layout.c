@@ -1102,6 +1102,10 @@ swap_panels (void)
                         strcpy (panel2->e, panel.e);
         /* Change content and related stuff */
         panelswap (dir);
+        panelswap (watch);
+        panelswap (links);
+        panelswap (unfiltered);
+        panelswap (unfiltered_stat);
         panelswap (active);
         panelswap (cwd_vpath);
         panelswap (lwd_vpath);
@@ -1112,6 +1116,8 @@ swap_panels (void)
         panelswap (selected);
         panelswap (is_panelized);
         panelswap (dir_stat);
+        panelswap (load_stat);
+        panelswap (load_complete);
 #undef panelswapstr
 #undef panelswap
 
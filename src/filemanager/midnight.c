@@ -74,7 +74,8 @@
 #include "hotlist.h"
 #include "panelize.h"
 #include "command.h"            /* cmdline */
-#include "dir.h"                /* dir_list_clean() */
+#include "dircompact.h"         /* dir_compact_free() */
+#include "dircache.h"           /* dir_cache_clear() */
 
 #include "chmod.h"
 #include "chown.h"
@@ -1793,7 +1794,9 @@ do_nc (void)
         /* don't handle VFS timestamps for dirs opened in panels */
         mc_event_destroy (MCEVENT_GROUP_CORE, "vfs_timestamp");
 
-        dir_list_clean (&panelized_panel.list);
+        dir_compact_free (panelized_panel.list);
+        panelized_panel.list = NULL;
+        dir_cache_clear ();
     }
 
     /* Program end */
@@ -36,6 +36,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "lib/global.h"
 
@@ -48,6 +49,7 @@
 #include "lib/unixcompat.h"
 #include "lib/search.h"
 #include "lib/timefmt.h"        /* file_date() */
+#include "lib/timer.h"
 #include "lib/util.h"
 #include "lib/widget.h"
 #ifdef HAVE_CHARSET
@@ -67,6 +69,9 @@
 #endif
 
 #include "dir.h"
+#include "dircache.h"
+#include "dircompact.h"
+#include "dirsize.h"            /* dir_size_lookup() */
 #include "boxes.h"
 #include "tree.h"
 #include "ext.h"                /* regexp_command */
@@ -89,7 +94,7 @@
 hook_t *select_file_hook = NULL;
 
 /* *INDENT-OFF* */
-panelized_panel_t panelized_panel = { {NULL, 0, -1}, NULL };
+panelized_panel_t panelized_panel = { NULL, NULL };
 /* *INDENT-ON* */
 
 static const char *string_file_name (file_entry_t *, int);
@@ -121,6 +126,11 @@ mc_fhl_t *mc_filehighlight = NULL;
 #define MARKED_SELECTED 3
 #define STATUS          5
 
+/* Time after which a partially loaded directory is shown, in microseconds */
+#define PANEL_LOAD_SHOW_DELAY 300000
+/* Interval between repaints of a partially loaded directory, in microseconds */
+#define PANEL_LOAD_REPAINT_INTERVAL 200000
+
 /*** file scope type declarations ****************************************************************/
 
 typedef enum
@@ -155,6 +165,17 @@ typedef enum
     FILENAME_SCROLL_RIGHT = 4
 } filename_scroll_flag_t;
 
+/* State of the directory being loaded into the panel */
+typedef struct
+{
+    WPanel *panel;
+    guint64 start;              /* time the loading was started */
+    guint64 last_repaint;       /* time the list was shown last time */
+    int count;                  /* number of entries read so far */
+    gboolean moved;             /* cursor was moved by user since the last repaint */
+    gboolean cancelled;         /* loading was cancelled by user */
+} panel_load_state_t;
+
 /*** file scope variables ************************************************************************/
 
 /* *INDENT-OFF* */
@@ -1129,8 +1150,13 @@ paint_dir (WPanel * panel)
 
         if (i + panel->top_file < panel->dir.len)
         {
-            color = 2 * (panel->dir.list[i + panel->top_file].f.marked);
+            const file_entry_t *fe = &panel->dir.list[i + panel->top_file];
+
+            color = 2 * (fe->f.marked);
             color += (panel->selected == i + panel->top_file && panel->active);
+
+            if (fe->f.link_unresolved != 0 && panel->links != NULL)
+                dir_link_resolve (panel->links, fe->fname, i + panel->top_file, TRUE);
         }
 
         repaint_file (panel, i + panel->top_file, TRUE, color, FALSE);
@@ -1554,6 +1580,13 @@ panel_destroy (WPanel * p)
         g_free (name);
     }
 
+    dir_watch_free (p->watch);
+    p->watch = NULL;
+    dir_link_resolver_free (p->links);
+    p->links = NULL;
+    dir_compact_free (p->unfiltered);
+    p->unfiltered = NULL;
+
     panel_clean_dir (p);
 
     /* clean history */
@@ -2946,7 +2979,7 @@ do_enter (WPanel * panel)
 static void
 chdir_other_panel (WPanel * panel)
 {
-    const file_entry_t *entry = &panel->dir.list[panel->selected];
+    file_entry_t *entry = &panel->dir.list[panel->selected];
 
     vfs_path_t *new_dir_vpath;
     char *sel_entry = NULL;
@@ -2954,7 +2987,7 @@ chdir_other_panel (WPanel * panel)
     if (get_other_type () != view_listing)
         set_display_type (get_other_index (), view_listing);
 
-    if (S_ISDIR (entry->st.st_mode) || entry->f.link_to_dir)
+    if (S_ISDIR (entry->st.st_mode) || link_isdir (entry))
         new_dir_vpath = vfs_path_append_new (panel->cwd_vpath, entry->fname, (char *) NULL);
     else
     {
@@ -3321,6 +3354,460 @@ get_parent_dir_name (const vfs_path_t * cwd_vpath, const vfs_path_t * lwd_vpath)
     return (p != lwd || IS_PATH_SEP (*p)) ? p + 1 : p;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Handle a key pressed while the directory is being loaded.
+ * Only the cursor can be moved: the list isn't complete, so neither commands nor hooks are run.
+ * Other keys are dropped.
+ *
+ * @return FALSE if loading should be cancelled, TRUE otherwise
+ */
+
+static gboolean
+panel_load_dir_key (WPanel * panel, int key)
+{
+    long command = CK_IgnoreKey;
+    size_t i;
+
+    if (is_abort_char (key))
+        return FALSE;
+
+    for (i = 0; panel_map[i].key != 0; i++)
+        if (key == panel_map[i].key)
+        {
+            command = panel_map[i].command;
+            break;
+        }
+
+    switch (command)
+    {
+    case CK_Up:
+        panel->selected--;
+        break;
+    case CK_Down:
+        panel->selected++;
+        break;
+    case CK_PageUp:
+        panel->selected -= panel_items (panel);
+        break;
+    case CK_PageDown:
+        panel->selected += panel_items (panel);
+        break;
+    case CK_Top:
+        panel->selected = 0;
+        break;
+    case CK_Bottom:
+        panel->selected = panel->dir.len - 1;
+        break;
+    default:
+        break;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Callback of dir_list_load() and dir_list_reload(). If loading takes a while, show entries
+ * read so far (in the order they are read) and let user move the cursor or cancel loading.
+ */
+
+static gboolean
+panel_load_dir_callback (dir_list_cb_state_t state, void *data)
+{
+    panel_load_state_t *ls = (panel_load_state_t *) data;
+    WPanel *panel = ls->panel;
+    Widget *w = WIDGET (panel);
+    guint64 now;
+
+    if (state == DIR_OPEN)
+        ls->start = ls->last_repaint = mc_timer_elapsed (mc_global.timer);
+
+    /* don't check the clock and the keyboard on every entry */
+    if (state != DIR_READ || (++ls->count & 15) != 0)
+        return TRUE;
+
+    now = mc_timer_elapsed (mc_global.timer);
+    if (now - ls->start < PANEL_LOAD_SHOW_DELAY)
+        return TRUE;
+
+    /* panel isn't shown yet */
+    if (w->owner == NULL || ok_to_refresh <= 0)
+        return TRUE;
+
+    while (!is_idle ())
+    {
+        int key;
+
+        key = get_key_code (1);
+        if (key == -1)
+            break;
+        if (!panel_load_dir_key (panel, key))
+        {
+            ls->cancelled = TRUE;
+            return FALSE;
+        }
+        ls->moved = TRUE;
+    }
+
+    if (panel->dir.len > 0 && (ls->moved || now - ls->last_repaint >= PANEL_LOAD_REPAINT_INTERVAL))
+    {
+        panel->selected = CLAMP (panel->selected, 0, panel->dir.len - 1);
+        adjust_top_file (panel);
+        paint_dir (panel);
+        mc_refresh ();
+
+        ls->last_repaint = now;
+        ls->moved = FALSE;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remember stat of the current directory of the panel before its listing is read.
+ * Times are compared in seconds, so if the directory was changed just now, another change
+ * in the same second can't be detected: such listing isn't kept in the dir cache.
+ */
+
+static void
+panel_stat_load_dir (WPanel * panel)
+{
+    time_t now;
+
+    now = time (NULL);
+    if (mc_stat (panel->cwd_vpath, &panel->load_stat) != 0
+        || panel->load_stat.st_mtime >= now - 1 || panel->load_stat.st_ctime >= now - 1)
+        memset (&panel->load_stat, 0, sizeof (panel->load_stat));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Apply changes of the watched directory to the panel which shows it.
+ * Changes are postponed while a dialog is shown over the panels: e.g. a file operation
+ * may be in progress and use the list of the panel.
+ */
+
+static gboolean
+panel_watch_callback (dir_watch_t * watch, GHashTable * names, gboolean overflow)
+{
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        WPanel *panel;
+        char *current_file = NULL;
+
+        if (get_display_type (i) != view_listing)
+            continue;
+
+        panel = PANEL (get_panel_widget (i));
+        if (panel->watch != watch)
+            continue;
+
+        if (panel->is_panelized)
+            return TRUE;
+
+        if (top_dlg == NULL || top_dlg->data != WIDGET (panel)->owner
+            || panel->dir.callback != NULL)
+            return FALSE;
+
+        if (panel->dir.len != 0)
+            current_file = g_strdup (selection (panel)->fname);
+
+        if (overflow)
+        {
+            /* the watch can be freed here */
+            panel_reload (panel);
+            try_to_select (panel, current_file);
+        }
+        else
+        {
+#ifdef ENABLE_LUA
+            mc_lua_set_current_field (panel, panel->sort_field->id);
+#endif
+            if (dir_list_update (&panel->dir, panel->cwd_vpath, names,
+                                 panel->sort_field->sort_routine, &panel->sort_info,
+                                 panel->filter))
+            {
+                /* the list matches the directory again */
+                panel_stat_load_dir (panel);
+                recalculate_panel_summary (panel);
+                try_to_select (panel, current_file);
+                panel->dirty = 1;
+            }
+        }
+
+        g_free (current_file);
+
+        if (panel->dirty)
+            widget_redraw (WIDGET (panel));
+
+        break;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Watch the current directory of the panel for changes.
+ */
+
+static void
+panel_update_watch (WPanel * panel)
+{
+    if (panel->watch != NULL && panels_options.auto_refresh
+        && vfs_path_equal (dir_watch_get_path (panel->watch), panel->cwd_vpath))
+        return;
+
+    dir_watch_free (panel->watch);
+    panel->watch = NULL;
+
+    if (panels_options.auto_refresh)
+        panel->watch = dir_watch_new (panel->cwd_vpath, panel_watch_callback);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the order of entries depends on whether symlinks point to directories.
+ */
+
+static gboolean
+panel_sort_needs_links (const WPanel * panel)
+{
+    return (!panels_options.mix_all_files
+            && panel->sort_field->sort_routine != (GCompareFunc) unsorted);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Apply resolved symlinks to the panel which shows their directory. Links to directories
+ * are moved to their place unless a dialog is shown over the panels: e.g. a file operation
+ * may be in progress and use the list of the panel. The panel is reloaded after it anyway.
+ */
+
+static void
+panel_links_callback (dir_link_resolver_t * resolver, GPtrArray * links)
+{
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        WPanel *panel;
+        GHashTable *index = NULL;
+        gboolean resort = FALSE;
+        guint j;
+
+        if (get_display_type (i) != view_listing)
+            continue;
+
+        panel = PANEL (get_panel_widget (i));
+        if (panel->links != resolver)
+            continue;
+
+        for (j = 0; j < links->len; j++)
+        {
+            const dir_link_t *link = (const dir_link_t *) g_ptr_array_index (links, j);
+            int k = link->index;
+            file_entry_t *fe;
+
+            /* the list could be resorted since the request */
+            if (k >= panel->dir.len || strcmp (panel->dir.list[k].fname, link->fname) != 0)
+            {
+                if (index == NULL)
+                {
+                    index = g_hash_table_new (g_str_hash, g_str_equal);
+                    for (k = 0; k < panel->dir.len; k++)
+                        g_hash_table_insert (index, panel->dir.list[k].fname,
+                                             GINT_TO_POINTER (k + 1));
+                }
+
+                k = GPOINTER_TO_INT (g_hash_table_lookup (index, link->fname)) - 1;
+                if (k < 0)
+                    continue;
+            }
+
+            fe = &panel->dir.list[k];
+            if (fe->f.link_unresolved == 0)
+                continue;
+
+            fe->f.link_unresolved = 0;
+            fe->f.link_to_dir = link->link_to_dir ? 1 : 0;
+            fe->f.stale_link = link->stale_link ? 1 : 0;
+            resort = resort || link->link_to_dir;
+            panel->dirty = 1;
+        }
+
+        if (index != NULL)
+            g_hash_table_destroy (index);
+
+        if (resort && panel_sort_needs_links (panel) && top_dlg != NULL
+            && top_dlg->data == WIDGET (panel)->owner && panel->dir.callback == NULL)
+        {
+            char *current_file;
+
+            current_file = g_strdup (selection (panel)->fname);
+#ifdef ENABLE_LUA
+            mc_lua_set_current_field (panel, panel->sort_field->id);
+#endif
+            dir_list_sort (&panel->dir, panel->sort_field->sort_routine, &panel->sort_info);
+            try_to_select (panel, current_file);
+            g_free (current_file);
+        }
+
+        if (panel->dirty)
+            widget_redraw (WIDGET (panel));
+
+        break;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start resolving of symlinks of the current directory which were not resolved while it
+ * was read. Visible links are requested when they are painted; all of them are requested
+ * here if they are needed to sort the list.
+ */
+
+static void
+panel_resolve_links (WPanel * panel)
+{
+    int i;
+
+    if (panel->links == NULL || !panel_sort_needs_links (panel))
+        return;
+
+    for (i = 0; i < panel->dir.len; i++)
+        if (panel->dir.list[i].f.link_unresolved != 0)
+            dir_link_resolve (panel->links, panel->dir.list[i].fname, i, FALSE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create the resolver of symlinks of the loaded directory if some of them were not resolved.
+ */
+
+static void
+panel_update_links (WPanel * panel)
+{
+    int i;
+
+    dir_link_resolver_free (panel->links);
+    panel->links = NULL;
+
+    for (i = 0; i < panel->dir.len; i++)
+        if (panel->dir.list[i].f.link_unresolved != 0)
+            break;
+
+    if (i < panel->dir.len)
+    {
+        panel->links = dir_link_resolver_new (panel->cwd_vpath, panel_links_callback);
+        panel_resolve_links (panel);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Show sizes of local directories which have been computed before and not changed since.
+ * Sizes saved in previous sessions are shown, but not counted as computed: subdirectories
+ * may have been changed since.
+ *
+ * @return TRUE if some sizes are shown
+ */
+
+static gboolean
+panel_update_dir_sizes (WPanel * panel)
+{
+    gboolean found = FALSE;
+    int i;
+
+    if (!dir_size_can_scan (panel->cwd_vpath))
+        return FALSE;
+
+    for (i = 0; i < panel->dir.len; i++)
+    {
+        file_entry_t *fe = &panel->dir.list[i];
+        dir_size_t size;
+        gboolean confirmed;
+
+        if (S_ISDIR (fe->st.st_mode) && fe->f.dir_size_computed == 0
+            && !DIR_IS_DOTDOT (fe->fname) && dir_size_lookup (&fe->st, &size, &confirmed))
+        {
+            fe->st.st_size = (off_t) dir_size_value (&size);
+            fe->f.dir_size_computed = confirmed ? 1 : 0;
+            found = TRUE;
+        }
+    }
+
+    return found;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Load (or reload) the current directory of the panel showing the progress.
+ * If the directory was visited recently and wasn't changed since, its listing is taken
+ * from the cache.
+ */
+
+static void
+panel_load_dir (WPanel * panel, gboolean reload)
+{
+    panel_load_state_t ls;
+
+    /* results for the previous list are useless */
+    dir_link_resolver_free (panel->links);
+    panel->links = NULL;
+    dir_compact_free (panel->unfiltered);
+    panel->unfiltered = NULL;
+
+#ifdef ENABLE_LUA
+    mc_lua_set_current_field (panel, panel->sort_field->id);
+#endif
+
+    if (!reload)
+    {
+        dir_list_clean (&panel->dir);
+        if (dir_cache_get (panel->cwd_vpath, panel->filter, &panel->dir, &panel->load_stat))
+        {
+            (void) panel_update_dir_sizes (panel);
+            dir_list_sort (&panel->dir, panel->sort_field->sort_routine, &panel->sort_info);
+            panel->load_complete = TRUE;
+            panel_update_watch (panel);
+            panel_update_links (panel);
+            return;
+        }
+    }
+
+    panel_stat_load_dir (panel);
+
+    memset (&ls, 0, sizeof (ls));
+    ls.panel = panel;
+
+    /* the list can be swapped with the other panel, so the callback is set for this load only */
+    panel->dir.callback = panel_load_dir_callback;
+    panel->dir.callback_data = &ls;
+
+    if (reload)
+        dir_list_reload (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
+                         &panel->sort_info, panel->filter);
+    else
+        dir_list_load (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
+                       &panel->sort_info, panel->filter);
+
+    panel->dir.callback = NULL;
+    panel->dir.callback_data = NULL;
+
+    if (panel_update_dir_sizes (panel)
+        && panel->sort_field->sort_routine == (GCompareFunc) sort_size)
+        dir_list_sort (&panel->dir, panel->sort_field->sort_routine, &panel->sort_info);
+
+    panel->load_complete = !ls.cancelled;
+    panel_update_watch (panel);
+    panel_update_links (panel);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /** Wrapper for do_subshell_chdir, check for availability of subshell */
 
@@ -3361,6 +3848,12 @@ _do_panel_cd (WPanel * panel, const vfs_path_t * new_dir_vpath, enum cd_enum cd_
     if (mc_chdir (new_dir_vpath) == -1)
         return FALSE;
 
+    /* Keep the listing of previous directory: the user may go back soon */
+    if (!panel->is_panelized && panel->load_complete)
+        dir_cache_put (panel->cwd_vpath, panel->filter, &panel->dir, &panel->load_stat,
+                       panel->watch != NULL && !dir_watch_has_changes (panel->watch));
+    panel->load_complete = FALSE;
+
     /* Success: save previous directory, shutdown status of previous dir */
     olddir_vpath = vfs_path_clone (panel->cwd_vpath);
     panel_set_lwd (panel, panel->cwd_vpath);
@@ -3377,11 +3870,7 @@ _do_panel_cd (WPanel * panel, const vfs_path_t * new_dir_vpath, enum cd_enum cd_
     /* Reload current panel */
     panel_clean_dir (panel);
 
-#ifdef ENABLE_LUA
-    mc_lua_set_current_field (panel, panel->sort_field->id);
-#endif
-    dir_list_load (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
-                   &panel->sort_info, panel->filter);
+    panel_load_dir (panel, FALSE);
     try_to_select (panel, get_parent_dir_name (panel->cwd_vpath, olddir_vpath));
     scripting_trigger_widget_event ("Panel::load", WIDGET (panel));
 
@@ -4469,11 +4958,7 @@ panel_new_with_dir (const char *panel_name, const vfs_path_t * vpath)
     }
 
     /* Load the default format */
-#ifdef ENABLE_LUA
-    mc_lua_set_current_field (panel, panel->sort_field->id);
-#endif
-    dir_list_load (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
-                   &panel->sort_info, panel->filter);
+    panel_load_dir (panel, FALSE);
     scripting_trigger_widget_event ("Panel::load", WIDGET (panel));
 
     /* Restore old right path */
@@ -4518,11 +5003,7 @@ panel_reload (WPanel * panel)
     memset (&(panel->dir_stat), 0, sizeof (panel->dir_stat));
     show_dir (panel);
 
-#ifdef ENABLE_LUA
-    mc_lua_set_current_field (panel, panel->sort_field->id);
-#endif
-    dir_list_reload (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
-                     &panel->sort_info, panel->filter);
+    panel_load_dir (panel, TRUE);
     scripting_trigger_widget_event ("Panel::load", WIDGET (panel));
 
     panel->dirty = 1;
@@ -4532,6 +5013,104 @@ panel_reload (WPanel * panel)
     recalculate_panel_summary (panel);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Apply the new filter of the panel without reading the directory again. If the new filter
+ * is narrower than the old one, the current list is filtered. Otherwise the list is made from
+ * the unfiltered copy kept when the filter was set. Marks of entries are kept.
+ *
+ * @param panel the panel, its filter is already set to the new one
+ * @param old_filter filter the list was loaded with
+ *
+ * @return FALSE if the directory has to be read again
+ */
+
+gboolean
+panel_refilter (WPanel * panel, const char *old_filter)
+{
+    struct stat st;
+    char *current_file;
+
+    /* setting the same filter again rereads the directory as always */
+    if (g_strcmp0 (old_filter, panel->filter) == 0
+        || panel->is_panelized
+        || !panel->load_complete
+        || panel->load_stat.st_mtime == 0
+        || panel->dir.len == 0
+        || mc_stat (panel->cwd_vpath, &st) != 0
+        || st.st_mtime != panel->load_stat.st_mtime
+        || st.st_ctime != panel->load_stat.st_ctime
+        || st.st_ino != panel->load_stat.st_ino
+        || st.st_dev != panel->load_stat.st_dev)
+        return FALSE;
+
+    if (old_filter == NULL)
+    {
+        /* keep all entries to restore them when the filter is changed or removed */
+        dir_compact_free (panel->unfiltered);
+        panel->unfiltered = dir_compact_from_list (&panel->dir);
+        panel->unfiltered_stat = panel->load_stat;
+    }
+
+    current_file = g_strdup (selection (panel)->fname);
+
+    if (dir_filter_is_narrower (old_filter, panel->filter))
+        dir_list_filter (&panel->dir, panel->cwd_vpath, panel->filter);
+    else if (panel->unfiltered != NULL
+             && panel->unfiltered_stat.st_mtime == panel->load_stat.st_mtime
+             && panel->unfiltered_stat.st_ctime == panel->load_stat.st_ctime)
+    {
+        GHashTable *marked;
+        int i;
+
+        marked = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        for (i = 0; i < panel->dir.len; i++)
+            if (panel->dir.list[i].f.marked != 0)
+                g_hash_table_insert (marked, g_strdup (panel->dir.list[i].fname),
+                                     GINT_TO_POINTER (1));
+        dir_list_clean (&panel->dir);
+
+        if (!dir_compact_to_list (panel->unfiltered, &panel->dir))
+        {
+            g_hash_table_destroy (marked);
+            g_free (current_file);
+            return FALSE;
+        }
+
+        for (i = 0; i < panel->dir.len; i++)
+            panel->dir.list[i].f.marked =
+                g_hash_table_lookup (marked, panel->dir.list[i].fname) != NULL ? 1 : 0;
+        g_hash_table_destroy (marked);
+
+        dir_list_filter (&panel->dir, panel->cwd_vpath, panel->filter);
+#ifdef ENABLE_LUA
+        mc_lua_set_current_field (panel, panel->sort_field->id);
+#endif
+        dir_list_sort (&panel->dir, panel->sort_field->sort_routine, &panel->sort_info);
+
+        if (panel->filter == NULL)
+        {
+            dir_compact_free (panel->unfiltered);
+            panel->unfiltered = NULL;
+        }
+    }
+    else
+    {
+        g_free (current_file);
+        return FALSE;
+    }
+
+    scripting_trigger_widget_event ("Panel::load", WIDGET (panel));
+
+    recalculate_panel_summary (panel);
+    panel->selected = 0;
+    try_to_select (panel, current_file);
+    g_free (current_file);
+    panel->dirty = 1;
+
+    return TRUE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /* Switches the panel to the mode specified in the format           */
 /* Seting up both format and status string. Return: 0 - on success; */
@@ -4787,6 +5366,7 @@ panel_re_sort (WPanel * panel)
     mc_lua_set_current_field (panel, panel->sort_field->id);
 #endif
     dir_list_sort (&panel->dir, panel->sort_field->sort_routine, &panel->sort_info);
+    panel_resolve_links (panel);
     panel->selected = -1;
 
     for (i = panel->dir.len; i != 0; i--)
@@ -14,6 +14,9 @@
 #include "lib/filehighlight.h"
 
 #include "dir.h"                /* dir_list */
+#include "dircompact.h"         /* dir_compact_t */
+#include "dirlink.h"            /* dir_link_resolver_t */
+#include "dirwatch.h"           /* dir_watch_t */
 
 /*** typedefs(not structures) and defined constants **********************************************/
 
@@ -84,7 +87,7 @@ typedef struct panel_field_struct
 
 typedef struct
 {
-    dir_list list;
+    dir_compact_t *list;        /**< saved listing, NULL if there is none */
     vfs_path_t *root_vpath;
 } panelized_panel_t;
 
@@ -92,6 +95,10 @@ typedef struct
 {
     Widget widget;
     dir_list dir;               /* Directory contents */
+    dir_watch_t *watch;         /* Watch of the current directory for changes, may be NULL */
+    dir_link_resolver_t *links; /* Resolver of symlinks of the current directory, may be NULL */
+    dir_compact_t *unfiltered;  /* All entries of the current directory while it is filtered */
+    struct stat unfiltered_stat;        /* Stat of current dir when the entries were loaded */
 
     list_type_t list_type;      /* listing type */
     int active;                 /* If panel is currently selected */
@@ -128,6 +135,8 @@ typedef struct
 
     char *panel_name;           /* The panel name */
     struct stat dir_stat;       /* Stat of current dir: used by execute () */
+    struct stat load_stat;      /* Stat of current dir when it was loaded: used by dir cache */
+    gboolean load_complete;     /* Current dir was loaded without errors and cancelling */
 
 #ifdef HAVE_CHARSET
     int codepage;               /* panel codepage */
@@ -156,6 +165,7 @@ WPanel *panel_new_with_dir (const char *panel_name, const vfs_path_t * vpath);
 void panel_clean_dir (WPanel * panel);
 
 void panel_reload (WPanel * panel);
+gboolean panel_refilter (WPanel * panel, const char *old_filter);
 void panel_set_sort_order (WPanel * panel, const panel_field_t * sort_order);
 void panel_re_sort (WPanel * panel);
 
@@ -51,6 +51,7 @@
 #include "src/history.h"
 
 #include "dir.h"
+#include "dircompact.h"
 #include "midnight.h"           /* current_panel */
 #include "layout.h"             /* rotate_dash() */
 #include "panel.h"              /* WPanel */
@@ -390,51 +391,46 @@ do_panelize_cd (WPanel * panel)
 {
     int i;
     dir_list *list;
+    const dir_compact_t *saved = panelized_panel.list;
     gboolean panelized_same;
 
     dir_list_clean (&panel->dir);
     if (panelized_panel.root_vpath == NULL)
         panelize_change_root (current_panel->cwd_vpath);
 
-    if (panelized_panel.list.len < 1)
-        dir_list_init (&panelized_panel.list);
-    else if (panelized_panel.list.len > panel->dir.size)
-        dir_list_grow (&panel->dir, panelized_panel.list.len - panel->dir.size);
-
     list = &panel->dir;
-    list->len = panelized_panel.list.len;
+
+    if (saved == NULL || saved->len < 1)
+        dir_list_init (list);
+    else
+    {
+        if (saved->len > list->size)
+            dir_list_grow (list, saved->len - list->size);
+        list->len = saved->len;
+    }
+
     panel->is_panelized = TRUE;
 
     panelized_same = vfs_path_equal (panelized_panel.root_vpath, panel->cwd_vpath);
 
-    for (i = 0; i < panelized_panel.list.len; i++)
+    for (i = 0; saved != NULL && i < saved->len; i++)
     {
-        if (panelized_same || DIR_IS_DOTDOT (panelized_panel.list.list[i].fname))
-        {
-            list->list[i].fnamelen = panelized_panel.list.list[i].fnamelen;
-            list->list[i].fname = g_strndup (panelized_panel.list.list[i].fname,
-                                             panelized_panel.list.list[i].fnamelen);
-        }
-        else
+        file_entry_t *fe = &list->list[i];
+
+        dir_compact_get_entry (saved, i, fe);
+
+        if (!panelized_same && !DIR_IS_DOTDOT (fe->fname))
         {
             vfs_path_t *tmp_vpath;
             const char *fname;
 
-            tmp_vpath =
-                vfs_path_append_new (panelized_panel.root_vpath, panelized_panel.list.list[i].fname,
-                                     (char *) NULL);
+            tmp_vpath = vfs_path_append_new (panelized_panel.root_vpath, fe->fname, (char *) NULL);
             fname = vfs_path_as_str (tmp_vpath);
-            list->list[i].fnamelen = strlen (fname);
-            list->list[i].fname = g_strndup (fname, list->list[i].fnamelen);
+            g_free (fe->fname);
+            fe->fnamelen = strlen (fname);
+            fe->fname = g_strndup (fname, fe->fnamelen);
             vfs_path_free (tmp_vpath);
         }
-        list->list[i].f.link_to_dir = panelized_panel.list.list[i].f.link_to_dir;
-        list->list[i].f.stale_link = panelized_panel.list.list[i].f.stale_link;
-        list->list[i].f.dir_size_computed = panelized_panel.list.list[i].f.dir_size_computed;
-        list->list[i].f.marked = panelized_panel.list.list[i].f.marked;
-        list->list[i].st = panelized_panel.list.list[i].st;
-        list->list[i].sort_key = panelized_panel.list.list[i].sort_key;
-        list->list[i].second_sort_key = panelized_panel.list.list[i].second_sort_key;
     }
     try_to_select (panel, NULL);
 }
@@ -459,33 +455,15 @@ panelize_change_root (const vfs_path_t * new_root)
 void
 panelize_save_panel (WPanel * panel)
 {
-    int i;
-    dir_list *list = &panel->dir;
-
     panelize_change_root (current_panel->cwd_vpath);
 
-    if (panelized_panel.list.len > 0)
-        dir_list_clean (&panelized_panel.list);
+    dir_compact_free (panelized_panel.list);
+    panelized_panel.list = NULL;
     if (panel->dir.len == 0)
         return;
 
-    if (panel->dir.len > panelized_panel.list.size)
-        dir_list_grow (&panelized_panel.list, panel->dir.len - panelized_panel.list.size);
-    panelized_panel.list.len = panel->dir.len;
-
-    for (i = 0; i < panel->dir.len; i++)
-    {
-        panelized_panel.list.list[i].fnamelen = list->list[i].fnamelen;
-        panelized_panel.list.list[i].fname =
-            g_strndup (list->list[i].fname, list->list[i].fnamelen);
-        panelized_panel.list.list[i].f.link_to_dir = list->list[i].f.link_to_dir;
-        panelized_panel.list.list[i].f.stale_link = list->list[i].f.stale_link;
-        panelized_panel.list.list[i].f.dir_size_computed = list->list[i].f.dir_size_computed;
-        panelized_panel.list.list[i].f.marked = list->list[i].f.marked;
-        panelized_panel.list.list[i].st = list->list[i].st;
-        panelized_panel.list.list[i].sort_key = list->list[i].sort_key;
-        panelized_panel.list.list[i].second_sort_key = list->list[i].second_sort_key;
-    }
+    /* only the panel itself keeps the full entries */
+    panelized_panel.list = dir_compact_from_list (&panel->dir);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,274 @@
+/*
+   Computing of totals of a file operation in background
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file src/filemanager/totalscan.c
+ *  \brief Source: computing of totals of a file operation in background
+ *
+ *  Scanning of a huge tree for the number of files and bytes may take longer than
+ *  the operation itself. If file_op_background_totals is set, local trees are scanned
+ *  by a thread while the operation goes on, and the totals shown in the progress dialog
+ *  grow as the thread finds more files. The thread counts files the same way as
+ *  compute_dir_size() does, but with plain syscalls: neither the VFS nor the UI may be
+ *  touched from it.
+ */
+
+#include <config.h>
+
+#include <dirent.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+#include "totalscan.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/*** file scope type declarations ****************************************************************/
+
+struct total_scan_struct
+{
+#ifdef HAVE_GLIB_THREADS
+    GThread *thread;
+    GMutex lock;
+#endif
+    GPtrArray *paths;           /* trees to be scanned */
+    gboolean follow_links;
+
+    /* changed by the thread under the lock */
+    size_t count;
+    uintmax_t bytes;
+    gboolean finished;
+
+    volatile gint cancelled;
+};
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_GLIB_THREADS
+
+static void
+total_scan_add (total_scan_t * scan, off_t size)
+{
+    g_mutex_lock (&scan->lock);
+    scan->count++;
+    scan->bytes += (uintmax_t) size;
+    g_mutex_unlock (&scan->lock);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Count files of the directory. Names of entries are appended to the path while they're stat'ed */
+
+static void
+total_scan_dir (total_scan_t * scan, GString * path)
+{
+    DIR *dir;
+    struct dirent *dirent;
+
+    dir = opendir (path->str);
+    if (dir == NULL)
+        return;
+
+    while (g_atomic_int_get (&scan->cancelled) == 0 && (dirent = readdir (dir)) != NULL)
+    {
+        gsize len = path->len;
+        struct stat st;
+
+        if (DIR_IS_DOT (dirent->d_name) || DIR_IS_DOTDOT (dirent->d_name))
+            continue;
+
+        if (len == 0 || !IS_PATH_SEP (path->str[len - 1]))
+            g_string_append_c (path, PATH_SEP);
+        g_string_append (path, dirent->d_name);
+
+        if (lstat (path->str, &st) == 0)
+        {
+            if (S_ISDIR (st.st_mode))
+                total_scan_dir (scan, path);
+            else
+                total_scan_add (scan, st.st_size);
+        }
+
+        g_string_truncate (path, len);
+    }
+
+    closedir (dir);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gpointer
+total_scan_thread (gpointer data)
+{
+    total_scan_t *scan = (total_scan_t *) data;
+    guint i;
+
+    for (i = 0; i < scan->paths->len && g_atomic_int_get (&scan->cancelled) == 0; i++)
+    {
+        GString *path;
+        struct stat st;
+
+        path = g_string_new ((const char *) g_ptr_array_index (scan->paths, i));
+
+        /* symlinks to directories are not scanned unless links are followed */
+        if ((scan->follow_links ? stat (path->str, &st) : lstat (path->str, &st)) == 0)
+        {
+            if (S_ISDIR (st.st_mode))
+                total_scan_dir (scan, path);
+            else
+                total_scan_add (scan, st.st_size);
+        }
+
+        g_string_free (path, TRUE);
+    }
+
+    g_mutex_lock (&scan->lock);
+    scan->finished = TRUE;
+    g_mutex_unlock (&scan->lock);
+
+    return NULL;
+}
+
+#endif /* HAVE_GLIB_THREADS */
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the tree can be scanned by the thread: it must be on the local filesystem.
+ */
+
+gboolean
+total_scan_can_scan (const vfs_path_t * vpath)
+{
+#ifdef HAVE_GLIB_THREADS
+    return (vfs_file_get_local_path (vpath) != NULL);
+#else
+    (void) vpath;
+
+    return FALSE;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start scanning of trees.
+ *
+ * @param paths local paths accepted by total_scan_can_scan(). The array is owned by
+ *              the scan then, it should free its elements
+ * @param follow_links if TRUE, the trees may be symlinks to directories
+ * @param count number of files counted already
+ * @param bytes size of files counted already
+ *
+ * @return new scan or NULL if the thread can't be started
+ */
+
+total_scan_t *
+total_scan_start (GPtrArray * paths, gboolean follow_links, size_t count, uintmax_t bytes)
+{
+#ifdef HAVE_GLIB_THREADS
+    total_scan_t *scan;
+
+    scan = g_new0 (total_scan_t, 1);
+    scan->paths = paths;
+    scan->follow_links = follow_links;
+    scan->count = count;
+    scan->bytes = bytes;
+    g_mutex_init (&scan->lock);
+
+    scan->thread = g_thread_try_new ("total-scan", total_scan_thread, scan, NULL);
+    if (scan->thread == NULL)
+    {
+        g_mutex_clear (&scan->lock);
+        g_free (scan);
+        return NULL;
+    }
+
+    return scan;
+#else
+    (void) paths;
+    (void) follow_links;
+    (void) count;
+    (void) bytes;
+
+    return NULL;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get totals found so far.
+ *
+ * @return TRUE if all trees have been scanned
+ */
+
+gboolean
+total_scan_get (total_scan_t * scan, size_t * count, uintmax_t * bytes)
+{
+#ifdef HAVE_GLIB_THREADS
+    gboolean finished;
+
+    g_mutex_lock (&scan->lock);
+    *count = scan->count;
+    *bytes = scan->bytes;
+    finished = scan->finished;
+    g_mutex_unlock (&scan->lock);
+
+    return finished;
+#else
+    (void) scan;
+    (void) count;
+    (void) bytes;
+
+    return TRUE;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop scanning, if it's not finished yet, and free the scan.
+ */
+
+void
+total_scan_free (total_scan_t * scan)
+{
+#ifdef HAVE_GLIB_THREADS
+    if (scan == NULL)
+        return;
+
+    g_atomic_int_set (&scan->cancelled, 1);
+    g_thread_join (scan->thread);
+    g_mutex_clear (&scan->lock);
+    g_ptr_array_free (scan->paths, TRUE);
+    g_free (scan);
+#else
+    (void) scan;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
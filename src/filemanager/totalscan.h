@@ -0,0 +1,31 @@
+/** \file totalscan.h
+ *  \brief Header: computing of totals of a file operation in background
+ */
+
+#ifndef MC__TOTALSCAN_H
+#define MC__TOTALSCAN_H
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct total_scan_struct total_scan_t;
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+gboolean total_scan_can_scan (const vfs_path_t * vpath);
+total_scan_t *total_scan_start (GPtrArray * paths, gboolean follow_links, size_t count,
+                                uintmax_t bytes);
+gboolean total_scan_get (total_scan_t * scan, size_t * count, uintmax_t * bytes);
+void total_scan_free (total_scan_t * scan);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__TOTALSCAN_H */
@@ -28,6 +28,7 @@
 #define MC_HISTORY_FM_FILTERED_VIEW   "mc.fm.filtered-view"
 #define MC_HISTORY_FM_PANEL_FILTER    "mc.fm.panel-filter"
 #define MC_HISTORY_FM_MENU_EXEC_PARAM "mc.fm.menu.exec.parameter"
+#define MC_HISTORY_FM_COPY_THREADS    "mc.fm.copy-threads"
 
 #define MC_HISTORY_ESC_TIMEOUT        "mc.esc.timeout"
 
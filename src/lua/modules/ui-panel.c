@@ -722,6 +722,10 @@ l_panel_get_file_by_index (lua_State * L)
 
         fe = &panel->dir.list[i];
 
+        /* Don't report a broken link as a good one before the resolver got to it. */
+        if (fe->f.link_unresolved != 0)
+            dir_entry_resolve_link (panel->cwd_vpath, fe);
+
         lua_pushstring (L, fe->fname);
         if (!skip_stat)
             luaFS_push_statbuf (L, &fe->st);
@@ -0,0 +1,83 @@
+#!/bin/bash
+
+#
+# Benchmarks the ways MC copies data between local files. See the README.
+#
+# Usage: run.sh setup|run|cleanup MOUNTPOINT [FSTYPE] [SIZE_MB]
+#
+
+ATTR_BOLD=$'\x1b[1m'
+ATTR_REVERSE=$'\x1b[7m'
+ATTR_NORMAL=$'\x1b[0m'
+
+export TIME="$ATTR_BOLD%eelapsed %Uuser %Ssystem$ATTR_NORMAL"
+
+ACTION=${1:?You must specify an action: setup, run or cleanup}
+MNT=${2:?You must specify a mount point}
+FSTYPE=${3:-btrfs}
+SIZE_MB=${4:-2048}
+
+IMAGE=$MNT.img
+MC=${MC:-mc}
+
+tm=/usr/bin/time
+
+function drop_caches {
+  sync
+  echo 3 > /proc/sys/vm/drop_caches
+}
+
+function space {
+  df -h --output=used "$MNT" | tail -1
+}
+
+case "$ACTION" in
+  setup)
+    # The image is twice as big as the test file, plus room for the metadata.
+    truncate -s $((SIZE_MB * 3))M "$IMAGE" || exit 1
+    case "$FSTYPE" in
+      btrfs) mkfs.btrfs -q "$IMAGE" ;;
+      xfs) mkfs.xfs -q -m reflink=1 "$IMAGE" ;;
+      *) mkfs -t "$FSTYPE" -q "$IMAGE" ;;
+    esac || exit 1
+    mkdir -p "$MNT" && mount -o loop "$IMAGE" "$MNT" || exit 1
+    mkdir "$MNT/src" "$MNT/dst"
+    head -c $((SIZE_MB * 1024 * 1024)) /dev/urandom > "$MNT/src/big"
+    echo "$(du -h "$MNT/src/big" | cut -f1) test file on $FSTYPE in $MNT"
+    ;;
+
+  run)
+    for method in 3 2 1 0; do
+      rm -f "$MNT/dst/big"
+      conf=$(mktemp -d)
+      mkdir "$conf/mc"
+      printf '[Midnight-Commander]\ncopy_method=%d\n' $method > "$conf/mc/ini"
+      drop_caches
+      echo
+      echo "${ATTR_REVERSE}copy_method=$method: press F5, Enter, then F10$ATTR_NORMAL"
+      read -r -p "(press Enter to start MC) "
+      XDG_CONFIG_HOME=$conf $tm "$MC" -u "$MNT/src" "$MNT/dst"
+      echo "space used: $(space)"
+      rm -rf "$conf"
+    done
+
+    for reflink in always never; do
+      rm -f "$MNT/dst/big"
+      drop_caches
+      echo
+      echo "${ATTR_REVERSE}cp --reflink=$reflink$ATTR_NORMAL"
+      $tm cp --reflink=$reflink "$MNT/src/big" "$MNT/dst/big"
+      echo "space used: $(space)"
+    done
+    rm -f "$MNT/dst/big"
+    ;;
+
+  cleanup)
+    umount "$MNT" && rm -f "$IMAGE" && rmdir "$MNT"
+    ;;
+
+  *)
+    echo "Unknown action: $ACTION" >&2
+    exit 1
+    ;;
+esac
@@ -0,0 +1,78 @@
+#!/bin/bash
+
+#
+# Benchmarks the overwriting of a big file changed in a few places. See the README.
+#
+# Usage: run.sh DIR [SIZE_MB] [CHANGES]
+#
+
+ATTR_BOLD=$'\x1b[1m'
+ATTR_REVERSE=$'\x1b[7m'
+ATTR_NORMAL=$'\x1b[0m'
+
+DIR=${1:?You must specify a directory}
+SIZE_MB=${2:-1024}
+CHANGES=${3:-16}
+
+MC=${MC:-mc}
+
+function drop_caches {
+  sync
+  if [ -w /proc/sys/vm/drop_caches ]; then
+    echo 3 > /proc/sys/vm/drop_caches
+  fi
+}
+
+# sectors written to the device of DIR, or nothing if it's unknown
+function sectors_written {
+  local dev
+
+  dev=$(basename "$(findmnt -n -o SOURCE --target "$DIR" 2> /dev/null)")
+  [ -r "/sys/class/block/$dev/stat" ] && awk '{ print $7 }' "/sys/class/block/$dev/stat"
+}
+
+function change {
+  local i
+
+  for ((i = 0; i < CHANGES; i++)); do
+    head -c 4096 /dev/urandom | dd of="$DIR/src/big" bs=1 conv=notrunc status=none \
+      seek=$(( (RANDOM * 32768 + RANDOM) % (SIZE_MB * 1024 * 1024 - 4096) ))
+  done
+}
+
+function run {
+  local min_size=$1 conf start end before after
+
+  cp "$DIR/dst/big.orig" "$DIR/dst/big"
+  conf=$(mktemp -d)
+  mkdir "$conf/mc"
+  printf '[Midnight-Commander]\ncopy_method=0\ncopy_delta_min_size=%d\n' "$min_size" \
+    > "$conf/mc/ini"
+  drop_caches
+
+  echo
+  echo "${ATTR_REVERSE}copy_delta_min_size=$min_size: press F5, Enter, Yes, then F10$ATTR_NORMAL"
+  read -r -p "(press Enter to start MC) "
+  before=$(sectors_written)
+  start=$(date +%s.%N)
+  XDG_CONFIG_HOME=$conf "$MC" -u "$DIR/src" "$DIR/dst"
+  end=$(date +%s.%N)
+  sync
+  after=$(sectors_written)
+
+  echo "${ATTR_BOLD}$(echo "$end - $start" | bc) s$ATTR_NORMAL"
+  [ -n "$before" ] && echo "written: $(( (after - before) / 2048 )) MiB"
+  cmp "$DIR/src/big" "$DIR/dst/big" && echo "the files are identical"
+  rm -rf "$conf"
+}
+
+echo "Creating ${SIZE_MB} MiB file in $DIR/src..."
+mkdir -p "$DIR/src" "$DIR/dst"
+head -c $((SIZE_MB * 1024 * 1024)) /dev/urandom > "$DIR/src/big"
+cp "$DIR/src/big" "$DIR/dst/big.orig"
+change
+
+run 0
+run 1
+
+rm -f "$DIR/dst/big.orig"
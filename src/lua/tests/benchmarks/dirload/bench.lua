@@ -0,0 +1,19 @@
+--[[
+
+Benchmarks the loading of the panel's directory.
+
+See the README.
+
+]]
+
+local times = 5
+
+ui.Panel.bind('C-x b', function(pnl)
+  local start = timer.now()
+  for _ = 1, times do
+    pnl:reload()
+  end
+  local elapsed = timer.now() - start
+  alert(('%d files: %d ms per reload (average of %d)'):format(
+    pnl:_get_max_index(), math.floor(elapsed / times), times))
+end)
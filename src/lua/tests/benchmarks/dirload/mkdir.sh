@@ -0,0 +1,25 @@
+#!/bin/bash
+
+#
+# Creates a directory with many files for the benchmark.
+#
+# Usage: mkdir.sh DIR [COUNT]
+#
+
+DIR=${1:?You must specify a directory to create}
+COUNT=${2:-50000}
+
+mkdir -p "$DIR" || exit 1
+cd "$DIR" || exit 1
+
+for ((i = 0; i < COUNT; i++)); do
+  echo "$i" > "file$i"
+  # A few symlinks and subdirectories, as they need extra stat calls.
+  if (( i % 100 == 0 )); then
+    mkdir -p "dir$i"
+    ln -sf "file$i" "link$i"
+    ln -sf "dir$i" "dirlink$i"
+  fi
+done
+
+echo "$(ls -f | wc -l) entries in $DIR"
@@ -0,0 +1,69 @@
+#!/bin/bash
+
+#
+# Benchmarks the computing of sizes of a big local tree. See the README.
+#
+# Usage: run.sh DIR [FILES]
+#
+
+ATTR_BOLD=$'\x1b[1m'
+ATTR_REVERSE=$'\x1b[7m'
+ATTR_NORMAL=$'\x1b[0m'
+
+DIR=${1:?You must specify a directory}
+FILES=${2:-200000}
+
+MC=${MC:-mc}
+
+# Files per directory and subdirectories per directory.
+PER_DIR=50
+FANOUT=8
+
+function make_tree {
+  local dir=$1 left=$2 i
+
+  mkdir -p "$dir"
+  for ((i = 0; i < PER_DIR && left > 0; i++, left--)); do
+    head -c $((RANDOM % 8192)) /dev/zero > "$dir/file$i"
+  done
+  for ((i = 0; i < FANOUT && left > 0; i++)); do
+    make_tree "$dir/dir$i" $(((left + FANOUT - 1 - i) / FANOUT))
+  done
+}
+
+function drop_caches {
+  sync
+  if [ -w /proc/sys/vm/drop_caches ]; then
+    echo 3 > /proc/sys/vm/drop_caches
+  fi
+}
+
+function run {
+  local start end
+
+  drop_caches
+  echo
+  echo "${ATTR_REVERSE}$1: press C-Space on 'tree', then F10$ATTR_NORMAL"
+  read -r -p "(press Enter to start MC) "
+  start=$(date +%s.%N)
+  "$1" -u "$DIR" "$DIR"
+  end=$(date +%s.%N)
+  # the time of pressing the keys is included
+  echo "${ATTR_BOLD}$(echo "$end - $start" | bc) s$ATTR_NORMAL"
+}
+
+if [ ! -d "$DIR/tree" ]; then
+  echo "Creating $FILES files in $DIR/tree..."
+  make_tree "$DIR/tree" "$FILES"
+fi
+
+run "$MC"
+[ -n "$MC_OLD" ] && run "$MC_OLD"
+
+drop_caches
+echo
+echo "${ATTR_REVERSE}du -s$ATTR_NORMAL"
+start=$(date +%s.%N)
+du -s "$DIR/tree"
+end=$(date +%s.%N)
+echo "${ATTR_BOLD}$(echo "$end - $start" | bc) s$ATTR_NORMAL"
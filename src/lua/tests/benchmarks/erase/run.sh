@@ -0,0 +1,75 @@
+#!/bin/bash
+
+#
+# Benchmarks the erasing of a deep local tree. See the README.
+#
+# Usage: run.sh DIR [FILES]
+#
+
+ATTR_BOLD=$'\x1b[1m'
+ATTR_REVERSE=$'\x1b[7m'
+ATTR_NORMAL=$'\x1b[0m'
+
+DIR=${1:?You must specify a directory}
+FILES=${2:-100000}
+
+MC=${MC:-mc}
+
+# Files per directory and directories per level, like in node_modules.
+PER_DIR=20
+FANOUT=5
+
+function make_tree {
+  local dir=$1 left=$2 i
+
+  mkdir -p "$dir"
+  for ((i = 0; i < PER_DIR && left > 0; i++, left--)); do
+    : > "$dir/file$i.js"
+  done
+  for ((i = 0; i < FANOUT && left > 0; i++)); do
+    make_tree "$dir/node_modules/pkg$i" $(((left + FANOUT - 1 - i) / FANOUT))
+  done
+}
+
+function count {
+  find "$DIR/tree" 2>/dev/null | wc -l
+}
+
+function report {
+  local start=$1 end=$2 n=$3
+  echo "$ATTR_BOLD$n entries in $(echo "$end - $start" | bc) s:" \
+    "$(echo "$n / ($end - $start)" | bc) entries/s$ATTR_NORMAL"
+}
+
+function setup {
+  make_tree "$DIR/tree" "$FILES"
+  sync
+}
+
+function run {
+  local name=$1 n start end
+
+  setup
+  n=$(count)
+  echo
+  echo "${ATTR_REVERSE}$name: press F8, Enter, All, then F10$ATTR_NORMAL"
+  read -r -p "(press Enter to start MC) "
+  start=$(date +%s.%N)
+  "$2" -u "$DIR" "$DIR"
+  end=$(date +%s.%N)
+  # the time of pressing the keys is included
+  [ -e "$DIR/tree" ] && echo "The tree was not erased" && return
+  report "$start" "$end" "$n"
+}
+
+run "$MC" "$MC"
+[ -n "$MC_OLD" ] && run "$MC_OLD" "$MC_OLD"
+
+setup
+n=$(count)
+echo
+echo "${ATTR_REVERSE}rm -rf$ATTR_NORMAL"
+start=$(date +%s.%N)
+rm -rf "$DIR/tree"
+end=$(date +%s.%N)
+report "$start" "$end" "$n"
@@ -0,0 +1,27 @@
+#!/bin/bash
+
+#
+# Creates a tree like the one of rsnapshot: SNAPSHOTS directories with the
+# same FILES files, all but the first one made of hard links.
+#
+# Usage: mktree.sh DIR FILES [SNAPSHOTS]
+#
+
+DIR=${1:?You must specify a directory}
+FILES=${2:?You must specify the number of files}
+SNAPSHOTS=${3:-4}
+
+# Files per directory of a snapshot.
+PER_DIR=1000
+
+mkdir -p "$DIR/daily.0" || exit 1
+
+for ((i = 0; i < FILES; i++)); do
+  d="$DIR/daily.0/d$((i / PER_DIR))"
+  ((i % PER_DIR == 0)) && mkdir -p "$d"
+  echo "$i" > "$d/f$i"
+done
+
+for ((s = 1; s < SNAPSHOTS; s++)); do
+  cp -al "$DIR/daily.0" "$DIR/daily.$s" || exit 1
+done
@@ -0,0 +1,42 @@
+#!/bin/bash
+
+#
+# Benchmarks the copying of trees with hard links. See the README.
+#
+# Usage: run.sh DIR [FILES...]
+#
+
+ATTR_BOLD=$'\x1b[1m'
+ATTR_REVERSE=$'\x1b[7m'
+ATTR_NORMAL=$'\x1b[0m'
+
+DIR=${1:?You must specify a directory}
+shift
+SIZES=${*:-25000 50000 100000 200000}
+
+MC=${MC:-mc}
+SNAPSHOTS=4
+
+cd "$(dirname "$0")" || exit 1
+
+for files in $SIZES; do
+  rm -rf "$DIR/src" "$DIR/dst"
+  ./mktree.sh "$DIR/src" "$files" $SNAPSHOTS || exit 1
+  mkdir "$DIR/dst"
+  sync
+
+  links=$((files * SNAPSHOTS))
+  echo
+  echo "${ATTR_REVERSE}$links links of $files files: press F5 on 'src', Enter, then F10$ATTR_NORMAL"
+  read -r -p "(press Enter to start MC) "
+  start=$(date +%s.%N)
+  "$MC" -u "$DIR" "$DIR/dst"
+  end=$(date +%s.%N)
+
+  # the copy must keep the links
+  inodes=$(find "$DIR/dst" -type f -printf '%i\n' | sort -u | wc -l)
+  echo "$ATTR_BOLD$links links in $(echo "$end - $start" | bc) s:" \
+    "$(echo "$links / ($end - $start)" | bc) links/s, $inodes inodes$ATTR_NORMAL"
+done
+
+rm -rf "$DIR/src" "$DIR/dst"
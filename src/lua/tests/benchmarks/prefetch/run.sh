@@ -0,0 +1,60 @@
+#!/bin/bash
+
+#
+# Benchmarks copying of many files with and without read-ahead. See the README.
+#
+# Usage: run.sh SRC_DIR DST_DIR [FILES] [SIZE_KB]
+#
+
+ATTR_BOLD=$'\x1b[1m'
+ATTR_REVERSE=$'\x1b[7m'
+ATTR_NORMAL=$'\x1b[0m'
+
+SRC_DIR=${1:?You must specify the source directory}
+DST_DIR=${2:?You must specify the destination directory}
+FILES=${3:-2000}
+SIZE_KB=${4:-1024}
+
+MC=${MC:-mc}
+
+function drop_caches {
+  sync
+  if [ -w /proc/sys/vm/drop_caches ]; then
+    echo 3 > /proc/sys/vm/drop_caches
+  else
+    echo "(not root: the page cache isn't dropped)"
+  fi
+}
+
+function run {
+  local size=$1 conf start end
+
+  rm -rf "$DST_DIR/tree"
+  conf=$(mktemp -d)
+  mkdir "$conf/mc"
+  printf '[Midnight-Commander]\ncopy_prefetch_size=%d\n' "$size" > "$conf/mc/ini"
+  drop_caches
+
+  echo
+  echo "${ATTR_REVERSE}copy_prefetch_size=$size: press F5, Enter, then F10$ATTR_NORMAL"
+  read -r -p "(press Enter to start MC) "
+  start=$(date +%s.%N)
+  XDG_CONFIG_HOME=$conf "$MC" -u "$SRC_DIR" "$DST_DIR"
+  end=$(date +%s.%N)
+
+  echo "${ATTR_BOLD}$(echo "$end - $start" | bc) s$ATTR_NORMAL"
+  diff -r "$SRC_DIR/tree" "$DST_DIR/tree" > /dev/null && echo "the trees are identical"
+  rm -rf "$conf"
+}
+
+echo "Creating $FILES files in $SRC_DIR/tree..."
+for ((i = 0; i < FILES; i++)); do
+  dir="$SRC_DIR/tree/d$((i / 100))"
+  mkdir -p "$dir"
+  head -c $(( (RANDOM * 32768 + RANDOM) % (SIZE_KB * 1024) + 1 )) /dev/urandom > "$dir/f$i"
+done
+
+run 0
+run 64
+
+rm -rf "$DST_DIR/tree"
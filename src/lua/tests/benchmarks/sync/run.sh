@@ -0,0 +1,68 @@
+#!/bin/bash
+
+#
+# Benchmarks the sync copy of a big tree. See the README.
+#
+# Usage: run.sh DIR [FILES]
+#
+
+ATTR_BOLD=$'\x1b[1m'
+ATTR_REVERSE=$'\x1b[7m'
+ATTR_NORMAL=$'\x1b[0m'
+
+DIR=${1:?You must specify a directory}
+FILES=${2:-50000}
+
+MC=${MC:-mc}
+
+PER_DIR=100
+
+function setup {
+  local i
+
+  rm -rf "$DIR/src" "$DIR/dst"
+  mkdir -p "$DIR/src"
+  for ((i = 0; i < FILES; i++)); do
+    ((i % PER_DIR == 0)) && mkdir -p "$DIR/src/d$((i / PER_DIR))"
+    head -c $((RANDOM % 16384)) /dev/urandom > "$DIR/src/d$((i / PER_DIR))/f$i"
+  done
+  mkdir -p "$DIR/dst"
+  cp -a "$DIR/src" "$DIR/dst/"
+}
+
+function change {
+  local i
+
+  # one file of a hundred, with another size
+  for ((i = 0; i < FILES; i += 100)); do
+    echo changed >> "$DIR/src/d$((i / PER_DIR))/f$i"
+  done
+  sync
+}
+
+function report {
+  echo "${ATTR_BOLD}$(echo "$2 - $1" | bc) s$ATTR_NORMAL"
+}
+
+echo "Creating $FILES files in $DIR/src..."
+setup
+change
+
+echo
+echo "${ATTR_REVERSE}$MC: press F5 on 'src', check 'Skip unchanged files', Enter, then F10$ATTR_NORMAL"
+echo "(the other panel shows $DIR/dst, which has an older copy of 'src')"
+read -r -p "(press Enter to start MC) "
+start=$(date +%s.%N)
+"$MC" -u "$DIR" "$DIR/dst"
+end=$(date +%s.%N)
+report "$start" "$end"
+
+if command -v rsync > /dev/null; then
+  change
+  echo
+  echo "${ATTR_REVERSE}rsync -a$ATTR_NORMAL"
+  start=$(date +%s.%N)
+  rsync -a "$DIR/src/" "$DIR/dst/src/"
+  end=$(date +%s.%N)
+  report "$start" "$end"
+fi
@@ -64,6 +64,8 @@
 #include "filemanager/ext.h"    /* flush_extension_file() */
 #include "filemanager/command.h"        /* cmdline */
 #include "filemanager/panel.h"  /* panalized_panel */
+#include "filemanager/iotune.h" /* io_tune_bench() */
+#include "filemanager/dirsize.h"        /* dir_size_cache_save() */
 
 #include "vfs/plugins_init.h"
 
@@ -299,6 +301,16 @@ main (int argc, char *argv[])
 
     load_setup ();
 
+    /* the result is saved to the config file, so it must be loaded */
+    if (mc_args__bench_io_dir != NULL)
+    {
+        exit_code = io_tune_bench (mc_args__bench_io_dir) ? EXIT_SUCCESS : EXIT_FAILURE;
+        vfs_shut ();
+        done_setup ();
+        mc_event_deinit (NULL);
+        goto startup_exit_ok;
+    }
+
     /* Must be done after load_setup because depends on mc_global.vfs.cd_symlinks */
     vfs_setup_work_dir ();
 
@@ -471,6 +483,7 @@ main (int argc, char *argv[])
 
     /* Save the tree store */
     (void) tree_store_save ();
+    dir_size_cache_save ();
 
     free_keymap_defs ();
 
@@ -134,6 +134,8 @@ panels_options_t panels_options = {
     .show_dot_files = TRUE,
     .fast_reload = FALSE,
     .fast_reload_msg_shown = FALSE,
+    .auto_refresh = TRUE,
+    .lazy_link_resolution = TRUE,
     .mark_moves_down = TRUE,
     .reverse_files_only = TRUE,
     .auto_save_setup = FALSE,
@@ -175,6 +177,49 @@ int verbose = 1;
  * at the expense of some speed
  */
 int file_op_compute_totals = 1;
+/* Compute totals of local files while the operation goes on, instead of before it */
+int file_op_background_totals = 0;
+
+/* Compare contents of files of the same size but other modification time in sync mode */
+int sync_compare_content = 0;
+
+/* Write digests of files verified by copy or move operations to a manifest */
+int verify_manifest = 0;
+
+/* Number of threads used to stat entries of big local directories. 1 disables threading */
+int dir_stat_threads = 4;
+
+/* Show space allocated for files instead of their sizes in sizes of local directories */
+int dir_size_disk_usage = 0;
+
+/* Memory for listings of recently visited directories, in kilobytes. 0 disables the cache */
+int dir_cache_size = 16384;
+
+/* The fastest way to copy data of local files (vfs_copy_method_t): 0 copies through a buffer,
+   1 allows sendfile(), 2 allows copy_file_range(), 3 allows sharing data (reflink) */
+int copy_method = VFS_COPY_CLONE;
+
+/* Number of small files copied at once when trees are copied. 1 disables parallel copying */
+int copy_threads = 1;
+
+/* Number of buffers and their size, in kilobytes, for overlapped reading and writing of
+   big files copied to other device. Depth less than 2 disables overlapping */
+int copy_queue_depth = 4;
+int copy_buffer_size = 1024;
+
+/* Minimal size, in megabytes, of local files overwritten in place with changed blocks only.
+   0 disables it */
+int copy_delta_min_size = 0;
+
+/* Record copied files to resume copying or moving to local files if it's interrupted */
+int copy_journal = 0;
+
+/* The largest amount of data, in megabytes, of local files read ahead of copying when many
+   files are copied. 0 disables read-ahead */
+int copy_prefetch_size = 64;
+
+/* Size of the buffer for copying, in kilobytes. 0 chooses it for the devices of files */
+int io_block_size = 0;
 
 /* If true use the internal viewer */
 int use_internal_view = 1;
@@ -318,6 +363,20 @@ static const struct
     { "xtree_mode", &xtree_mode },
     { "num_history_items_recorded", &num_history_items_recorded },
     { "file_op_compute_totals", &file_op_compute_totals },
+    { "file_op_background_totals", &file_op_background_totals },
+    { "sync_compare_content", &sync_compare_content },
+    { "verify_manifest", &verify_manifest },
+    { "dir_stat_threads", &dir_stat_threads },
+    { "dir_size_disk_usage", &dir_size_disk_usage },
+    { "dir_cache_size", &dir_cache_size },
+    { "copy_method", &copy_method },
+    { "copy_threads", &copy_threads },
+    { "copy_queue_depth", &copy_queue_depth },
+    { "copy_buffer_size", &copy_buffer_size },
+    { "copy_delta_min_size", &copy_delta_min_size },
+    { "copy_journal", &copy_journal },
+    { "copy_prefetch_size", &copy_prefetch_size },
+    { "io_block_size", &io_block_size },
     { "classic_progressbar", &classic_progressbar},
 #ifdef ENABLE_VFS
     { "vfs_timeout", &vfs_timeout },
@@ -397,6 +456,8 @@ static const struct
     { "show_dot_files", &panels_options.show_dot_files },
     { "fast_reload", &panels_options.fast_reload },
     { "fast_reload_msg_shown", &panels_options.fast_reload_msg_shown },
+    { "auto_refresh", &panels_options.auto_refresh },
+    { "lazy_link_resolution", &panels_options.lazy_link_resolution },
     { "mark_moves_down", &panels_options.mark_moves_down },
     { "reverse_files_only", &panels_options.reverse_files_only },
     { "auto_save_setup_panels", &panels_options.auto_save_setup },
@@ -42,6 +42,8 @@ typedef struct
     gboolean show_dot_files;    /* If TRUE, show files starting with a dot */
     gboolean fast_reload;       /* If TRUE then use stat() on the cwd to determine directory changes */
     gboolean fast_reload_msg_shown;     /* Have we shown the fast-reload warning in the past? */
+    gboolean auto_refresh;      /* If TRUE, local directories are watched for changes */
+    gboolean lazy_link_resolution;      /* If TRUE, targets of symlinks are stat'ed in background */
     gboolean mark_moves_down;   /* If TRUE, marking a files moves the cursor down */
     gboolean reverse_files_only;        /* If TRUE, only selection of files is inverted */
     gboolean auto_save_setup;
@@ -97,6 +99,20 @@ extern int auto_fill_mkdir_name;
 extern int output_starts_shell;
 extern int use_file_to_check_type;
 extern int file_op_compute_totals;
+extern int file_op_background_totals;
+extern int sync_compare_content;
+extern int verify_manifest;
+extern int dir_stat_threads;
+extern int dir_size_disk_usage;
+extern int dir_cache_size;
+extern int copy_method;
+extern int copy_threads;
+extern int copy_queue_depth;
+extern int copy_buffer_size;
+extern int copy_delta_min_size;
+extern int copy_journal;
+extern int copy_prefetch_size;
+extern int io_block_size;
 extern int editor_ask_filename_before_edit;
 
 extern panels_options_t panels_options;
@@ -1105,6 +1105,28 @@ extfs_stat_move (struct stat *buf, const struct inode *inode)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static int
+extfs_readdir_batch (void *data, vfs_dirent_batch_t * batch)
+{
+    struct entry **info = (struct entry **) data;
+    int count;
+
+    for (count = 0; count < VFS_DIRENT_BATCH_SIZE && *info != NULL; count++)
+    {
+        struct stat st;
+
+        memset (&st, 0, sizeof (st));
+        extfs_stat_move (&st, (*info)->inode);
+        vfs_dirent_batch_add_stat (batch, (*info)->name, strlen ((*info)->name), &st);
+
+        *info = (*info)->next_in_dir;
+    }
+
+    return count;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static int
 extfs_internal_stat (const vfs_path_t * vpath, struct stat *buf, gboolean resolve)
 {
@@ -1732,6 +1754,7 @@ init_extfs (void)
     vfs_extfs_ops.write = extfs_write;
     vfs_extfs_ops.opendir = extfs_opendir;
     vfs_extfs_ops.readdir = extfs_readdir;
+    vfs_extfs_ops.readdir_batch = extfs_readdir_batch;
     vfs_extfs_ops.closedir = extfs_closedir;
     vfs_extfs_ops.stat = extfs_stat;
     vfs_extfs_ops.lstat = extfs_lstat;
@@ -31,6 +31,9 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
 
 #include "lib/global.h"
 
@@ -42,8 +45,26 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+#if defined (SYS_getdents64) && defined (__linux__)
+#define LOCAL_GETDENTS64 1
+/* Size of the buffer for getdents64(). glibc's readdir() uses the same */
+#define LOCAL_GETDENTS_BUFSIZE (32 * 1024)
+#endif
+
 /*** file scope type declarations ****************************************************************/
 
+#ifdef LOCAL_GETDENTS64
+/* Record returned by getdents64() (there is no declaration of it in the libc headers) */
+struct local_dirent64
+{
+    guint64 d_ino;
+    gint64 d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+#endif
+
 /*** file scope variables ************************************************************************/
 
 static struct vfs_class vfs_local_ops;
@@ -106,6 +127,47 @@ local_readdir (void *data)
     return readdir (*(DIR **) data);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read entries with a single getdents64() call where available: the block read by the kernel
+ * is returned as is, without the per-entry overhead of readdir().
+ */
+
+static int
+local_readdir_batch (void *data, vfs_dirent_batch_t * batch)
+{
+    DIR *dir = *(DIR **) data;
+    int count = 0;
+#ifdef LOCAL_GETDENTS64
+    /* guint64 to align records */
+    guint64 buf[LOCAL_GETDENTS_BUFSIZE / sizeof (guint64)];
+    long len, pos;
+
+    len = syscall (SYS_getdents64, dirfd (dir), buf, sizeof (buf));
+    if (len == -1)
+        return -1;
+
+    for (pos = 0; pos < len; count++)
+    {
+        const struct local_dirent64 *d = (const struct local_dirent64 *) ((char *) buf + pos);
+
+        vfs_dirent_batch_add (batch, d->d_name, strlen (d->d_name), (ino_t) d->d_ino, d->d_type);
+        pos += d->d_reclen;
+    }
+#else
+    struct dirent *d;
+
+    for (; count < VFS_DIRENT_BATCH_SIZE && (d = readdir (dir)) != NULL; count++)
+#ifdef HAVE_STRUCT_DIRENT_D_TYPE
+        vfs_dirent_batch_add (batch, d->d_name, strlen (d->d_name), d->d_ino, d->d_type);
+#else
+        vfs_dirent_batch_add (batch, d->d_name, strlen (d->d_name), d->d_ino, DT_UNKNOWN);
+#endif
+#endif /* LOCAL_GETDENTS64 */
+
+    return count;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static int
@@ -424,6 +486,7 @@ init_localfs (void)
     vfs_local_ops.write = local_write;
     vfs_local_ops.opendir = local_opendir;
     vfs_local_ops.readdir = local_readdir;
+    vfs_local_ops.readdir_batch = local_readdir_batch;
     vfs_local_ops.closedir = local_closedir;
     vfs_local_ops.stat = local_stat;
     vfs_local_ops.lstat = local_lstat;
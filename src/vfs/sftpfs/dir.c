@@ -152,6 +152,66 @@ sftpfs_readdir (void *data, GError ** mcerror)
     return &sftpfs_dirent;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read a block of directory entries along with their attributes, which the server sends
+ * anyway, so the entries don't need to be stat'ed one by one.
+ *
+ * @param data    directory data handler
+ * @param batch   batch to add entries to
+ * @param mcerror pointer to the error handler
+ * @return number of entries read, 0 at the end of directory, -1 on error
+ */
+
+int
+sftpfs_readdir_batch (void *data, vfs_dirent_batch_t * batch, GError ** mcerror)
+{
+    char mem[BUF_MEDIUM];
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+    sftpfs_dir_data_t *sftpfs_dir = (sftpfs_dir_data_t *) data;
+    int count;
+
+    mc_return_val_if_error (mcerror, -1);
+
+    for (count = 0; count < VFS_DIRENT_BATCH_SIZE; count++)
+    {
+        int rc;
+
+        do
+        {
+            rc = libssh2_sftp_readdir (sftpfs_dir->handle, mem, sizeof (mem), &attrs);
+            if (rc >= 0)
+                break;
+
+            if (rc != LIBSSH2_ERROR_EAGAIN)
+            {
+                sftpfs_ssherror_to_gliberror (sftpfs_dir->super_data, rc, mcerror);
+                return -1;
+            }
+
+            sftpfs_waitsocket (sftpfs_dir->super_data, mcerror);
+            mc_return_val_if_error (mcerror, -1);
+        }
+        while (rc == LIBSSH2_ERROR_EAGAIN);
+
+        if (rc == 0)
+            break;
+
+        if ((attrs.flags & LIBSSH2_SFTP_ATTR_PERMISSIONS) != 0)
+        {
+            struct stat st;
+
+            memset (&st, 0, sizeof (st));
+            sftpfs_attr_to_stat (&attrs, &st);
+            vfs_dirent_batch_add_stat (batch, mem, strlen (mem), &st);
+        }
+        else
+            vfs_dirent_batch_add (batch, mem, strlen (mem), 0, DT_UNKNOWN);
+    }
+
+    return count;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Close the directory stream.
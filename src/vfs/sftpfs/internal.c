@@ -119,6 +119,37 @@ sftpfs_waitsocket (sftpfs_super_data_t * super_data, GError ** mcerror)
     return select (super_data->socket_handle + 1, readfd, writefd, NULL, &timeout);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Fill stat info from SFTP attributes. Fields not provided by the server are left untouched.
+ *
+ * @param attrs   SFTP attributes of file
+ * @param buf     buffer for store stat-info
+ */
+
+void
+sftpfs_attr_to_stat (const LIBSSH2_SFTP_ATTRIBUTES * attrs, struct stat *buf)
+{
+    if ((attrs->flags & LIBSSH2_SFTP_ATTR_UIDGID) != 0)
+    {
+        buf->st_uid = attrs->uid;
+        buf->st_gid = attrs->gid;
+    }
+
+    if ((attrs->flags & LIBSSH2_SFTP_ATTR_ACMODTIME) != 0)
+    {
+        buf->st_atime = attrs->atime;
+        buf->st_mtime = attrs->mtime;
+        buf->st_ctime = attrs->mtime;
+    }
+
+    if ((attrs->flags & LIBSSH2_SFTP_ATTR_SIZE) != 0)
+        buf->st_size = attrs->filesize;
+
+    if ((attrs->flags & LIBSSH2_SFTP_ATTR_PERMISSIONS) != 0)
+        buf->st_mode = attrs->permissions;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Getting information about a symbolic link.
@@ -174,24 +205,7 @@ sftpfs_lstat (const vfs_path_t * vpath, struct stat *buf, GError ** mcerror)
     }
     while (res == LIBSSH2_ERROR_EAGAIN);
 
-    if ((attrs.flags & LIBSSH2_SFTP_ATTR_UIDGID) != 0)
-    {
-        buf->st_uid = attrs.uid;
-        buf->st_gid = attrs.gid;
-    }
-
-    if ((attrs.flags & LIBSSH2_SFTP_ATTR_ACMODTIME) != 0)
-    {
-        buf->st_atime = attrs.atime;
-        buf->st_mtime = attrs.mtime;
-        buf->st_ctime = attrs.mtime;
-    }
-
-    if ((attrs.flags & LIBSSH2_SFTP_ATTR_SIZE) != 0)
-        buf->st_size = attrs.filesize;
-
-    if ((attrs.flags & LIBSSH2_SFTP_ATTR_PERMISSIONS) != 0)
-        buf->st_mode = attrs.permissions;
+    sftpfs_attr_to_stat (&attrs, buf);
 
     return 0;
 }
@@ -71,6 +71,7 @@ void sftpfs_ssherror_to_gliberror (sftpfs_super_data_t * super_data, int libssh_
 int sftpfs_waitsocket (sftpfs_super_data_t * super_data, GError ** mcerror);
 
 const char *sftpfs_fix_filename (const char *file_name);
+void sftpfs_attr_to_stat (const LIBSSH2_SFTP_ATTRIBUTES * attrs, struct stat *buf);
 int sftpfs_lstat (const vfs_path_t * vpath, struct stat *buf, GError ** mcerror);
 int sftpfs_stat (const vfs_path_t * vpath, struct stat *buf, GError ** mcerror);
 int sftpfs_readlink (const vfs_path_t * vpath, char *buf, size_t size, GError ** mcerror);
@@ -86,6 +87,7 @@ void sftpfs_close_connection (struct vfs_s_super *super, const char *shutdown_me
 
 void *sftpfs_opendir (const vfs_path_t * vpath, GError ** mcerror);
 void *sftpfs_readdir (void *data, GError ** mcerror);
+int sftpfs_readdir_batch (void *data, vfs_dirent_batch_t * batch, GError ** mcerror);
 int sftpfs_closedir (void *data, GError ** mcerror);
 int sftpfs_mkdir (const vfs_path_t * vpath, mode_t mode, GError ** mcerror);
 int sftpfs_rmdir (const vfs_path_t * vpath, GError ** mcerror);
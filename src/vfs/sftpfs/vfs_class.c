@@ -220,6 +220,39 @@ sftpfs_cb_readdir (void *data)
     return sftpfs_dirent;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Callback for reading a block of directory entries.
+ *
+ * @param data directory data handler
+ * @param batch batch to add entries to
+ * @return number of entries read, 0 at the end of directory, -1 on error
+ */
+
+static int
+sftpfs_cb_readdir_batch (void *data, vfs_dirent_batch_t * batch)
+{
+    GError *mcerror = NULL;
+    int count;
+
+    if (tty_got_interrupt ())
+    {
+        tty_disable_interrupt_key ();
+        return 0;
+    }
+
+    count = sftpfs_readdir_batch (data, batch, &mcerror);
+    if (!mc_error_message (&mcerror, NULL))
+    {
+        if (count > 0)
+            vfs_print_message (_("sftp: (Ctrl-G break) Listing... %d entries"), count);
+        else
+            vfs_print_message ("%s", _("sftp: Listing done."));
+    }
+
+    return count;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Callback for closing directory.
@@ -696,6 +729,7 @@ sftpfs_init_class_callbacks (void)
 
     sftpfs_class.opendir = sftpfs_cb_opendir;
     sftpfs_class.readdir = sftpfs_cb_readdir;
+    sftpfs_class.readdir_batch = sftpfs_cb_readdir_batch;
     sftpfs_class.closedir = sftpfs_cb_closedir;
     sftpfs_class.mkdir = sftpfs_cb_mkdir;
     sftpfs_class.rmdir = sftpfs_cb_rmdir;
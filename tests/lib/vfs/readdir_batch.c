@@ -0,0 +1,247 @@
+/*
+   lib/vfs - reading of directory entries by blocks
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/lib/vfs"
+
+#include "tests/mctest.h"
+
+#include <stdio.h>
+
+#include "lib/strutil.h"
+#include "lib/vfs/xdirentry.h"
+#include "lib/vfs/path.h"
+
+#include "src/vfs/local/local.c"
+
+/* more than one block of entries */
+#define FILES_COUNT 2000
+
+static char *test_dir = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    int i;
+
+    str_init_strings (NULL);
+
+    vfs_init ();
+    init_localfs ();
+    vfs_setup_work_dir ();
+
+    test_dir = g_build_filename (mc_tmpdir (), "mctest-readdir-XXXXXX", (char *) NULL);
+    if (mkdtemp (test_dir) == NULL)
+        ck_abort_msg ("Cannot create %s", test_dir);
+
+    for (i = 0; i < FILES_COUNT; i++)
+    {
+        char *name;
+        FILE *f;
+
+        name = g_strdup_printf ("%s/file%d", test_dir, i);
+        f = fopen (name, "w");
+        if (f != NULL)
+            fclose (f);
+        g_free (name);
+    }
+
+    {
+        char *name;
+
+        name = g_strdup_printf ("%s/subdir", test_dir);
+        mkdir (name, 0700);
+        g_free (name);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    int i;
+    char *name;
+
+    for (i = 0; i < FILES_COUNT; i++)
+    {
+        name = g_strdup_printf ("%s/file%d", test_dir, i);
+        unlink (name);
+        g_free (name);
+    }
+    name = g_strdup_printf ("%s/subdir", test_dir);
+    rmdir (name);
+    g_free (name);
+    rmdir (test_dir);
+    g_free (test_dir);
+
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_mc_readdir_batch)
+/* *INDENT-ON* */
+{
+    /* given */
+    vfs_path_t *vpath;
+    DIR *dirp;
+    vfs_dirent_batch_t *batch;
+    GHashTable *names;
+    int n;
+    int calls = 0;
+
+    vpath = vfs_path_from_str (test_dir);
+    batch = vfs_dirent_batch_new ();
+    names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    /* when */
+    dirp = mc_opendir (vpath);
+    mctest_assert_ptr_ne (dirp, NULL);
+
+    while ((n = mc_readdir_batch (dirp, batch)) > 0)
+    {
+        guint i;
+
+        calls++;
+        mctest_assert_int_eq (vfs_dirent_batch_len (batch), n);
+
+        for (i = 0; i < vfs_dirent_batch_len (batch); i++)
+        {
+            const vfs_dirent_t *d = vfs_dirent_batch_get (batch, i);
+
+            mctest_assert_int_eq (strlen (d->d_name), d->d_namlen);
+
+            if (strcmp (d->d_name, "subdir") == 0)
+                fail_unless (d->d_type == DT_DIR || d->d_type == DT_UNKNOWN);
+            else if (strncmp (d->d_name, "file", 4) == 0)
+                fail_unless (d->d_type == DT_REG || d->d_type == DT_UNKNOWN);
+
+            fail_unless (g_hash_table_lookup (names, d->d_name) == NULL,
+                         "\nentry %s is returned twice\n", d->d_name);
+            g_hash_table_insert (names, g_strdup (d->d_name), GINT_TO_POINTER (1));
+        }
+    }
+    mc_closedir (dirp);
+
+    /* then */
+    mctest_assert_int_eq (n, 0);
+    fail_unless (calls > 1, "\nall entries are returned in one block\n");
+    /* files, "subdir", "." and ".." */
+    mctest_assert_int_eq (g_hash_table_size (names), FILES_COUNT + 3);
+    fail_unless (g_hash_table_lookup (names, "file0") != NULL);
+    fail_unless (g_hash_table_lookup (names, "file1999") != NULL);
+    fail_unless (g_hash_table_lookup (names, "subdir") != NULL);
+
+    g_hash_table_destroy (names);
+    vfs_dirent_batch_free (batch);
+    vfs_path_free (vpath);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_vfs_dirent_batch_add_stat)
+/* *INDENT-ON* */
+{
+    /* given */
+    vfs_dirent_batch_t *batch;
+    struct stat st;
+    const vfs_dirent_t *d;
+
+    batch = vfs_dirent_batch_new ();
+    memset (&st, 0, sizeof (st));
+
+    /* when */
+    st.st_mode = S_IFDIR | 0755;
+    st.st_ino = 42;
+    vfs_dirent_batch_add_stat (batch, "dir", 3, &st);
+    st.st_mode = S_IFLNK | 0777;
+    st.st_size = 1234;
+    vfs_dirent_batch_add_stat (batch, "link", 4, &st);
+    vfs_dirent_batch_add (batch, "unknown", 7, 0, DT_UNKNOWN);
+    vfs_dirent_batch_finish (batch);
+
+    /* then */
+    mctest_assert_int_eq (vfs_dirent_batch_len (batch), 3);
+
+    d = vfs_dirent_batch_get (batch, 0);
+    mctest_assert_str_eq (d->d_name, "dir");
+    mctest_assert_int_eq (d->d_type, DT_DIR);
+    mctest_assert_int_eq (d->d_ino, 42);
+    fail_unless (d->d_has_stat);
+
+    d = vfs_dirent_batch_get (batch, 1);
+    mctest_assert_str_eq (d->d_name, "link");
+    mctest_assert_int_eq (d->d_type, DT_LNK);
+    mctest_assert_int_eq (d->d_stat.st_size, 1234);
+    fail_unless (d->d_has_stat);
+
+    d = vfs_dirent_batch_get (batch, 2);
+    mctest_assert_str_eq (d->d_name, "unknown");
+    mctest_assert_int_eq (d->d_type, DT_UNKNOWN);
+    fail_unless (!d->d_has_stat);
+
+    vfs_dirent_batch_free (batch);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_mc_readdir_batch);
+    tcase_add_test (tc_core, test_vfs_dirent_batch_add_stat);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "readdir_batch.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,170 @@
+/*
+   lib/vfs - test vfs_file_get_local_path() functionality
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/lib/vfs"
+
+#include "tests/mctest.h"
+
+#ifdef HAVE_CHARSET
+#include "lib/charsets.h"
+#endif
+
+#include "lib/strutil.h"
+#include "lib/vfs/xdirentry.h"
+#include "lib/vfs/vfs.h"
+
+#include "src/vfs/local/local.c"
+
+struct vfs_s_subclass test_subclass1;
+struct vfs_class vfs_test_ops1;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+
+    vfs_init ();
+    init_localfs ();
+    vfs_setup_work_dir ();
+
+    test_subclass1.flags = VFS_S_REMOTE;
+    vfs_s_init_class (&vfs_test_ops1, &test_subclass1);
+    vfs_test_ops1.name = "testfs1";
+    vfs_test_ops1.prefix = "test1";
+    vfs_register_class (&vfs_test_ops1);
+
+#ifdef HAVE_CHARSET
+    mc_global.sysconfig_dir = (char *) TEST_SHARE_DIR;
+    load_codepages_list ();
+#endif /* HAVE_CHARSET */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+#ifdef HAVE_CHARSET
+    free_codepages_list ();
+#endif /* HAVE_CHARSET */
+
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_vfs_file_get_local_path_ds") */
+/* *INDENT-OFF* */
+static const struct test_vfs_file_get_local_path_ds
+{
+    const char *input_path;
+    const char *expected_result;
+} test_vfs_file_get_local_path_ds[] =
+{
+    { /* 0. plain local path */
+        "/usr/share/mc",
+        "/usr/share/mc"
+    },
+    { /* 1. root directory */
+        "/",
+        "/"
+    },
+    { /* 2. the file is on other VFS */
+        "test1://some/path",
+        NULL
+    },
+    { /* 3. the local file is opened by other VFS */
+        "/some/file.tar/test1://path",
+        NULL
+    },
+#ifdef HAVE_CHARSET
+    { /* 4. names are recoded */
+        "/#enc:KOI8-R/some/path",
+        NULL
+    },
+#endif
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_vfs_file_get_local_path_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_vfs_file_get_local_path, test_vfs_file_get_local_path_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    vfs_path_t *vpath;
+    const char *actual_result;
+
+    vpath = vfs_path_from_str (data->input_path);
+
+    /* when */
+    actual_result = vfs_file_get_local_path (vpath);
+
+    /* then */
+    if (data->expected_result == NULL)
+    {
+        mctest_assert_null (actual_result);
+    }
+    else
+    {
+        mctest_assert_str_eq (actual_result, data->expected_result);
+    }
+
+    vfs_path_free (vpath);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_vfs_file_get_local_path,
+                                   test_vfs_file_get_local_path_ds);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "vfs_file_get_local_path.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
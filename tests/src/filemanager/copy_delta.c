@@ -0,0 +1,237 @@
+/*
+   src/filemanager - tests for updating of a file in place with changed blocks only
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include <fcntl.h>
+
+#include "src/filemanager/copydelta.c"
+
+/* not a multiple of the block: it's rounded down */
+#define TEST_BUFSIZE (3 * COPY_DELTA_BLOCK_SIZE + 100)
+#define TEST_SIZE (64 * COPY_DELTA_BLOCK_SIZE + 1234)
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+make_data (size_t size, guint32 seed)
+{
+    GRand *rand;
+    char *data;
+    size_t i;
+
+    rand = g_rand_new_with_seed (seed);
+    data = g_malloc (size);
+    for (i = 0; i < size; i++)
+        data[i] = (char) g_rand_int (rand);
+    g_rand_free (rand);
+
+    return data;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+open_file (const char *data, size_t size, char **path)
+{
+    int fd;
+
+    fd = g_file_open_tmp ("mc-test-delta-XXXXXX", path, NULL);
+    mctest_assert_int_ne (fd, -1);
+    mctest_assert_int_eq (write (fd, data, size), (ssize_t) size);
+
+    return fd;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Update the target with the source and check that the target equals the source then */
+
+static off_t
+run_delta (const char *src_data, size_t src_size, const char *dst_data, size_t dst_size)
+{
+    char *src_path, *dst_path;
+    int src_fd, dst_fd;
+    copy_delta_t *delta;
+    ssize_t n;
+    off_t total = 0, written;
+    char *result;
+    gsize result_size;
+
+    src_fd = open_file (src_data, src_size, &src_path);
+    dst_fd = open_file (dst_data, dst_size, &dst_path);
+
+    delta = copy_delta_new (src_fd, dst_fd, TEST_BUFSIZE);
+    while ((n = copy_delta_step (delta, TEST_BUFSIZE)) > 0)
+        total += n;
+    mctest_assert_int_eq (n, 0);
+    mctest_assert_true (copy_delta_finish (delta));
+    written = copy_delta_written (delta);
+    copy_delta_free (delta);
+
+    close (src_fd);
+    close (dst_fd);
+
+    mctest_assert_int_eq (total, src_size);
+    mctest_assert_true (g_file_get_contents (dst_path, &result, &result_size, NULL));
+    mctest_assert_int_eq (result_size, src_size);
+    mctest_assert_true (memcmp (result, src_data, src_size) == 0);
+
+    g_free (result);
+    unlink (src_path);
+    unlink (dst_path);
+    g_free (src_path);
+    g_free (dst_path);
+
+    return written;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_copy_delta_changed_blocks)
+/* *INDENT-ON* */
+{
+    /* given */
+    char *src, *dst;
+    off_t written;
+
+    src = make_data (TEST_SIZE, 1);
+    dst = g_memdup (src, TEST_SIZE);
+    /* one byte of the first block, two adjacent blocks of two parts and the last byte */
+    dst[10] ^= 1;
+    dst[3 * COPY_DELTA_BLOCK_SIZE - 1] ^= 1;
+    dst[3 * COPY_DELTA_BLOCK_SIZE + 1] ^= 1;
+    dst[TEST_SIZE - 1] ^= 1;
+
+    /* when */
+    written = run_delta (src, TEST_SIZE, dst, TEST_SIZE);
+
+    /* then */
+    mctest_assert_int_eq (written, 3 * COPY_DELTA_BLOCK_SIZE + (TEST_SIZE % COPY_DELTA_BLOCK_SIZE));
+
+    g_free (dst);
+    g_free (src);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_copy_delta_same)
+/* *INDENT-ON* */
+{
+    /* given */
+    char *src;
+    off_t written;
+
+    src = make_data (TEST_SIZE, 2);
+
+    /* when */
+    written = run_delta (src, TEST_SIZE, src, TEST_SIZE);
+
+    /* then */
+    mctest_assert_int_eq (written, 0);
+
+    g_free (src);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_copy_delta_other_size)
+/* *INDENT-ON* */
+{
+    /* given */
+    char *src, *dst;
+    off_t written;
+
+    src = make_data (TEST_SIZE, 3);
+    dst = g_malloc (TEST_SIZE * 2);
+    memcpy (dst, src, TEST_SIZE);
+    memcpy (dst + TEST_SIZE, src, TEST_SIZE);
+
+    /* when */
+    /* the longer target is cut off */
+    written = run_delta (src, TEST_SIZE, dst, TEST_SIZE * 2);
+
+    /* then */
+    mctest_assert_int_eq (written, 0);
+
+    /* when */
+    /* the shorter target is extended, its last partial block is rewritten */
+    written = run_delta (src, TEST_SIZE, dst, TEST_SIZE / 2);
+
+    /* then */
+    mctest_assert_int_eq (written, TEST_SIZE
+                          - (TEST_SIZE / 2) / COPY_DELTA_BLOCK_SIZE * COPY_DELTA_BLOCK_SIZE);
+
+    /* when */
+    /* the empty source empties the target */
+    written = run_delta (src, 0, dst, TEST_SIZE);
+
+    /* then */
+    mctest_assert_int_eq (written, 0);
+
+    g_free (dst);
+    g_free (src);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_copy_delta_changed_blocks);
+    tcase_add_test (tc_core, test_copy_delta_same);
+    tcase_add_test (tc_core, test_copy_delta_other_size);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "copy_delta.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,143 @@
+/*
+   src/filemanager - tests for hashing of copied data
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include "src/filemanager/copyhash.c"
+
+#define TEST_SIZE 1000
+
+/* --------------------------------------------------------------------------------------------- */
+
+static guint64
+hash_data (const char *data, size_t len)
+{
+    copy_hash_t *hash;
+    guint64 digest;
+
+    hash = copy_hash_new ();
+    copy_hash_update (hash, data, len);
+    digest = copy_hash_digest (hash);
+    copy_hash_free (hash);
+
+    return digest;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_copy_hash_digest_ds") */
+/* *INDENT-OFF* */
+static const struct test_copy_hash_digest_ds
+{
+    const char *input;
+    guint64 expected;
+} test_copy_hash_digest_ds[] =
+{
+    { "", G_GUINT64_CONSTANT (0xef46db3751d8e999) },
+    { "a", G_GUINT64_CONSTANT (0xd24ec4f1a98c6e5b) },
+    { "abc", G_GUINT64_CONSTANT (0x44bc2cf5ad770999) },
+    /* longer than a stripe */
+    { "The quick brown fox jumps over the lazy dog", G_GUINT64_CONSTANT (0x0b242d361fda71bc) }
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_copy_hash_digest_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_copy_hash_digest, test_copy_hash_digest_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    guint64 actual;
+
+    /* when */
+    actual = hash_data (data->input, strlen (data->input));
+
+    /* then */
+    mctest_assert_true (actual == data->expected);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_copy_hash_parts)
+/* *INDENT-ON* */
+{
+    /* given */
+    char data[TEST_SIZE];
+    guint64 expected;
+    size_t part, i;
+
+    for (i = 0; i < TEST_SIZE; i++)
+        data[i] = (char) (i * 7);
+    expected = hash_data (data, TEST_SIZE);
+
+    for (part = 1; part < 100; part += 7)
+    {
+        copy_hash_t *hash;
+
+        /* when */
+        hash = copy_hash_new ();
+        for (i = 0; i < TEST_SIZE; i += part)
+            copy_hash_update (hash, data + i, MIN (part, TEST_SIZE - i));
+
+        /* then */
+        mctest_assert_true (copy_hash_digest (hash) == expected);
+
+        copy_hash_free (hash);
+    }
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_copy_hash_digest, test_copy_hash_digest_ds);
+    tcase_add_test (tc_core, test_copy_hash_parts);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "copy_hash.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
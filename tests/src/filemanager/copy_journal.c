@@ -0,0 +1,282 @@
+/*
+   src/filemanager - tests for the journal of copied files
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include <unistd.h>
+
+#include "src/filemanager/copyjournal.c"
+
+/* targets don't exist: syncing of them is skipped */
+#define TEST_PATH_ESCAPED "dir/with space\n\"quoted\"\\back"
+#define TEST_PATH_DONE "dir/done\tfile"
+
+static char *test_dir = NULL;
+static char *test_name = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+make_stat (struct stat *st, off_t size, time_t mtime)
+{
+    memset (st, 0, sizeof (*st));
+    st->st_mode = S_IFREG | 0644;
+    st->st_size = size;
+    st->st_mtime = mtime;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    test_dir = g_build_filename (mc_tmpdir (), "mctest-copy-journal-XXXXXX", (char *) NULL);
+    if (mkdtemp (test_dir) == NULL)
+        ck_abort_msg ("Cannot create %s", test_dir);
+    test_name = g_build_filename (test_dir, "journal", (char *) NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    unlink (test_name);
+    g_free (test_name);
+    rmdir (test_dir);
+    g_free (test_dir);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_copy_journal_round_trip)
+/* *INDENT-ON* */
+{
+    /* given */
+    copy_journal_t *journal;
+    struct stat st_partial, st_done;
+    off_t offset = 0;
+
+    make_stat (&st_partial, 100000, 1000);
+    make_stat (&st_done, 2000, 2000);
+
+    journal = copy_journal_open_file (test_name);
+    mctest_assert_not_null (journal);
+    copy_journal_progress (journal, TEST_PATH_ESCAPED, &st_partial, 65536);
+    copy_journal_done (journal, TEST_PATH_DONE, &st_done);
+    copy_journal_close (journal, FALSE);
+
+    /* when */
+    journal = copy_journal_open_file (test_name);
+
+    /* then */
+    mctest_assert_not_null (journal);
+    mctest_assert_int_eq (g_hash_table_size (journal->records), 2);
+    mctest_assert_int_eq (copy_journal_lookup (journal, TEST_PATH_ESCAPED, &st_partial, &offset),
+                          COPY_JOURNAL_PARTIAL);
+    mctest_assert_int_eq (offset, 65536);
+    mctest_assert_int_eq (copy_journal_lookup (journal, TEST_PATH_DONE, &st_done, &offset),
+                          COPY_JOURNAL_DONE);
+    mctest_assert_int_eq (offset, 2000);
+    mctest_assert_int_eq (copy_journal_lookup (journal, "dir/other", &st_done, NULL),
+                          COPY_JOURNAL_NONE);
+
+    /* when */
+    /* the finished operation removes its journal */
+    copy_journal_close (journal, TRUE);
+
+    /* then */
+    mctest_assert_int_ne (access (test_name, F_OK), 0);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_copy_journal_truncated)
+/* *INDENT-ON* */
+{
+    /* given */
+    static const char contents[] = COPY_JOURNAL_SIGNATURE "\n"
+        "D 10 5 10 file1\n"
+        "garbage\n"
+        "D 20 5 20 file2.bak";
+    copy_journal_t *journal;
+    struct stat st1, st2, st3;
+    off_t offset = 0;
+
+    make_stat (&st1, 10, 5);
+    make_stat (&st2, 20, 5);
+    make_stat (&st3, 30, 5);
+    mctest_assert_true (g_file_set_contents (test_name, contents, -1, NULL));
+
+    /* when */
+    journal = copy_journal_open_file (test_name);
+
+    /* then */
+    /* the last record is cut off: it's not taken even for a shorter name */
+    mctest_assert_not_null (journal);
+    mctest_assert_int_eq (g_hash_table_size (journal->records), 1);
+    mctest_assert_int_eq (copy_journal_lookup (journal, "file1", &st1, NULL), COPY_JOURNAL_DONE);
+    mctest_assert_int_eq (copy_journal_lookup (journal, "file2", &st2, NULL), COPY_JOURNAL_NONE);
+
+    /* when */
+    copy_journal_progress (journal, "file3", &st3, 15);
+    copy_journal_close (journal, FALSE);
+    journal = copy_journal_open_file (test_name);
+
+    /* then */
+    /* the new record isn't glued to the cut off one */
+    mctest_assert_not_null (journal);
+    mctest_assert_int_eq (g_hash_table_size (journal->records), 2);
+    mctest_assert_int_eq (copy_journal_lookup (journal, "file1", &st1, NULL), COPY_JOURNAL_DONE);
+    mctest_assert_int_eq (copy_journal_lookup (journal, "file3", &st3, &offset),
+                          COPY_JOURNAL_PARTIAL);
+    mctest_assert_int_eq (offset, 15);
+
+    copy_journal_close (journal, TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_copy_journal_source_changed)
+/* *INDENT-ON* */
+{
+    /* given */
+    copy_journal_t *journal;
+    struct stat st, st_other;
+
+    make_stat (&st, 1000, 100);
+
+    journal = copy_journal_open_file (test_name);
+    mctest_assert_not_null (journal);
+    copy_journal_done (journal, "file", &st);
+    copy_journal_close (journal, FALSE);
+
+    /* when */
+    journal = copy_journal_open_file (test_name);
+
+    /* then */
+    mctest_assert_not_null (journal);
+    mctest_assert_int_eq (copy_journal_lookup (journal, "file", &st, NULL), COPY_JOURNAL_DONE);
+
+    make_stat (&st_other, 1001, 100);
+    mctest_assert_int_eq (copy_journal_lookup (journal, "file", &st_other, NULL),
+                          COPY_JOURNAL_NONE);
+
+    make_stat (&st_other, 1000, 101);
+    mctest_assert_int_eq (copy_journal_lookup (journal, "file", &st_other, NULL),
+                          COPY_JOURNAL_NONE);
+
+    copy_journal_close (journal, TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_copy_journal_partial_then_done)
+/* *INDENT-ON* */
+{
+    /* given */
+    copy_journal_t *journal;
+    struct stat st;
+    off_t offset = 0;
+
+    make_stat (&st, 300000, 100);
+
+    journal = copy_journal_open_file (test_name);
+    mctest_assert_not_null (journal);
+    copy_journal_progress (journal, "partial", &st, 100000);
+    copy_journal_progress (journal, "partial", &st, 200000);
+    copy_journal_progress (journal, "done", &st, 100000);
+    copy_journal_done (journal, "done", &st);
+    copy_journal_close (journal, FALSE);
+
+    /* when */
+    journal = copy_journal_open_file (test_name);
+
+    /* then */
+    /* later records replace earlier ones */
+    mctest_assert_not_null (journal);
+    mctest_assert_int_eq (copy_journal_lookup (journal, "partial", &st, &offset),
+                          COPY_JOURNAL_PARTIAL);
+    mctest_assert_int_eq (offset, 200000);
+    mctest_assert_int_eq (copy_journal_lookup (journal, "done", &st, &offset), COPY_JOURNAL_DONE);
+    mctest_assert_int_eq (offset, 300000);
+
+    /* without the journal, nothing is known */
+    mctest_assert_int_eq (copy_journal_lookup (NULL, "done", &st, &offset), COPY_JOURNAL_NONE);
+
+    copy_journal_close (journal, TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_copy_journal_round_trip);
+    tcase_add_test (tc_core, test_copy_journal_truncated);
+    tcase_add_test (tc_core, test_copy_journal_source_changed);
+    tcase_add_test (tc_core, test_copy_journal_partial_then_done);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "copy_journal.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,235 @@
+/*
+   src/filemanager - tests for copying of sparse files
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "src/vfs/local/local.c"
+
+#include "src/filemanager/file.c"
+
+#define TEST_SIZE (8 * 1024 * 1024)
+#define TEST_DATA_SIZE (64 * 1024)
+
+static char *test_dir = NULL;
+static char *src_path = NULL;
+static char *dst_path = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+/** Write data at the beginning and in the middle of the file, leave holes elsewhere */
+
+static void
+make_sparse_file (const char *path)
+{
+    char *data;
+    int fd;
+    size_t i;
+
+    data = g_malloc (TEST_DATA_SIZE);
+    for (i = 0; i < TEST_DATA_SIZE; i++)
+        data[i] = (char) (i % 251 + 1);
+
+    fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    mctest_assert_int_ne (fd, -1);
+    mctest_assert_int_eq (write (fd, data, TEST_DATA_SIZE), TEST_DATA_SIZE);
+    mctest_assert_int_eq (lseek (fd, TEST_SIZE / 2, SEEK_SET), TEST_SIZE / 2);
+    mctest_assert_int_eq (write (fd, data, TEST_DATA_SIZE), TEST_DATA_SIZE);
+    mctest_assert_int_eq (ftruncate (fd, TEST_SIZE), 0);
+    close (fd);
+
+    g_free (data);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+
+    vfs_init ();
+    init_localfs ();
+    vfs_setup_work_dir ();
+
+    test_dir = g_build_filename (mc_tmpdir (), "mctest-copy-sparse-XXXXXX", (char *) NULL);
+    if (mkdtemp (test_dir) == NULL)
+        ck_abort_msg ("Cannot create %s", test_dir);
+    src_path = g_build_filename (test_dir, "src", (char *) NULL);
+    dst_path = g_build_filename (test_dir, "dst", (char *) NULL);
+
+    /* data shared with the source would hide the way holes are copied */
+    copy_method = VFS_COPY_READ_WRITE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    unlink (dst_path);
+    unlink (src_path);
+    g_free (dst_path);
+    g_free (src_path);
+    rmdir (test_dir);
+    g_free (test_dir);
+
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_copy_sparse_ds") */
+/* *INDENT-OFF* */
+static const struct test_copy_sparse_ds
+{
+    gboolean verify;
+} test_copy_sparse_ds[] =
+{
+    { /* 0. holes are found by seeking */
+        FALSE
+    },
+    { /* 1. holes are read as zeroes to be hashed */
+        TRUE
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_copy_sparse_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_copy_sparse, test_copy_sparse_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    file_op_context_t *ctx;
+    file_op_total_context_t *tctx;
+    FileProgressStatus status;
+    struct stat src_st, dst_st;
+    char *src_data, *dst_data;
+    gsize src_len, dst_len;
+
+    make_sparse_file (src_path);
+    mctest_assert_int_eq (stat (src_path, &src_st), 0);
+
+    ctx = file_op_context_new (OP_COPY);
+    ctx->verify = data->verify;
+    tctx = file_op_total_context_new ();
+
+    /* when */
+    status = copy_file_file (tctx, ctx, src_path, dst_path);
+
+    /* then */
+    mctest_assert_int_eq (status, FILE_CONT);
+
+    mctest_assert_true (g_file_get_contents (src_path, &src_data, &src_len, NULL));
+    mctest_assert_true (g_file_get_contents (dst_path, &dst_data, &dst_len, NULL));
+    mctest_assert_int_eq (dst_len, TEST_SIZE);
+    mctest_assert_true (memcmp (src_data, dst_data, TEST_SIZE) == 0);
+
+    mctest_assert_int_eq (stat (dst_path, &dst_st), 0);
+    /* the filesystem of the test directory may not support holes at all */
+    if ((off_t) src_st.st_blocks * 512 < TEST_SIZE)
+        mctest_assert_true ((off_t) dst_st.st_blocks * 512 < TEST_SIZE);
+
+    g_free (dst_data);
+    g_free (src_data);
+    file_op_total_context_destroy (tctx);
+    file_op_context_destroy (ctx);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_copy_sparse_mode_target)
+/* *INDENT-ON* */
+{
+    /* given */
+    vfs_path_t *src_vpath, *dst_vpath;
+    struct stat src_st, dst_st;
+
+    make_sparse_file (src_path);
+    mctest_assert_int_eq (stat (src_path, &src_st), 0);
+    src_vpath = vfs_path_from_str (src_path);
+    dst_vpath = vfs_path_from_str (dst_path);
+    memset (&dst_st, 0, sizeof (dst_st));
+
+    /* when, then */
+    /* skipped blocks of a device would keep their old data */
+    dst_st.st_mode = S_IFBLK | 0660;
+    mctest_assert_int_eq (copy_file_file_sparse_mode (src_vpath, &src_st, dst_vpath, &dst_st,
+                                                      FALSE), SPARSE_NONE);
+    dst_st.st_mode = S_IFCHR | 0660;
+    mctest_assert_int_eq (copy_file_file_sparse_mode (src_vpath, &src_st, dst_vpath, &dst_st,
+                                                      FALSE), SPARSE_NONE);
+
+    dst_st.st_mode = S_IFREG | 0644;
+    mctest_assert_int_eq (copy_file_file_sparse_mode (src_vpath, &src_st, dst_vpath, &dst_st,
+                                                      TRUE), SPARSE_NONE);
+    if ((off_t) src_st.st_blocks * 512 < TEST_SIZE)
+        mctest_assert_int_ne (copy_file_file_sparse_mode (src_vpath, &src_st, dst_vpath, &dst_st,
+                                                          FALSE), SPARSE_NONE);
+
+    vfs_path_free (dst_vpath);
+    vfs_path_free (src_vpath);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_copy_sparse, test_copy_sparse_ds);
+    tcase_add_test (tc_core, test_copy_sparse_mode_target);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "copy_sparse.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
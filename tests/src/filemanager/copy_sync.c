@@ -0,0 +1,277 @@
+/*
+   src/filemanager - tests for skipping of unchanged files in sync mode of copying
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include <unistd.h>
+#include <utime.h>
+
+#include "src/vfs/local/local.c"
+
+#include "src/filemanager/file.c"
+
+/* more than one block of the comparison */
+#define TEST_SIZE (2 * FILEOP_SYNC_BUFSIZE + 1234)
+#define TEST_MTIME ((time_t) 1000000000)
+
+static char *test_dir = NULL;
+static char *test_data = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+/** Create the file in the test directory, it gets the given modification time */
+
+static vfs_path_t *
+make_file (const char *name, const char *data, size_t size, time_t mtime, struct stat *st)
+{
+    char *path;
+    vfs_path_t *vpath;
+    struct utimbuf utb;
+
+    path = g_build_filename (test_dir, name, (char *) NULL);
+    mctest_assert_true (g_file_set_contents (path, data, (gssize) size, NULL));
+    utb.actime = mtime;
+    utb.modtime = mtime;
+    mctest_assert_int_eq (utime (path, &utb), 0);
+
+    vpath = vfs_path_from_str (path);
+    g_free (path);
+    mctest_assert_int_eq (mc_stat (vpath, st), 0);
+
+    return vpath;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+remove_file (vfs_path_t * vpath)
+{
+    mc_unlink (vpath);
+    vfs_path_free (vpath);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    GRand *rand;
+    size_t i;
+
+    str_init_strings (NULL);
+
+    vfs_init ();
+    init_localfs ();
+    vfs_setup_work_dir ();
+
+    test_dir = g_build_filename (mc_tmpdir (), "mctest-copy-sync-XXXXXX", (char *) NULL);
+    if (mkdtemp (test_dir) == NULL)
+        ck_abort_msg ("Cannot create %s", test_dir);
+
+    rand = g_rand_new_with_seed (1);
+    test_data = g_malloc (TEST_SIZE);
+    for (i = 0; i < TEST_SIZE; i++)
+        test_data[i] = (char) g_rand_int (rand);
+    g_rand_free (rand);
+
+    sync_compare_content = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    g_free (test_data);
+    rmdir (test_dir);
+    g_free (test_dir);
+
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_copy_sync_same_data)
+/* *INDENT-ON* */
+{
+    /* given */
+    vfs_path_t *src_vpath, *same_vpath, *changed_vpath, *short_vpath;
+    struct stat st;
+    char *changed;
+
+    changed = g_memdup (test_data, TEST_SIZE);
+    /* in the last, partial block */
+    changed[TEST_SIZE - 1] ^= 1;
+
+    src_vpath = make_file ("src", test_data, TEST_SIZE, TEST_MTIME, &st);
+    same_vpath = make_file ("same", test_data, TEST_SIZE, TEST_MTIME, &st);
+    changed_vpath = make_file ("changed", changed, TEST_SIZE, TEST_MTIME, &st);
+    short_vpath = make_file ("short", test_data, FILEOP_SYNC_BUFSIZE, TEST_MTIME, &st);
+
+    /* when, then */
+    mctest_assert_true (copy_sync_same_data (src_vpath, same_vpath));
+    mctest_assert_false (copy_sync_same_data (src_vpath, changed_vpath));
+    /* the same beginning */
+    mctest_assert_false (copy_sync_same_data (src_vpath, short_vpath));
+    mctest_assert_false (copy_sync_same_data (short_vpath, src_vpath));
+
+    remove_file (short_vpath);
+    remove_file (changed_vpath);
+    remove_file (same_vpath);
+    remove_file (src_vpath);
+    g_free (changed);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_copy_sync_skip_ds") */
+/* *INDENT-OFF* */
+static const struct test_copy_sync_skip_ds
+{
+    gboolean sync;
+    int compare_content;
+    size_t dst_size;
+    time_t dst_mtime;
+    gboolean dst_changed;
+    gboolean expected_skipped;
+} test_copy_sync_skip_ds[] =
+{
+    { /* 0. not in sync mode */
+        FALSE, 0, TEST_SIZE, TEST_MTIME, FALSE, FALSE
+    },
+    { /* 1. the same size and time */
+        TRUE, 0, TEST_SIZE, TEST_MTIME, FALSE, TRUE
+    },
+    { /* 2. the same size and time, but other data: not read */
+        TRUE, 0, TEST_SIZE, TEST_MTIME, TRUE, TRUE
+    },
+    { /* 3. other size */
+        TRUE, 1, TEST_SIZE - 1, TEST_MTIME, FALSE, FALSE
+    },
+    { /* 4. other time */
+        TRUE, 0, TEST_SIZE, TEST_MTIME + 10, FALSE, FALSE
+    },
+    { /* 5. other time, the same data */
+        TRUE, 1, TEST_SIZE, TEST_MTIME + 10, FALSE, TRUE
+    },
+    { /* 6. other time and data */
+        TRUE, 1, TEST_SIZE, TEST_MTIME - 10, TRUE, FALSE
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_copy_sync_skip_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_copy_sync_skip, test_copy_sync_skip_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    file_op_context_t *ctx;
+    file_op_total_context_t *tctx;
+    vfs_path_t *src_vpath, *dst_vpath;
+    struct stat src_stat, dst_stat, st;
+    char *dst_data;
+    FileProgressStatus status = FILE_ABORT;
+    gboolean skipped;
+
+    dst_data = g_memdup (test_data, TEST_SIZE);
+    if (data->dst_changed)
+        dst_data[0] ^= 1;
+
+    src_vpath = make_file ("src", test_data, TEST_SIZE, TEST_MTIME, &src_stat);
+    dst_vpath = make_file ("dst", dst_data, data->dst_size, data->dst_mtime, &dst_stat);
+
+    ctx = file_op_context_new (OP_COPY);
+    ctx->sync = data->sync;
+    /* times of targets are fixed whether attributes are preserved or not */
+    ctx->preserve = FALSE;
+    tctx = file_op_total_context_new ();
+    sync_compare_content = data->compare_content;
+
+    /* when */
+    skipped = copy_sync_skip (tctx, ctx, src_vpath, &src_stat, dst_vpath, &dst_stat, &status);
+
+    /* then */
+    mctest_assert_int_eq (skipped, data->expected_skipped);
+    mctest_assert_int_eq (mc_stat (dst_vpath, &st), 0);
+    if (skipped)
+    {
+        mctest_assert_int_eq (status, FILE_CONT);
+        mctest_assert_int_eq (tctx->skipped_count, 1);
+        mctest_assert_int_eq (tctx->skipped_bytes, TEST_SIZE);
+        mctest_assert_int_eq (tctx->progress_count, 1);
+        mctest_assert_int_eq (st.st_mtime, TEST_MTIME);
+    }
+    else
+    {
+        mctest_assert_int_eq (tctx->skipped_count, 0);
+        mctest_assert_int_eq (tctx->progress_count, 0);
+        mctest_assert_int_eq (st.st_mtime, data->dst_mtime);
+    }
+
+    file_op_total_context_destroy (tctx);
+    file_op_context_destroy (ctx);
+    remove_file (dst_vpath);
+    remove_file (src_vpath);
+    g_free (dst_data);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_copy_sync_same_data);
+    mctest_add_parameterized_test (tc_core, test_copy_sync_skip, test_copy_sync_skip_ds);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "copy_sync.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,329 @@
+/*
+   src/filemanager - tests for cache of directory listings
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include <unistd.h>
+#include <utime.h>
+
+#include "src/vfs/local/local.c"
+
+#include "src/filemanager/dircache.c"
+
+static char *test_dir = NULL;
+static vfs_path_t *test_vpath = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+fill_list (dir_list * list, int count)
+{
+    int i;
+
+    memset (list, 0, sizeof (*list));
+    dir_list_init (list);
+
+    for (i = 0; i < count; i++)
+    {
+        struct stat st;
+        char *fname;
+
+        memset (&st, 0, sizeof (st));
+        st.st_mode = S_IFREG | 0644;
+        st.st_size = (off_t) i;
+        st.st_ino = (ino_t) i + 1;
+
+        fname = g_strdup_printf ("file%d", i);
+        dir_list_append (list, fname, &st, FALSE, FALSE);
+        g_free (fname);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+free_list (dir_list * list)
+{
+    dir_list_clean (list);
+    g_free (list->list);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+
+    vfs_init ();
+    init_localfs ();
+    vfs_setup_work_dir ();
+
+    test_dir = g_build_filename (mc_tmpdir (), "mctest-dir-cache-XXXXXX", (char *) NULL);
+    if (mkdtemp (test_dir) == NULL)
+        ck_abort_msg ("Cannot create %s", test_dir);
+    test_vpath = vfs_path_from_str (test_dir);
+
+    dir_cache_size = 16384;
+    memset (&stats, 0, sizeof (stats));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    dir_cache_clear ();
+
+    rmdir (test_dir);
+    g_free (test_dir);
+    vfs_path_free (test_vpath);
+
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_dir_cache_validate)
+/* *INDENT-ON* */
+{
+    /* given */
+    dir_list list, cached;
+    struct stat dir_st, st;
+    struct utimbuf times;
+    dir_cache_stats_t s;
+    gboolean found;
+
+    fill_list (&list, 10);
+    list.list[4].f.marked = 1;
+
+    times.actime = times.modtime = 1000000;
+    utime (test_dir, &times);
+    stat (test_dir, &dir_st);
+    dir_cache_put (test_vpath, NULL, &list, &dir_st, TRUE);
+
+    /* when */
+    memset (&cached, 0, sizeof (cached));
+    found = dir_cache_get (test_vpath, NULL, &cached, &st);
+
+    /* then */
+    mctest_assert_true (found);
+    mctest_assert_int_eq (cached.len, 11);
+    mctest_assert_str_eq (cached.list[0].fname, "..");
+    mctest_assert_str_eq (cached.list[4].fname, "file3");
+    mctest_assert_int_eq (cached.list[4].st.st_size, 3);
+    mctest_assert_int_eq (cached.list[4].f.marked, 0);
+    mctest_assert_int_eq (st.st_mtime, 1000000);
+    free_list (&cached);
+
+    /* when: another filter is used */
+    memset (&cached, 0, sizeof (cached));
+    found = dir_cache_get (test_vpath, "*.c", &cached, &st);
+
+    /* then: the listing is dropped */
+    mctest_assert_false (found);
+
+    /* when: the directory is changed */
+    dir_cache_put (test_vpath, NULL, &list, &dir_st, TRUE);
+    times.actime = times.modtime = 2000000;
+    utime (test_dir, &times);
+    found = dir_cache_get (test_vpath, NULL, &cached, &st);
+
+    /* then */
+    mctest_assert_false (found);
+    dir_cache_get_stats (&s);
+    mctest_assert_int_eq (s.hits, 1);
+    mctest_assert_int_eq (s.misses, 2);
+    mctest_assert_int_eq (s.count, 0);
+    mctest_assert_int_eq (s.memory, 0);
+
+    free_list (&cached);
+    free_list (&list);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_dir_cache_budget)
+/* *INDENT-ON* */
+{
+    /* given */
+    dir_list list;
+    struct stat dir_st;
+    vfs_path_t *vpath1, *vpath2, *vpath3;
+    gsize one;
+    dir_cache_stats_t s;
+
+    fill_list (&list, 1000);
+    memset (&dir_st, 0, sizeof (dir_st));
+    dir_st.st_mtime = 1000000;
+    vpath1 = vfs_path_from_str ("/mctest/1");
+    vpath2 = vfs_path_from_str ("/mctest/2");
+    vpath3 = vfs_path_from_str ("/mctest/3");
+
+    dir_cache_put (vpath1, NULL, &list, &dir_st, TRUE);
+    dir_cache_get_stats (&s);
+    one = s.memory;
+    dir_cache_size = (int) (one * 2 / 1024) + 1;
+
+    /* when */
+    dir_cache_put (vpath2, NULL, &list, &dir_st, TRUE);
+    dir_cache_put (vpath3, NULL, &list, &dir_st, TRUE);
+
+    /* then: the least recently used listing is dropped */
+    dir_cache_get_stats (&s);
+    mctest_assert_int_eq (s.count, 2);
+    mctest_assert_int_eq (s.evictions, 1);
+    mctest_assert_int_eq (s.memory, one * 2);
+    mctest_assert_true (dir_cache_find ("/mctest/1") == NULL);
+    mctest_assert_true (dir_cache_find ("/mctest/3") == cache.head);
+
+    /* when: the listing doesn't fit at all */
+    free_list (&list);
+    fill_list (&list, 5000);
+    dir_cache_put (vpath1, NULL, &list, &dir_st, TRUE);
+
+    /* then */
+    dir_cache_get_stats (&s);
+    mctest_assert_int_eq (s.count, 2);
+    mctest_assert_true (dir_cache_find ("/mctest/1") == NULL);
+
+    vfs_path_free (vpath1);
+    vfs_path_free (vpath2);
+    vfs_path_free (vpath3);
+    free_list (&list);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_dir_cache_entry_changed_ds") */
+/* *INDENT-OFF* */
+static const struct test_dir_cache_entry_changed_ds
+{
+    gboolean up_to_date;
+} test_dir_cache_entry_changed_ds[] =
+{
+    { /* 0. the directory is watched */
+        TRUE
+    },
+    { /* 1. entries are checked when the listing is reused */
+        FALSE
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_dir_cache_entry_changed_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_dir_cache_entry_changed, test_dir_cache_entry_changed_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    dir_list list, cached;
+    struct stat dir_st, st;
+    struct utimbuf times;
+    char *path;
+    FILE *f;
+    gboolean found;
+
+    path = g_build_filename (test_dir, "file", (char *) NULL);
+    mctest_assert_true (g_file_set_contents (path, "old data", -1, NULL));
+    times.actime = times.modtime = 1000000;
+    utime (path, &times);
+
+    memset (&list, 0, sizeof (list));
+    dir_list_init (&list);
+    lstat (path, &st);
+    dir_list_append (&list, "file", &st, FALSE, FALSE);
+    stat (test_dir, &dir_st);
+
+    dir_cache_put (test_vpath, NULL, &list, &dir_st, data->up_to_date);
+    memset (&cached, 0, sizeof (cached));
+    found = dir_cache_get (test_vpath, NULL, &cached, &st);
+    mctest_assert_true (found);
+    free_list (&cached);
+
+    /* when: the file is rewritten in place, times of the directory are kept */
+    dir_cache_put (test_vpath, NULL, &list, &dir_st, data->up_to_date);
+    f = fopen (path, "r+");
+    mctest_assert_not_null (f);
+    fputs ("new data", f);
+    fclose (f);
+    memset (&cached, 0, sizeof (cached));
+    found = dir_cache_get (test_vpath, NULL, &cached, &st);
+
+    /* then */
+    mctest_assert_false (found);
+    mctest_assert_int_eq (st.st_mtime, dir_st.st_mtime);
+
+    unlink (path);
+    g_free (path);
+    free_list (&cached);
+    free_list (&list);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_dir_cache_validate);
+    tcase_add_test (tc_core, test_dir_cache_budget);
+    mctest_add_parameterized_test (tc_core, test_dir_cache_entry_changed,
+                                   test_dir_cache_entry_changed_ds);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "dir_cache.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
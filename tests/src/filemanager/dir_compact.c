@@ -0,0 +1,189 @@
+/*
+   src/filemanager - tests for compact storage of directory content
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include "src/filemanager/dircompact.c"
+
+#define TEST_ENTRIES 1000
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+fill_list (dir_list * list, int count)
+{
+    int i;
+
+    memset (list, 0, sizeof (*list));
+    dir_list_init (list);
+
+    for (i = 0; i < count; i++)
+    {
+        struct stat st;
+        char *fname;
+
+        memset (&st, 0, sizeof (st));
+        st.st_mode = (i % 3 == 0 ? S_IFDIR : S_IFREG) | 0644;
+        st.st_size = (off_t) i * 1000;
+        st.st_mtime = (time_t) 1000000 + i;
+        st.st_ino = (ino_t) i + 1;
+        st.st_nlink = 1;
+
+        fname = g_strdup_printf ("file%d", i);
+        dir_list_append (list, fname, &st, i % 5 == 0, FALSE);
+        g_free (fname);
+
+        list->list[list->len - 1].f.marked = i % 7 == 0 ? 1 : 0;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+free_list (dir_list * list)
+{
+    dir_list_clean (list);
+    g_free (list->list);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_dir_compact_roundtrip)
+/* *INDENT-ON* */
+{
+    /* given */
+    dir_list list, copy;
+    dir_compact_t *dc;
+    int i, marked = 0;
+
+    fill_list (&list, TEST_ENTRIES);
+    for (i = 0; i < list.len; i++)
+        if (list.list[i].f.marked != 0)
+            marked++;
+
+    /* when */
+    dc = dir_compact_from_list (&list);
+    memset (&copy, 0, sizeof (copy));
+    dir_compact_to_list (dc, &copy);
+
+    /* then: ".." and the entries */
+    mctest_assert_int_eq (dc->len, TEST_ENTRIES + 1);
+    mctest_assert_int_eq (dc->marked, marked);
+    mctest_assert_int_eq (copy.len, list.len);
+    for (i = 0; i < list.len; i++)
+    {
+        const file_entry_t *a = &list.list[i];
+        const file_entry_t *b = &copy.list[i];
+
+        mctest_assert_str_eq (dir_compact_get_name (dc, i), a->fname);
+        mctest_assert_str_eq (b->fname, a->fname);
+        mctest_assert_int_eq (b->fnamelen, a->fnamelen);
+        mctest_assert_int_eq (b->st.st_mode, a->st.st_mode);
+        mctest_assert_int_eq (b->st.st_size, a->st.st_size);
+        mctest_assert_int_eq (b->st.st_mtime, a->st.st_mtime);
+        mctest_assert_int_eq (b->st.st_ino, a->st.st_ino);
+        mctest_assert_int_eq (b->f.marked, a->f.marked);
+        mctest_assert_int_eq (b->f.link_to_dir, a->f.link_to_dir);
+        mctest_assert_int_eq (dir_compact_is_dir (dc, i),
+                              S_ISDIR (a->st.st_mode) || a->f.link_to_dir != 0);
+    }
+
+    dir_compact_free (dc);
+    free_list (&copy);
+    free_list (&list);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_dir_compact_marks)
+/* *INDENT-ON* */
+{
+    /* given */
+    dir_compact_t *dc;
+    struct stat st;
+    int i;
+
+    memset (&st, 0, sizeof (st));
+    dc = dir_compact_new (0);
+    for (i = 0; i < 100; i++)
+        dir_compact_append (dc, "x", 1, &st, 0);
+
+    /* when */
+    dir_compact_set_marked (dc, 31, TRUE);
+    dir_compact_set_marked (dc, 32, TRUE);
+    dir_compact_set_marked (dc, 32, TRUE);
+    dir_compact_set_marked (dc, 99, TRUE);
+    dir_compact_set_marked (dc, 99, FALSE);
+
+    /* then */
+    mctest_assert_int_eq (dc->marked, 2);
+    mctest_assert_true (dir_compact_is_marked (dc, 31));
+    mctest_assert_true (dir_compact_is_marked (dc, 32));
+    mctest_assert_false (dir_compact_is_marked (dc, 33));
+    mctest_assert_false (dir_compact_is_marked (dc, 99));
+
+    dir_compact_clear (dc);
+    mctest_assert_int_eq (dc->len, 0);
+    mctest_assert_int_eq (dc->marked, 0);
+    mctest_assert_false (dir_compact_is_marked (dc, 31));
+
+    dir_compact_free (dc);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_dir_compact_roundtrip);
+    tcase_add_test (tc_core, test_dir_compact_marks);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "dir_compact.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
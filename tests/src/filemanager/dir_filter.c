@@ -0,0 +1,177 @@
+/*
+   src/filemanager - tests for filtering of loaded directory content
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include "src/filemanager/dir.h"
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_dir_filter_is_narrower_ds") */
+/* *INDENT-OFF* */
+static const struct test_dir_filter_is_narrower_ds
+{
+    const char *old_fltr;
+    const char *new_fltr;
+    gboolean expected;
+} test_dir_filter_is_narrower_ds[] =
+{
+    { NULL, "*.c", TRUE },
+    { "*", "a*", TRUE },
+    { "**", "*a*", TRUE },
+    { "*.c", NULL, FALSE },
+    { "*.c", "*.c", TRUE },
+    { "*a*", "*ab*", TRUE },
+    { "*a*", "*ba*", TRUE },
+    { "*ab*", "*a*", FALSE },
+    { "*a*", "*x*a*", TRUE },
+    { "*a*b*", "*ab*", TRUE },
+    { "*a*b*", "*ba*", FALSE },
+    { "a*", "ab*", TRUE },
+    { "a*", "ba*", FALSE },
+    { "*.c", "*x.c", TRUE },
+    { "*.c", "*.cc", FALSE },
+    { "ab*ba", "ab*ba*ba", TRUE },
+    { "aba*", "ab*", FALSE },
+    { "*a*", "*a?*", FALSE },
+    { "*a*", "*{a,b}*", FALSE },
+    { "a", "ab", FALSE },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_dir_filter_is_narrower_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_dir_filter_is_narrower, test_dir_filter_is_narrower_ds)
+/* *INDENT-ON* */
+{
+    /* when */
+    gboolean actual;
+
+    actual = dir_filter_is_narrower (data->old_fltr, data->new_fltr);
+
+    /* then */
+    mctest_assert_int_eq (actual, data->expected);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_dir_list_filter)
+/* *INDENT-ON* */
+{
+    /* given */
+    static const char *names[] = { "..", "dir.h", "a.c", "b.h", "c.c", "link.c" };
+    dir_list list;
+    struct stat st;
+    size_t i;
+    gboolean changed;
+
+    memset (&list, 0, sizeof (list));
+    for (i = 0; i < G_N_ELEMENTS (names); i++)
+    {
+        memset (&st, 0, sizeof (st));
+        st.st_mode = i < 2 ? S_IFDIR | 0755 : S_IFREG | 0644;
+        dir_list_append (&list, names[i], &st, FALSE, FALSE);
+    }
+    list.list[4].f.marked = 1;
+
+    /* when */
+    changed = dir_list_filter (&list, NULL, "*.c");
+
+    /* then: directories are kept, the order and marks are kept */
+    mctest_assert_true (changed);
+    mctest_assert_int_eq (list.len, 5);
+    mctest_assert_str_eq (list.list[0].fname, "..");
+    mctest_assert_str_eq (list.list[1].fname, "dir.h");
+    mctest_assert_str_eq (list.list[2].fname, "a.c");
+    mctest_assert_str_eq (list.list[3].fname, "c.c");
+    mctest_assert_str_eq (list.list[4].fname, "link.c");
+    mctest_assert_int_eq (list.list[3].f.marked, 1);
+
+    /* when: narrowed */
+    changed = dir_list_filter (&list, NULL, "c*.c");
+
+    /* then */
+    mctest_assert_true (changed);
+    mctest_assert_int_eq (list.len, 3);
+    mctest_assert_str_eq (list.list[2].fname, "c.c");
+
+    dir_list_clean (&list);
+    g_free (list.list);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_dir_filter_is_narrower,
+                                   test_dir_filter_is_narrower_ds);
+    tcase_add_test (tc_core, test_dir_list_filter);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "dir_filter.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
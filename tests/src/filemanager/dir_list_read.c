@@ -0,0 +1,257 @@
+/*
+   src/filemanager - tests for reading of directory listings
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include <unistd.h>
+
+#include "src/vfs/local/local.c"
+
+#include "src/filemanager/dir.c"
+
+#ifdef DIR_PARALLEL_STAT
+/* enough entries to start the worker pool */
+#define TEST_FILES (DIR_STAT_PARALLEL_MIN * 4)
+#else
+#define TEST_FILES 16
+#endif
+
+static char *test_dir = NULL;
+static vfs_path_t *test_vpath = NULL;
+static dir_sort_options_t sort_op = { FALSE, TRUE, FALSE };
+
+/* number of DIR_READ notifications after which loading is cancelled, 0 to never cancel */
+static int cancel_after = 0;
+static int read_count = 0;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+test_file_path (int i)
+{
+    char name[32];
+
+    g_snprintf (name, sizeof (name), "file%04d", i);
+    return g_build_filename (test_dir, name, (char *) NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+test_load_callback (dir_list_cb_state_t state, void *data)
+{
+    (void) data;
+
+    if (state != DIR_READ)
+        return TRUE;
+
+    read_count++;
+    return (cancel_after == 0 || read_count <= cancel_after);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+load_list (dir_list * list)
+{
+    memset (list, 0, sizeof (*list));
+    list->callback = test_load_callback;
+    read_count = 0;
+    dir_list_load (list, test_vpath, (GCompareFunc) sort_name, &sort_op, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+free_list (dir_list * list)
+{
+    dir_list_clean (list);
+    g_free (list->list);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    int i;
+
+    str_init_strings (NULL);
+
+    vfs_init ();
+    init_localfs ();
+    vfs_setup_work_dir ();
+
+    test_dir = g_build_filename (mc_tmpdir (), "mctest-dir-list-read-XXXXXX", (char *) NULL);
+    if (mkdtemp (test_dir) == NULL)
+        ck_abort_msg ("Cannot create %s", test_dir);
+    test_vpath = vfs_path_from_str (test_dir);
+
+    for (i = 0; i < TEST_FILES; i++)
+    {
+        char *path;
+
+        path = test_file_path (i);
+        mctest_assert_true (g_file_set_contents (path, "data", -1, NULL));
+        g_free (path);
+    }
+
+    dir_stat_threads = 4;
+    cancel_after = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    int i;
+
+    for (i = 0; i < TEST_FILES; i++)
+    {
+        char *path;
+
+        path = test_file_path (i);
+        unlink (path);
+        g_free (path);
+    }
+
+    rmdir (test_dir);
+    g_free (test_dir);
+    vfs_path_free (test_vpath);
+
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_dir_list_read_all)
+/* *INDENT-ON* */
+{
+    /* given */
+    dir_list list;
+    int i;
+
+    /* when */
+    load_list (&list);
+
+    /* then */
+    mctest_assert_int_eq (list.len, TEST_FILES + 1);
+    mctest_assert_str_eq (list.list[0].fname, "..");
+    for (i = 1; i < list.len; i++)
+    {
+        mctest_assert_true (S_ISREG (list.list[i].st.st_mode));
+        mctest_assert_int_eq (list.list[i].st.st_size, 4);
+    }
+
+    free_list (&list);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_dir_list_read_cancel_ds") */
+/* *INDENT-OFF* */
+static const struct test_dir_list_read_cancel_ds
+{
+    int cancel_after;
+} test_dir_list_read_cancel_ds[] =
+{
+    { /* 0. while entries are read */
+        1
+    },
+    { /* 1. after all entries are read, i.e. while they are stat'ed in parallel */
+        TEST_FILES + 2
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_dir_list_read_cancel_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_dir_list_read_cancel, test_dir_list_read_cancel_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    dir_list list;
+    int i;
+
+    cancel_after = data->cancel_after;
+
+    /* when */
+    load_list (&list);
+
+    /* then */
+    /* loading is stopped: the owner of the list isn't asked again and again.
+       Workers may stat all entries before the owner is asked at all */
+    mctest_assert_true (read_count <= cancel_after + 1);
+    mctest_assert_true (list.len <= TEST_FILES + 1);
+    /* entries which weren't stat'ed yet aren't shown */
+    for (i = 1; i < list.len; i++)
+    {
+        mctest_assert_true (S_ISREG (list.list[i].st.st_mode));
+        mctest_assert_int_eq (list.list[i].st.st_size, 4);
+    }
+
+    free_list (&list);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_dir_list_read_all);
+    mctest_add_parameterized_test (tc_core, test_dir_list_read_cancel,
+                                   test_dir_list_read_cancel_ds);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "dir_list_read.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
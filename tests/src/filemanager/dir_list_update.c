@@ -0,0 +1,205 @@
+/*
+   src/filemanager - tests for dir_list_update() function
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "src/vfs/local/local.c"
+
+#include "src/filemanager/dir.h"
+
+static char *test_dir = NULL;
+static vfs_path_t *test_vpath = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+create_file (const char *name, const char *content)
+{
+    char *path;
+    FILE *f;
+
+    path = g_build_filename (test_dir, name, (char *) NULL);
+    f = fopen (path, "w");
+    fputs (content, f);
+    fclose (f);
+    g_free (path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+remove_file (const char *name)
+{
+    char *path;
+
+    path = g_build_filename (test_dir, name, (char *) NULL);
+    unlink (path);
+    g_free (path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+append_file (dir_list * list, const char *name)
+{
+    char *path;
+    struct stat st;
+
+    path = g_build_filename (test_dir, name, (char *) NULL);
+    lstat (path, &st);
+    dir_list_append (list, name, &st, FALSE, FALSE);
+    g_free (path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+find_file (const dir_list * list, const char *name)
+{
+    int i;
+
+    for (i = 0; i < list->len; i++)
+        if (strcmp (list->list[i].fname, name) == 0)
+            return i;
+
+    return -1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+
+    vfs_init ();
+    init_localfs ();
+    vfs_setup_work_dir ();
+
+    test_dir = g_build_filename (mc_tmpdir (), "mctest-dir-list-update-XXXXXX", (char *) NULL);
+    if (mkdtemp (test_dir) == NULL)
+        ck_abort_msg ("Cannot create %s", test_dir);
+    test_vpath = vfs_path_from_str (test_dir);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    remove_file ("a");
+    remove_file ("b");
+    remove_file ("c");
+    rmdir (test_dir);
+    g_free (test_dir);
+    vfs_path_free (test_vpath);
+
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_dir_list_update)
+/* *INDENT-ON* */
+{
+    /* given */
+    dir_list list;
+    dir_sort_options_t sort_op = { FALSE, TRUE, FALSE };
+    GHashTable *names;
+    gboolean changed;
+
+    memset (&list, 0, sizeof (list));
+    dir_list_init (&list);
+
+    create_file ("a", "a");
+    create_file ("b", "b");
+    append_file (&list, "a");
+    append_file (&list, "b");
+    list.list[find_file (&list, "a")].f.marked = 1;
+
+    /* when: "b" is removed, "c" is created, "a" is changed */
+    remove_file ("b");
+    create_file ("c", "c");
+    create_file ("a", "aaaa");
+
+    names = g_hash_table_new (g_str_hash, g_str_equal);
+    g_hash_table_insert (names, (char *) "a", (char *) "a");
+    g_hash_table_insert (names, (char *) "b", (char *) "b");
+    g_hash_table_insert (names, (char *) "c", (char *) "c");
+    changed = dir_list_update (&list, test_vpath, names, (GCompareFunc) sort_name, &sort_op, NULL);
+    g_hash_table_destroy (names);
+
+    /* then */
+    mctest_assert_true (changed);
+    mctest_assert_int_eq (list.len, 3);
+    mctest_assert_str_eq (list.list[0].fname, "..");
+    mctest_assert_str_eq (list.list[1].fname, "a");
+    mctest_assert_str_eq (list.list[2].fname, "c");
+    mctest_assert_int_eq (list.list[1].st.st_size, 4);
+    mctest_assert_int_eq (list.list[1].f.marked, 1);
+    mctest_assert_int_eq (list.list[2].f.marked, 0);
+    mctest_assert_int_eq (find_file (&list, "b"), -1);
+
+    dir_list_clean (&list);
+    g_free (list.list);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_dir_list_update);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "dir_list_update.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,319 @@
+/*
+   src/filemanager - tests for sizes of local directories
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include <unistd.h>
+#include <utime.h>
+
+#include "src/vfs/local/local.c"
+
+#include "src/filemanager/dirsize.c"
+
+/* sizes of directories changed within the last second are not kept */
+#define TEST_AGE 100
+
+static char *test_dir = NULL;
+static char *sub_dir = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+make_file (const char *name, size_t size)
+{
+    char *path, *data;
+
+    path = g_build_filename (sub_dir, name, (char *) NULL);
+    data = g_malloc0 (size);
+    mctest_assert_true (g_file_set_contents (path, data, (gssize) size, NULL));
+    g_free (data);
+
+    return path;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+make_old (const char *path)
+{
+    struct utimbuf utb;
+
+    utb.actime = time (NULL) - TEST_AGE;
+    utb.modtime = utb.actime;
+    mctest_assert_int_eq (utime (path, &utb), 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+scan_tree (dir_size_t * size)
+{
+    dir_size_scan_t *scan;
+
+    scan = dir_size_scan_start (test_dir);
+    mctest_assert_not_null (scan);
+    while (!dir_size_scan_wait (scan, size, NULL))
+        ;
+    dir_size_scan_free (scan);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+lookup_path (const char *path, dir_size_t * size, gboolean * confirmed)
+{
+    struct stat st;
+
+    mctest_assert_int_eq (stat (path, &st), 0);
+    return dir_size_lookup (&st, size, confirmed);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    char *path;
+
+    str_init_strings (NULL);
+
+    vfs_init ();
+    init_localfs ();
+    vfs_setup_work_dir ();
+
+    test_dir = g_build_filename (mc_tmpdir (), "mctest-dir-size-XXXXXX", (char *) NULL);
+    if (mkdtemp (test_dir) == NULL)
+        ck_abort_msg ("Cannot create %s", test_dir);
+    sub_dir = g_build_filename (test_dir, "sub", (char *) NULL);
+    mctest_assert_int_eq (mkdir (sub_dir, 0700), 0);
+
+    path = make_file ("file1", 100);
+    g_free (path);
+    make_old (sub_dir);
+    make_old (test_dir);
+
+#ifdef HAVE_GLIB_THREADS
+    /* the database of the user is neither read nor written */
+    cache_loaded = TRUE;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    char *path;
+
+#ifdef HAVE_GLIB_THREADS
+    if (cache != NULL)
+    {
+        g_hash_table_destroy (cache);
+        cache = NULL;
+    }
+    cache_changed = FALSE;
+#endif
+
+    path = g_build_filename (sub_dir, "file1", (char *) NULL);
+    unlink (path);
+    g_free (path);
+    path = g_build_filename (sub_dir, "file2", (char *) NULL);
+    unlink (path);
+    g_free (path);
+    rmdir (sub_dir);
+    g_free (sub_dir);
+    rmdir (test_dir);
+    g_free (test_dir);
+
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_GLIB_THREADS
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_dir_size_update)
+/* *INDENT-ON* */
+{
+    /* given */
+    dir_size_t size;
+    gboolean confirmed = FALSE;
+    char *path;
+    vfs_path_t *vpath;
+    struct stat st;
+
+    scan_tree (&size);
+    mctest_assert_int_eq (size.dirs, 2);
+    mctest_assert_int_eq (size.files, 1);
+    mctest_assert_int_eq (size.bytes, 100);
+
+    /* when */
+    path = make_file ("file2", 50);
+    vpath = vfs_path_from_str (path);
+    mctest_assert_int_eq (lstat (path, &st), 0);
+    dir_size_cache_update (vpath, NULL, &st);
+    vfs_path_free (vpath);
+    g_free (path);
+
+    /* then */
+    /* the parent is not changed itself, but its tree is */
+    mctest_assert_true (lookup_path (test_dir, &size, &confirmed));
+    mctest_assert_true (confirmed);
+    mctest_assert_int_eq (size.dirs, 2);
+    mctest_assert_int_eq (size.files, 2);
+    mctest_assert_int_eq (size.bytes, 150);
+    /* the directory of the file is scanned again */
+    mctest_assert_false (lookup_path (sub_dir, &size, &confirmed));
+
+    /* when */
+    path = g_build_filename (sub_dir, "file1", (char *) NULL);
+    vpath = vfs_path_from_str (path);
+    mctest_assert_int_eq (lstat (path, &st), 0);
+    mctest_assert_int_eq (unlink (path), 0);
+    dir_size_cache_update (vpath, &st, NULL);
+    vfs_path_free (vpath);
+    g_free (path);
+
+    /* then */
+    mctest_assert_true (lookup_path (test_dir, &size, &confirmed));
+    mctest_assert_int_eq (size.files, 1);
+    mctest_assert_int_eq (size.bytes, 50);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_dir_size_revalidate)
+/* *INDENT-ON* */
+{
+    /* given */
+    dir_size_t size;
+    gboolean confirmed = FALSE;
+
+    scan_tree (&size);
+
+    /* when */
+    dir_size_cache_revalidate ();
+
+    /* then */
+    /* the size is kept as a hint */
+    mctest_assert_true (lookup_path (test_dir, &size, &confirmed));
+    mctest_assert_false (confirmed);
+    mctest_assert_int_eq (size.bytes, 100);
+    mctest_assert_false (cache_changed);
+
+    /* when */
+    scan_tree (&size);
+
+    /* then */
+    mctest_assert_true (lookup_path (test_dir, &size, &confirmed));
+    mctest_assert_true (confirmed);
+    mctest_assert_int_eq (size.files, 1);
+    mctest_assert_int_eq (size.bytes, 100);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_dir_size_reuse_subtree)
+/* *INDENT-ON* */
+{
+    /* given */
+    dir_size_t size;
+    char *deep_dir, *path;
+
+    deep_dir = g_build_filename (sub_dir, "deep", (char *) NULL);
+    mctest_assert_int_eq (mkdir (deep_dir, 0700), 0);
+    make_old (deep_dir);
+    make_old (sub_dir);
+
+    scan_tree (&size);
+    mctest_assert_int_eq (size.dirs, 3);
+
+    /* a file is added deep in the tree behind the back of MC */
+    path = g_build_filename (deep_dir, "file2", (char *) NULL);
+    mctest_assert_true (g_file_set_contents (path, "data", -1, NULL));
+
+    /* when */
+    scan_tree (&size);
+
+    /* then */
+    /* the confirmed subdirectory is not read again */
+    mctest_assert_int_eq (size.dirs, 3);
+    mctest_assert_int_eq (size.files, 1);
+    mctest_assert_int_eq (size.bytes, 100);
+
+    unlink (path);
+    g_free (path);
+    rmdir (deep_dir);
+    g_free (deep_dir);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+#endif /* HAVE_GLIB_THREADS */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+#ifdef HAVE_GLIB_THREADS
+    tcase_add_test (tc_core, test_dir_size_update);
+    tcase_add_test (tc_core, test_dir_size_revalidate);
+    tcase_add_test (tc_core, test_dir_size_reuse_subtree);
+#endif
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "dir_size.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
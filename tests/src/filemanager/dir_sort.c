@@ -0,0 +1,195 @@
+/*
+   src/filemanager - tests for sorting of directory content by precomputed keys
+
+   Copyright (C) 2016
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include "src/filemanager/dirsort.c"
+
+#define TEST_ENTRIES 2000
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+fill_list (dir_list * list)
+{
+    int i;
+
+    memset (list, 0, sizeof (*list));
+    dir_list_init (list);
+
+    for (i = 0; i < TEST_ENTRIES; i++)
+    {
+        struct stat st;
+        char *fname;
+
+        memset (&st, 0, sizeof (st));
+
+        switch (i % 4)
+        {
+        case 0:
+            st.st_mode = S_IFDIR | 0755;
+            break;
+        case 1:
+            st.st_mode = S_IFREG | 0755;
+            break;
+        default:
+            st.st_mode = S_IFREG | 0644;
+            break;
+        }
+
+        /* lots of equal keys to check the order by name */
+        st.st_size = (off_t) ((i * 7919) % 101);
+        st.st_mtime = (time_t) (1000000 - (i * 104729) % 97);
+        st.st_atime = st.st_mtime;
+        st.st_ctime = st.st_mtime;
+        st.st_ino = (ino_t) ((i * 15485863) % 10007 + 1);
+
+        fname = g_strdup_printf ("%sName%d", i % 9 == 0 ? "." : (i % 2 == 0 ? "a" : "B"),
+                                 (i * 31) % 1009);
+        dir_list_append (list, fname, &st, FALSE, FALSE);
+        g_free (fname);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+free_list (dir_list * list)
+{
+    int i;
+
+    /* keys left by the comparisons of the test, the list was sorted case sensitively */
+    for (i = 0; i < list->len; i++)
+    {
+        str_release_key (list->list[i].sort_key, TRUE);
+        list->list[i].sort_key = NULL;
+        str_release_key (list->list[i].second_sort_key, TRUE);
+        list->list[i].second_sort_key = NULL;
+    }
+
+    dir_list_clean (list);
+    g_free (list->list);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_dir_list_sort_ds") */
+/* *INDENT-OFF* */
+static const struct test_dir_list_sort_ds
+{
+    GCompareFunc sort;
+    gboolean reverse;
+    gboolean exec_first;
+} test_dir_list_sort_ds[] =
+{
+    { (GCompareFunc) sort_name, FALSE, FALSE },
+    { (GCompareFunc) sort_name, TRUE, TRUE },
+    { (GCompareFunc) sort_time, FALSE, TRUE },
+    { (GCompareFunc) sort_time, TRUE, FALSE },
+    { (GCompareFunc) sort_ctime, FALSE, FALSE },
+    { (GCompareFunc) sort_atime, TRUE, FALSE },
+    { (GCompareFunc) sort_size, FALSE, FALSE },
+    { (GCompareFunc) sort_size, TRUE, TRUE },
+    { (GCompareFunc) sort_inode, FALSE, FALSE },
+    { (GCompareFunc) sort_inode, TRUE, FALSE },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_dir_list_sort_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_dir_list_sort, test_dir_list_sort_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    dir_list list;
+    dir_sort_options_t sort_op;
+    int (*cmp) (file_entry_t *, file_entry_t *);
+    int i;
+
+    fill_list (&list);
+    sort_op.reverse = data->reverse;
+    sort_op.case_sensitive = TRUE;
+    sort_op.exec_first = data->exec_first;
+    cmp = (int (*)(file_entry_t *, file_entry_t *)) data->sort;
+
+    /* when */
+    dir_list_sort (&list, data->sort, &sort_op);
+
+    /* then: ".." is left first, the order of others agrees with the comparison function */
+    mctest_assert_int_eq (list.len, TEST_ENTRIES + 1);
+    mctest_assert_str_eq (list.list[0].fname, "..");
+    for (i = 1; i < list.len - 1; i++)
+        mctest_assert_true (cmp (&list.list[i], &list.list[i + 1]) <= 0);
+
+    free_list (&list);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_dir_list_sort, test_dir_list_sort_ds);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "dir_sort.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */